@@ -0,0 +1,765 @@
+// optimized_bench.c
+// Benchmark of every conversion kernel: the OriginalCode float and int
+// routines, the 2x2 block kernels, and the planar and packed row-pair
+// kernels of each backend this CPU supports. Each kernel is run on a
+// synthetic image and on the bundled inputs, tiled to each size, and
+// reported as CSV or JSON. --check instead verifies the documented bounds
+// of the approximate kernels and the ROI drivers (make check).
+#define _POSIX_C_SOURCE 199309L
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "optimized_global.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+// OriginalCode builds (original_kernels.c), one per routine
+void original_float_size(int *width, int *height);
+void original_float_load(const uint8_t *rgb24);
+void original_float_RGB_to_YCC(void);
+void original_float_YCC_to_RGB(void);
+void original_int_size(int *width, int *height);
+void original_int_load(const uint8_t *rgb24);
+void original_int_RGB_to_YCC(void);
+void original_int_YCC_to_RGB(void);
+
+// Each sample runs a kernel often enough to cover about this many pixels,
+// so small images are not lost in timer resolution
+#define PIXELS_PER_SAMPLE 2000000
+
+#define MAX_SIZES 16
+
+typedef struct {
+    int width;
+    int height;
+} bench_size_t;
+
+static const bench_size_t default_sizes[] = {
+    { 64, 48 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 }
+};
+
+// Images one kernel run works on; which ones are used depends on the kernel
+typedef struct {
+    csc_packed_image_t packed;
+    csc_packed_image_t packed_out;
+    csc_rgb_image_t rgb;
+    csc_ycc_image_t ycc;
+    csc_rgb16_image_t rgb16;
+    csc_ycc16_image_t ycc16;
+} bench_images_t;
+
+typedef struct {
+    const char *kernel;
+    const char *direction;
+    void (*run)(bench_images_t *images);
+    int wide; // 16-bit samples, twice the bytes per pixel
+    int luma; // writes Y only, no chroma
+} bench_kernel_t;
+
+static void run_block_rgb_to_ycc(bench_images_t *im)  { optimized_RGB_to_YCC_block(&im->rgb, &im->ycc); }
+static void run_block_ycc_to_rgb(bench_images_t *im)  { optimized_YCC_to_RGB_block(&im->ycc, &im->rgb); }
+static void run_row_rgb_to_ycc(bench_images_t *im)    { optimized_RGB_to_YCC(&im->rgb, &im->ycc); }
+static void run_row_ycc_to_rgb(bench_images_t *im)    { optimized_YCC_to_RGB(&im->ycc, &im->rgb); }
+static void run_packed_rgb_to_ycc(bench_images_t *im) { optimized_packed_to_YCC(&im->packed, &im->ycc); }
+static void run_packed_ycc_to_rgb(bench_images_t *im) { optimized_YCC_to_packed(&im->ycc, &im->packed_out); }
+static void run_lut_row_rgb_to_ycc(bench_images_t *im)    { optimized_RGB_to_YCC_lut(&im->rgb, &im->ycc); }
+static void run_lut_row_ycc_to_rgb(bench_images_t *im)    { optimized_YCC_to_RGB_lut(&im->ycc, &im->rgb); }
+static void run_lut_packed_rgb_to_ycc(bench_images_t *im) { optimized_packed_to_YCC_lut(&im->packed, &im->ycc); }
+static void run_lut_packed_ycc_to_rgb(bench_images_t *im) { optimized_YCC_to_packed_lut(&im->ycc, &im->packed_out); }
+static void run_narrow_row_ycc_to_rgb(bench_images_t *im)    { optimized_YCC_to_RGB_narrow(&im->ycc, &im->rgb); }
+static void run_narrow_packed_ycc_to_rgb(bench_images_t *im) { optimized_YCC_to_packed_narrow(&im->ycc, &im->packed_out); }
+static void run_fast_chroma_row_rgb_to_ycc(bench_images_t *im)    { optimized_RGB_to_YCC_fast_chroma(&im->rgb, &im->ycc); }
+static void run_fast_chroma_packed_rgb_to_ycc(bench_images_t *im) { optimized_packed_to_YCC_fast_chroma(&im->packed, &im->ycc); }
+static void run_luma_row_rgb_to_y(bench_images_t *im)    { optimized_RGB_to_Y(&im->rgb, &im->ycc.Y); }
+static void run_luma_packed_rgb_to_y(bench_images_t *im) { optimized_packed_to_Y(&im->packed, &im->ycc.Y); }
+
+static const bench_kernel_t optimized_kernels[] = {
+    { "block",  "rgb_to_ycc", run_block_rgb_to_ycc, 0, 0 },
+    { "block",  "ycc_to_rgb", run_block_ycc_to_rgb, 0, 0 },
+    { "row",    "rgb_to_ycc", run_row_rgb_to_ycc, 0, 0 },
+    { "row",    "ycc_to_rgb", run_row_ycc_to_rgb, 0, 0 },
+    { "packed", "rgb_to_ycc", run_packed_rgb_to_ycc, 0, 0 },
+    { "packed", "ycc_to_rgb", run_packed_ycc_to_rgb, 0, 0 },
+};
+
+// 16-bit kernels on the input scaled up to 16 bits per sample
+static void run_row16_rgb_to_ycc(bench_images_t *im) { optimized_RGB16_to_YCC16(&im->rgb16, &im->ycc16); }
+static void run_row16_ycc_to_rgb(bench_images_t *im) { optimized_YCC16_to_RGB16(&im->ycc16, &im->rgb16); }
+
+static const bench_kernel_t hbd_kernels[] = {
+    { "row16", "rgb_to_ycc", run_row16_rgb_to_ycc, 1, 0 },
+    { "row16", "ycc_to_rgb", run_row16_ycc_to_rgb, 1, 0 },
+};
+
+// Table-driven kernels; the backend column names the LUT kernel set
+static const bench_kernel_t lut_kernels[] = {
+    { "lut_row",    "rgb_to_ycc", run_lut_row_rgb_to_ycc, 0, 0 },
+    { "lut_row",    "ycc_to_rgb", run_lut_row_ycc_to_rgb, 0, 0 },
+    { "lut_packed", "rgb_to_ycc", run_lut_packed_rgb_to_ycc, 0, 0 },
+    { "lut_packed", "ycc_to_rgb", run_lut_packed_ycc_to_rgb, 0, 0 },
+};
+
+// Narrow-arithmetic YCC->RGB; RGB->YCC is the backend's own
+static const bench_kernel_t narrow_kernels[] = {
+    { "narrow_row",    "ycc_to_rgb", run_narrow_row_ycc_to_rgb, 0, 0 },
+    { "narrow_packed", "ycc_to_rgb", run_narrow_packed_ycc_to_rgb, 0, 0 },
+};
+
+// Fast-chroma RGB->YCC; YCC->RGB is the backend's own
+static const bench_kernel_t fast_chroma_kernels[] = {
+    { "fast_chroma_row",    "rgb_to_ycc", run_fast_chroma_row_rgb_to_ycc, 0, 0 },
+    { "fast_chroma_packed", "rgb_to_ycc", run_fast_chroma_packed_rgb_to_ycc, 0, 0 },
+};
+
+// Luma-only RGB->Y into the Y plane
+static const bench_kernel_t luma_kernels[] = {
+    { "luma_row",    "rgb_to_y", run_luma_row_rgb_to_y, 0, 1 },
+    { "luma_packed", "rgb_to_y", run_luma_packed_rgb_to_y, 0, 1 },
+};
+
+// The OriginalCode kernels work on their own globals, so they ignore the
+// images and only run at the size compiled into them
+static void run_original_float_rgb_to_ycc(bench_images_t *im) { (void)im; original_float_RGB_to_YCC(); }
+static void run_original_float_ycc_to_rgb(bench_images_t *im) { (void)im; original_float_YCC_to_RGB(); }
+static void run_original_int_rgb_to_ycc(bench_images_t *im)   { (void)im; original_int_RGB_to_YCC(); }
+static void run_original_int_ycc_to_rgb(bench_images_t *im)   { (void)im; original_int_YCC_to_RGB(); }
+
+static const bench_kernel_t original_kernels[] = {
+    { "original_float", "rgb_to_ycc", run_original_float_rgb_to_ycc, 0, 0 },
+    { "original_float", "ycc_to_rgb", run_original_float_ycc_to_rgb, 0, 0 },
+    { "original_int",   "rgb_to_ycc", run_original_int_rgb_to_ycc, 0, 0 },
+    { "original_int",   "ycc_to_rgb", run_original_int_ycc_to_rgb, 0, 0 },
+};
+
+// A source pattern, tiled to fill each benchmark size
+typedef struct {
+    const char *name;
+    uint8_t *rgb24;
+    int width;
+    int height;
+} bench_input_t;
+
+typedef struct {
+    int warmup;
+    int reps;
+    int json;
+    double ghz; // for cycles/pixel when there is no TSC; 0 = unknown
+    FILE *out;
+    int rows_written;
+} bench_config_t;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#ifdef BENCH_HAVE_TSC
+// TSC ticks per nanosecond, measured against the monotonic clock
+static double calibrate_tsc_ghz(void) {
+    double t0 = now_ns();
+    uint64_t c0 = __rdtsc();
+    while (now_ns() - t0 < 50e6) {
+    }
+    double t1 = now_ns();
+    uint64_t c1 = __rdtsc();
+    return (double)(c1 - c0) / (t1 - t0);
+}
+#endif
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Deterministic noise plus gradients, so no kernel sees a flat image
+static uint8_t *make_synthetic(int width, int height) {
+    uint8_t *p = malloc((size_t)width * height * 3);
+    uint32_t state = 0x12345678u;
+
+    if (!p) {
+        return NULL;
+    }
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            uint8_t *px = p + ((size_t)row * width + col) * 3;
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            px[0] = (uint8_t)(col * 255 / (width - 1));
+            px[1] = (uint8_t)(row * 255 / (height - 1));
+            px[2] = (uint8_t)state;
+        }
+    }
+    return p;
+}
+
+// Raw RGB24 of a known size
+static uint8_t *load_raw(const char *path, int width, int height) {
+    csc_file_map_t map;
+    size_t bytes = (size_t)width * height * 3;
+
+    if (csc_file_map_read(&map, path) != 0) {
+        return NULL;
+    }
+    uint8_t *p = map.size >= bytes ? malloc(bytes) : NULL;
+    if (p) {
+        memcpy(p, map.data, bytes);
+    }
+    csc_file_unmap(&map);
+    return p;
+}
+
+// Binary P6 with 8- or 16-bit samples; 16-bit samples keep their high byte
+static uint8_t *load_p6(const char *path, int *width, int *height) {
+    csc_file_map_t map;
+    int maxval, header_len;
+
+    if (csc_file_map_read(&map, path) != 0) {
+        return NULL;
+    }
+    // copy the header so sscanf cannot run past the mapping
+    char header[64] = { 0 };
+    memcpy(header, map.data, map.size < sizeof header - 1 ? map.size : sizeof header - 1);
+    if (sscanf(header, "P6 %d %d %d%n", width, height, &maxval, &header_len) != 3 ||
+        *width <= 0 || *height <= 0 || maxval <= 0 || maxval > 65535) {
+        csc_file_unmap(&map);
+        return NULL;
+    }
+    int bytes_per_sample = maxval > 255 ? 2 : 1;
+    size_t samples = (size_t)*width * *height * 3;
+    header_len++; // single whitespace after maxval
+
+    uint8_t *p = NULL;
+    if (map.size >= header_len + samples * bytes_per_sample) {
+        p = malloc(samples);
+    }
+    if (p) {
+        const uint8_t *src = map.data + header_len;
+        for (size_t i = 0; i < samples; i++) {
+            p[i] = src[i * bytes_per_sample];
+        }
+    }
+    csc_file_unmap(&map);
+    return p;
+}
+
+// Tile the input pattern into a packed image of the bench size
+static void tile_input(const bench_input_t *input, csc_packed_image_t *packed) {
+    for (int row = 0; row < packed->height; row++) {
+        const uint8_t *src = input->rgb24 + (size_t)(row % input->height) * input->width * 3;
+        uint8_t *dst = PLANE_ROW(packed, row);
+        for (int col = 0; col < packed->width; col += input->width) {
+            int n = packed->width - col < input->width ? packed->width - col : input->width;
+            memcpy(dst + 3 * (size_t)col, src, 3 * (size_t)n);
+        }
+    }
+}
+
+static void emit_header(bench_config_t *cfg) {
+    if (cfg->json) {
+        fprintf(cfg->out, "[\n");
+    } else {
+        fprintf(cfg->out, "input,width,height,kernel,backend,direction,threads,reps,"
+                          "median_ns,p99_ns,ns_per_pixel,cycles_per_pixel,bytes_per_pixel,gbytes_per_s\n");
+    }
+}
+
+static void emit_footer(bench_config_t *cfg) {
+    if (cfg->json) {
+        fprintf(cfg->out, "\n]\n");
+    }
+}
+
+// Time one kernel and write one result row
+static void bench_kernel(bench_config_t *cfg, const char *input_name, const bench_kernel_t *kernel,
+                         const char *backend, bench_images_t *images, int width, int height) {
+    double pixels = (double)width * height;
+    int batch = (int)(PIXELS_PER_SAMPLE / pixels);
+    double *samples = malloc(sizeof(double) * cfg->reps);
+
+    if (!samples) {
+        return;
+    }
+    if (batch < 1) {
+        batch = 1;
+    }
+
+    for (int i = 0; i < cfg->warmup; i++) {
+        kernel->run(images);
+    }
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ns();
+        for (int j = 0; j < batch; j++) {
+            kernel->run(images);
+        }
+        samples[i] = (now_ns() - t0) / batch;
+    }
+    qsort(samples, cfg->reps, sizeof(double), compare_double);
+
+    double median = samples[cfg->reps / 2];
+    int p99_index = (int)(0.99 * cfg->reps + 0.999999) - 1;
+    double p99 = samples[p99_index < 0 ? 0 : p99_index];
+    double ns_per_pixel = median / pixels;
+    // both directions read and write one 3-byte pixel and 1.5 bytes of 4:2:0
+    // YCC; luma only writes the 1 byte of Y
+    double bytes_per_pixel = (3.0 + (kernel->luma ? 1.0 : 1.5)) * (kernel->wide ? 2 : 1);
+    double gbytes = bytes_per_pixel * pixels / median;
+    free(samples);
+
+    if (cfg->json) {
+        fprintf(cfg->out, "%s  {\"input\": \"%s\", \"width\": %d, \"height\": %d, \"kernel\": \"%s\", "
+                          "\"backend\": \"%s\", \"direction\": \"%s\", \"threads\": %d, \"reps\": %d, "
+                          "\"median_ns\": %.0f, \"p99_ns\": %.0f, \"ns_per_pixel\": %.4f, ",
+                cfg->rows_written ? ",\n" : "", input_name, width, height, kernel->kernel,
+                backend, kernel->direction, csc_threads_count(), cfg->reps, median, p99, ns_per_pixel);
+        if (cfg->ghz > 0.0) {
+            fprintf(cfg->out, "\"cycles_per_pixel\": %.3f, ", ns_per_pixel * cfg->ghz);
+        } else {
+            fprintf(cfg->out, "\"cycles_per_pixel\": null, ");
+        }
+        fprintf(cfg->out, "\"bytes_per_pixel\": %.1f, \"gbytes_per_s\": %.3f}", bytes_per_pixel, gbytes);
+    } else {
+        fprintf(cfg->out, "%s,%d,%d,%s,%s,%s,%d,%d,%.0f,%.0f,%.4f,", input_name, width, height,
+                kernel->kernel, backend, kernel->direction, csc_threads_count(), cfg->reps,
+                median, p99, ns_per_pixel);
+        if (cfg->ghz > 0.0) {
+            fprintf(cfg->out, "%.3f", ns_per_pixel * cfg->ghz);
+        }
+        fprintf(cfg->out, ",%.1f,%.3f\n", bytes_per_pixel, gbytes);
+    }
+    fflush(cfg->out);
+    cfg->rows_written++;
+}
+
+static void bench_original(bench_config_t *cfg, const bench_input_t *input) {
+    int width, height;
+    csc_packed_image_t packed;
+
+    original_float_size(&width, &height);
+    if (csc_packed_image_alloc(&packed, width, height, CSC_ORDER_RGB) != 0) {
+        return;
+    }
+    // tile into a tightly packed buffer for the original loaders
+    packed.stride = 3 * (ptrdiff_t)width;
+    tile_input(input, &packed);
+    original_float_load(packed.data);
+    original_int_load(packed.data);
+    csc_packed_image_free(&packed);
+
+    for (size_t k = 0; k < sizeof original_kernels / sizeof original_kernels[0]; k++) {
+        fprintf(stderr, "  %s %dx%d %s %s\n", input->name, width, height,
+                original_kernels[k].kernel, original_kernels[k].direction);
+        bench_kernel(cfg, input->name, &original_kernels[k], "c", NULL, width, height);
+    }
+}
+
+// v * 257 maps 0..255 onto 0..65535
+static void widen_planes(const csc_rgb_image_t *rgb, csc_rgb16_image_t *rgb16) {
+    const csc_plane_t *src[3] = { &rgb->R, &rgb->G, &rgb->B };
+    csc_plane16_t *dst[3] = { &rgb16->R, &rgb16->G, &rgb16->B };
+
+    for (int p = 0; p < 3; p++) {
+        for (int row = 0; row < src[p]->height; row++) {
+            const uint8_t *s = PLANE_ROW(src[p], row);
+            uint16_t *d = PLANE_ROW(dst[p], row);
+            for (int col = 0; col < src[p]->width; col++) {
+                d[col] = (uint16_t)(s[col] * 257);
+            }
+        }
+    }
+}
+
+static void bench_size(bench_config_t *cfg, const bench_input_t *input, int width, int height) {
+    bench_images_t images;
+
+    // a failed allocation frees every image, allocated or not
+    memset(&images, 0, sizeof images);
+    if (csc_packed_image_alloc(&images.packed, width, height, CSC_ORDER_RGB) != 0 ||
+        csc_packed_image_alloc(&images.packed_out, width, height, CSC_ORDER_RGB) != 0 ||
+        csc_rgb_image_alloc(&images.rgb, width, height) != 0 ||
+        csc_ycc_image_alloc(&images.ycc, width, height) != 0 ||
+        csc_rgb16_image_alloc(&images.rgb16, width, height, 16) != 0 ||
+        csc_ycc16_image_alloc(&images.ycc16, width, height, 16) != 0) {
+        fprintf(stderr, "Skipping %dx%d: out of memory\n", width, height);
+        goto done;
+    }
+    tile_input(input, &images.packed);
+    csc_packed_to_planes(&images.packed, &images.rgb);
+    widen_planes(&images.rgb, &images.rgb16);
+
+    const csc_backend_kernels_t *last_lut = NULL;
+    const csc_hbd_kernels_t *last_hbd = NULL;
+    for (int b = 0; b < CSC_BACKEND_COUNT; b++) {
+        if (csc_backend_select((csc_backend_t)b) != 0) {
+            continue;
+        }
+        const csc_backend_kernels_t *k = csc_backend_kernels();
+        // prime the YCC planes so the ycc_to_rgb kernels see real data
+        optimized_packed_to_YCC(&images.packed, &images.ycc);
+
+        for (size_t i = 0; i < sizeof optimized_kernels / sizeof optimized_kernels[0]; i++) {
+            // backends without their own block kernels would only repeat scalar
+            if (strcmp(optimized_kernels[i].kernel, "block") == 0 && b != CSC_BACKEND_SCALAR &&
+                k->rgb_to_ycc_block == optimized_RGB_to_YCC_block_scalar) {
+                continue;
+            }
+            fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                    optimized_kernels[i].kernel, k->name, optimized_kernels[i].direction);
+            bench_kernel(cfg, input->name, &optimized_kernels[i], k->name, &images, width, height);
+        }
+
+        const csc_backend_kernels_t *narrow = csc_narrow_kernels();
+        for (size_t i = 0; i < sizeof narrow_kernels / sizeof narrow_kernels[0]; i++) {
+            fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                    narrow_kernels[i].kernel, narrow->name, narrow_kernels[i].direction);
+            bench_kernel(cfg, input->name, &narrow_kernels[i], narrow->name, &images, width, height);
+        }
+        const csc_backend_kernels_t *fast_chroma = csc_fast_chroma_kernels();
+        for (size_t i = 0; i < sizeof fast_chroma_kernels / sizeof fast_chroma_kernels[0]; i++) {
+            fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                    fast_chroma_kernels[i].kernel, fast_chroma->name, fast_chroma_kernels[i].direction);
+            bench_kernel(cfg, input->name, &fast_chroma_kernels[i], fast_chroma->name, &images, width, height);
+        }
+        const csc_luma_kernels_t *luma = csc_luma_kernels();
+        for (size_t i = 0; i < sizeof luma_kernels / sizeof luma_kernels[0]; i++) {
+            fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                    luma_kernels[i].kernel, luma->name, luma_kernels[i].direction);
+            bench_kernel(cfg, input->name, &luma_kernels[i], luma->name, &images, width, height);
+        }
+
+        // several backends share one LUT or 16-bit kernel set; time each
+        // set once
+        const csc_backend_kernels_t *lut = csc_lut_kernels();
+        if (lut != last_lut) {
+            last_lut = lut;
+            for (size_t i = 0; i < sizeof lut_kernels / sizeof lut_kernels[0]; i++) {
+                fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                        lut_kernels[i].kernel, lut->name, lut_kernels[i].direction);
+                bench_kernel(cfg, input->name, &lut_kernels[i], lut->name, &images, width, height);
+            }
+        }
+        const csc_hbd_kernels_t *hbd = csc_hbd_kernels();
+        if (hbd != last_hbd) {
+            last_hbd = hbd;
+            optimized_RGB16_to_YCC16(&images.rgb16, &images.ycc16);
+            for (size_t i = 0; i < sizeof hbd_kernels / sizeof hbd_kernels[0]; i++) {
+                fprintf(stderr, "  %s %dx%d %s/%s %s\n", input->name, width, height,
+                        hbd_kernels[i].kernel, hbd->name, hbd_kernels[i].direction);
+                bench_kernel(cfg, input->name, &hbd_kernels[i], hbd->name, &images, width, height);
+            }
+        }
+    }
+
+done:
+    csc_ycc16_image_free(&images.ycc16);
+    csc_rgb16_image_free(&images.rgb16);
+    csc_ycc_image_free(&images.ycc);
+    csc_rgb_image_free(&images.rgb);
+    csc_packed_image_free(&images.packed_out);
+    csc_packed_image_free(&images.packed);
+}
+
+// Garbage for the images an ROI check starts from, so a pass that reads
+// pixels nobody converted shows up as a mismatch
+static void scramble_plane(csc_plane_t *plane, uint32_t *state) {
+    for (int row = 0; row < plane->height; row++) {
+        uint8_t *p = PLANE_ROW(plane, row);
+        for (int col = 0; col < plane->width; col++) {
+            *state ^= *state << 13;
+            *state ^= *state >> 17;
+            *state ^= *state << 5;
+            p[col] = (uint8_t)*state;
+        }
+    }
+}
+
+// Converts rectangles of a packed image there and back through the ROI
+// drivers, starting from scrambled YCC and output, and counts the pixels
+// of each aligned rectangle that differ from a full round trip
+static long check_roi(int width, int height) {
+    static const csc_rect_t fixed[] = {
+        { 0, 0, 64, 64 }, { 20, 30, 100, 50 }, { 1, 1, 1, 1 }, { 33, 7, 40, 21 }
+    };
+    csc_packed_image_t in = { NULL, 0, 0, 0, CSC_ORDER_RGB }, full = in, out = in;
+    csc_ycc_image_t ycc = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 } };
+    uint32_t state = 0x9e3779b9u;
+    long bad = -1;
+
+    if (csc_packed_image_alloc(&in, width, height, CSC_ORDER_RGB) != 0 ||
+        csc_packed_image_alloc(&full, width, height, CSC_ORDER_RGB) != 0 ||
+        csc_packed_image_alloc(&out, width, height, CSC_ORDER_RGB) != 0 ||
+        csc_ycc_image_alloc(&ycc, width, height) != 0) {
+        goto done;
+    }
+    csc_plane_t in_bytes = { in.data, 3 * width, height, in.stride };
+    csc_plane_t out_bytes = { out.data, 3 * width, height, out.stride };
+    scramble_plane(&in_bytes, &state);
+    optimized_packed_to_YCC(&in, &ycc);
+    optimized_YCC_to_packed(&ycc, &full);
+
+    bad = 0;
+    for (int i = 0; i < 4 + 32; i++) {
+        csc_rect_t roi, r;
+        if (i < 4) {
+            roi = fixed[i];
+        } else {
+            // the tail of the list: random rectangles, many touching the border
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            roi.x = (int)(state % (uint32_t)width);
+            roi.y = (int)((state >> 12) % (uint32_t)height);
+            roi.width = 1 + (int)((state >> 4) % (uint32_t)(width - roi.x));
+            roi.height = 1 + (int)((state >> 20) % (uint32_t)(height - roi.y));
+        }
+        if (csc_roi_align(&roi, width, height, &r) != 0) {
+            continue;
+        }
+        scramble_plane(&ycc.Y, &state);
+        scramble_plane(&ycc.Cb, &state);
+        scramble_plane(&ycc.Cr, &state);
+        scramble_plane(&out_bytes, &state);
+        optimized_packed_to_YCC_roi(&in, &ycc, &roi);
+        optimized_YCC_to_packed_roi(&ycc, &out, &roi);
+        for (int row = r.y; row < r.y + r.height; row++) {
+            for (int col = r.x; col < r.x + r.width; col++) {
+                bad += memcmp(PLANE_ROW(&out, row) + 3 * col, PLANE_ROW(&full, row) + 3 * col, 3) != 0;
+            }
+        }
+    }
+
+done:
+    csc_ycc_image_free(&ycc);
+    csc_packed_image_free(&out);
+    csc_packed_image_free(&full);
+    csc_packed_image_free(&in);
+    return bad;
+}
+
+// Exhaustive checks that the approximate kernel sets of every supported
+// backend stay within their documented bounds, and that ROI conversion
+// matches full-image conversion. Returns the number of checks that fail.
+static int run_checks(void) {
+    const csc_backend_kernels_t *last_narrow = NULL;
+    const csc_backend_kernels_t *last_fast_chroma = NULL;
+    int failed = 0;
+
+    for (int b = 0; b < CSC_BACKEND_COUNT; b++) {
+        if (csc_backend_select((csc_backend_t)b) != 0) {
+            continue;
+        }
+        const csc_backend_kernels_t *narrow = csc_narrow_kernels();
+        if (narrow != last_narrow) {
+            last_narrow = narrow;
+            int deviation = csc_narrow_check(narrow);
+            printf("narrow %s: max deviation %d over all YCC triples (bound %d)\n",
+                   narrow->name, deviation, CSC_NARROW_MAX_DEVIATION);
+            if (deviation > CSC_NARROW_MAX_DEVIATION) {
+                failed++;
+            }
+        }
+        const csc_backend_kernels_t *fast_chroma = csc_fast_chroma_kernels();
+        if (fast_chroma != last_fast_chroma) {
+            last_fast_chroma = fast_chroma;
+            int deviation = csc_fast_chroma_check(fast_chroma);
+            printf("fast chroma %s: max deviation %d from per-pixel chroma (bound %d)\n",
+                   fast_chroma->name, deviation, CSC_FAST_CHROMA_MAX_DEVIATION);
+            if (deviation > CSC_FAST_CHROMA_MAX_DEVIATION) {
+                failed++;
+            }
+        }
+        // an even and an odd size, so the border blocks are peeled
+        long bad = check_roi(500, 480);
+        long bad_odd = bad < 0 ? 0 : check_roi(499, 479);
+        printf("roi %s: %ld pixels differ from full conversion\n",
+               csc_backend_kernels()->name, bad < 0 || bad_odd < 0 ? -1 : bad + bad_odd);
+        if (bad != 0 || bad_odd != 0) {
+            failed++;
+        }
+    }
+    printf("%s\n", failed ? "FAILED" : "All checks passed");
+    return failed;
+}
+
+static int parse_sizes(const char *arg, bench_size_t *sizes) {
+    int count = 0;
+
+    while (*arg && count < MAX_SIZES) {
+        int w, h, n;
+        if (sscanf(arg, "%dx%d%n", &w, &h, &n) != 2 || w <= 0 || h <= 0 || (w & 1) || (h & 1)) {
+            return -1;
+        }
+        sizes[count].width = w;
+        sizes[count].height = h;
+        count++;
+        arg += n;
+        if (*arg == ',') {
+            arg++;
+        }
+    }
+    return count;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--sizes=WxH,...] [--warmup=N] [--reps=N] [--threads=N]\n"
+           "       [--format=csv|json] [--output=FILE] [--data-dir=DIR] [--ghz=F]\n"
+           "       %s --check\n"
+           "Default sizes run from 64x48 to 7680x4320. The OriginalCode kernels run\n"
+           "once per input at the size compiled into them. cycles/pixel uses the TSC\n"
+           "on x86 and --ghz elsewhere. --check verifies the deviation bounds of the\n"
+           "approximate kernels and the ROI drivers on every supported backend and\n"
+           "benchmarks nothing.\n",
+           prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "sizes",    required_argument, NULL, 's' },
+        { "warmup",   required_argument, NULL, 'w' },
+        { "reps",     required_argument, NULL, 'r' },
+        { "threads",  required_argument, NULL, 't' },
+        { "format",   required_argument, NULL, 'f' },
+        { "output",   required_argument, NULL, 'o' },
+        { "data-dir", required_argument, NULL, 'd' },
+        { "ghz",      required_argument, NULL, 'g' },
+        { "check",    no_argument,       NULL, 'c' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    bench_config_t cfg = { 1, 9, 0, 0.0, stdout, 0 };
+    bench_size_t sizes[MAX_SIZES];
+    int size_count = sizeof default_sizes / sizeof default_sizes[0];
+    const char *data_dir = ".";
+    const char *output = NULL;
+    int threads = 1;
+    int check = 0;
+    int opt;
+
+    memcpy(sizes, default_sizes, sizeof default_sizes);
+
+    while ((opt = getopt_long(argc, argv, "s:w:r:t:f:o:d:g:ch", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                size_count = parse_sizes(optarg, sizes);
+                if (size_count <= 0) {
+                    fprintf(stderr, "Sizes must be a list of even WxH\n");
+                    return 1;
+                }
+                break;
+            case 'w':
+                cfg.warmup = atoi(optarg);
+                break;
+            case 'r':
+                cfg.reps = atoi(optarg);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'f':
+                if (strcmp(optarg, "json") == 0) {
+                    cfg.json = 1;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    cfg.json = 0;
+                } else {
+                    fprintf(stderr, "Unknown format '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 'g':
+                cfg.ghz = atof(optarg);
+                break;
+            case 'c':
+                check = 1;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (cfg.reps < 1 || cfg.warmup < 0) {
+        fprintf(stderr, "Need at least one repetition\n");
+        return 1;
+    }
+    if (check) {
+        return run_checks() ? 1 : 0;
+    }
+
+#ifdef BENCH_HAVE_TSC
+    if (cfg.ghz <= 0.0) {
+        cfg.ghz = calibrate_tsc_ghz();
+    }
+#endif
+    csc_threads_init(threads);
+
+    // inputs: synthetic, then the bundled images if they can be found
+    bench_input_t inputs[3];
+    int input_count = 0;
+    char path[4096];
+
+    inputs[input_count].name = "synthetic";
+    inputs[input_count].width = 640;
+    inputs[input_count].height = 480;
+    inputs[input_count].rgb24 = make_synthetic(640, 480);
+    if (inputs[input_count].rgb24) {
+        input_count++;
+    }
+
+    snprintf(path, sizeof path, "%s/baboon.data", data_dir);
+    inputs[input_count].name = "baboon";
+    inputs[input_count].width = 500;
+    inputs[input_count].height = 480;
+    inputs[input_count].rgb24 = load_raw(path, 500, 480);
+    if (inputs[input_count].rgb24) {
+        input_count++;
+    } else {
+        fprintf(stderr, "Skipping %s: not found or too short\n", path);
+    }
+
+    snprintf(path, sizeof path, "%s/gradient_rgb.ppm", data_dir);
+    inputs[input_count].name = "gradient";
+    inputs[input_count].rgb24 = load_p6(path, &inputs[input_count].width, &inputs[input_count].height);
+    if (inputs[input_count].rgb24) {
+        input_count++;
+    } else {
+        fprintf(stderr, "Skipping %s: not found or not a P6 file\n", path);
+    }
+
+    if (output) {
+        cfg.out = fopen(output, "w");
+        if (!cfg.out) {
+            fprintf(stderr, "Failed to open %s\n", output);
+            return 1;
+        }
+    }
+
+    emit_header(&cfg);
+    for (int i = 0; i < input_count; i++) {
+        bench_original(&cfg, &inputs[i]);
+        for (int s = 0; s < size_count; s++) {
+            bench_size(&cfg, &inputs[i], sizes[s].width, sizes[s].height);
+        }
+    }
+    emit_footer(&cfg);
+
+    if (output) {
+        fclose(cfg.out);
+    }
+    for (int i = 0; i < input_count; i++) {
+        free(inputs[i].rgb24);
+    }
+    csc_threads_shutdown();
+    return 0;
+}
@@ -0,0 +1,42 @@
+// original_kernels.c
+// The OriginalCode conversions, built into the benchmark. This file is
+// compiled once per routine, e.g.
+//     -DORIG_PREFIX=original_int_ -DRGB_to_YCC_ROUTINE=2 -DYCC_to_RGB_ROUTINE=2
+// and the original globals and entry points get the prefix, so the float
+// and int builds link side by side. The image size stays the one fixed in
+// CSC_global.h.
+#include <stdint.h>
+
+#define ORIG_CAT2(a, b) a##b
+#define ORIG_CAT(a, b) ORIG_CAT2(a, b)
+#define ORIG_NAME(name) ORIG_CAT(ORIG_PREFIX, name)
+
+#define R ORIG_NAME(R)
+#define G ORIG_NAME(G)
+#define B ORIG_NAME(B)
+#define Y ORIG_NAME(Y)
+#define Cb ORIG_NAME(Cb)
+#define Cr ORIG_NAME(Cr)
+#define CSC_RGB_to_YCC ORIG_NAME(RGB_to_YCC)
+#define CSC_YCC_to_RGB ORIG_NAME(YCC_to_RGB)
+
+// the globals are defined here rather than in CSC_main.c
+#define GLOBAL
+#include "../../OriginalCode/CSC_RGB_to_YCC_01.c"
+#include "../../OriginalCode/CSC_YCC_to_RGB_01.c"
+
+void ORIG_NAME(size)(int *width, int *height) {
+    *width = IMAGE_COL_SIZE;
+    *height = IMAGE_ROW_SIZE;
+}
+
+// Fill R, G and B from tightly packed RGB24
+void ORIG_NAME(load)(const uint8_t *rgb24) {
+    for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
+        for (int col = 0; col < IMAGE_COL_SIZE; col++) {
+            R[row][col] = *rgb24++;
+            G[row][col] = *rgb24++;
+            B[row][col] = *rgb24++;
+        }
+    }
+}
@@ -1,105 +1,112 @@
-// optimized_RGB_to_YCC_neon.c
-#include <arm_neon.h>
+// optimized_RGB_to_YCC.c (scalar)
 #include <stdint.h>
 #include "optimized_global.h"
 
-// Sum the 4 int16 lanes and average (>>2)
-static inline uint8_t chroma_downsample_neon(int16x4_t v) {
-    int sum = vget_lane_s16(v, 0)
-            + vget_lane_s16(v, 1)
-            + vget_lane_s16(v, 2)
-            + vget_lane_s16(v, 3);
-    return (uint8_t)(sum >> 2);
+// Fixed-point saturation to clamp values between 0 and 255
+static inline int saturate(int value) {
+    if (value > 255) return 255;
+    if (value < 0) return 0;
+    return value;
 }
 
-static void convert_2x2_block_neon(
+// Convert one pixel; chroma is returned at full precision for averaging
+static inline void convert_pixel(int red, int green, int blue, uint8_t *Y, int *cb, int *cr) {
+    *Y  = (uint8_t)saturate(((16 << K) + C11 * red + C12 * green + C13 * blue) >> K);
+    *cb = saturate(((128 << K) - C21 * red - C22 * green + C23 * blue) >> K);
+    *cr = saturate(((128 << K) + C31 * red - C32 * green - C33 * blue) >> K);
+}
+
+static void convert_2x2_block(
     int row, int col,
-    const uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1]
+    const csc_rgb_image_t *rgb,
+    csc_ycc_image_t *ycc
 ) {
-    // load 2×2 R/G/B into int16x4_t each
-    int16_t r_arr[4] = {
-        R[row  ][col],   R[row  ][col+1],
-        R[row+1][col],   R[row+1][col+1]
-    };
-    int16_t g_arr[4] = {
-        G[row  ][col],   G[row  ][col+1],
-        G[row+1][col],   G[row+1][col+1]
-    };
-    int16_t b_arr[4] = {
-        B[row  ][col],   B[row  ][col+1],
-        B[row+1][col],   B[row+1][col+1]
-    };
-    int16x4_t rv = vld1_s16(r_arr);
-    int16x4_t gv = vld1_s16(g_arr);
-    int16x4_t bv = vld1_s16(b_arr);
+    int cb_sum = 0, cr_sum = 0;
 
-    // widen to 32 bits
-    int32x4_t r32 = vmovl_s16(rv);
-    int32x4_t g32 = vmovl_s16(gv);
-    int32x4_t b32 = vmovl_s16(bv);
+    for (int i = 0; i < 2; i++) {
+        const uint8_t *R = PLANE_ROW(&rgb->R, row + i);
+        const uint8_t *G = PLANE_ROW(&rgb->G, row + i);
+        const uint8_t *B = PLANE_ROW(&rgb->B, row + i);
+        uint8_t *Y = PLANE_ROW(&ycc->Y, row + i);
 
-    // compute Y
-    int32x4_t y32 = vdupq_n_s32(16 << K);
-    y32 = vmlaq_n_s32(y32, r32, C11);
-    y32 = vmlaq_n_s32(y32, g32, C12);
-    y32 = vmlaq_n_s32(y32, b32, C13);
-    y32 = vshrq_n_s32(y32, K);
-    // clamp 0–255
-    y32 = vmaxq_s32(y32, vdupq_n_s32(0));
-    y32 = vminq_s32(y32, vdupq_n_s32(255));
-    int16x4_t y16 = vmovn_s32(y32);
-
-    // scatter Y back
-    Y[row  ][col]   = (uint8_t)vget_lane_s16(y16, 0);
-    Y[row  ][col+1] = (uint8_t)vget_lane_s16(y16, 1);
-    Y[row+1][col]   = (uint8_t)vget_lane_s16(y16, 2);
-    Y[row+1][col+1] = (uint8_t)vget_lane_s16(y16, 3);
+        for (int j = col; j < col + 2; j++) {
+            int cb, cr;
+            convert_pixel(R[j], G[j], B[j], &Y[j], &cb, &cr);
+            cb_sum += cb;
+            cr_sum += cr;
+        }
+    }
 
-    // compute per‐pixel Cb
-    int32x4_t cb32 = vdupq_n_s32(128 << K);
-    cb32 = vmlsq_n_s32(cb32, r32, C21);
-    cb32 = vmlsq_n_s32(cb32, g32, C22);
-    cb32 = vmlaq_n_s32(cb32, b32, C23);
-    cb32 = vshrq_n_s32(cb32, K);
-    // clamp & narrow
-    cb32 = vmaxq_s32(cb32, vdupq_n_s32(0));
-    cb32 = vminq_s32(cb32, vdupq_n_s32(255));
-    int16x4_t cb16 = vmovn_s32(cb32);
+    // downsample each 2×2 chroma group by averaging (truncating)
+    PLANE_ROW(&ycc->Cb, row >> 1)[col >> 1] = (uint8_t)(cb_sum >> 2);
+    PLANE_ROW(&ycc->Cr, row >> 1)[col >> 1] = (uint8_t)(cr_sum >> 2);
+}
 
-    // compute per‐pixel Cr
-    int32x4_t cr32 = vdupq_n_s32(128 << K);
-    cr32 = vmlaq_n_s32(cr32, r32, C31);
-    cr32 = vmlsq_n_s32(cr32, g32, C32);
-    cr32 = vmlsq_n_s32(cr32, b32, C33);
-    cr32 = vshrq_n_s32(cr32, K);
-    cr32 = vmaxq_s32(cr32, vdupq_n_s32(0));
-    cr32 = vminq_s32(cr32, vdupq_n_s32(255));
-    int16x4_t cr16 = vmovn_s32(cr32);
+void optimized_RGB_to_YCC_block_scalar(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    for (int r = 0; r < ycc->Y.height; r += 2) {
+        for (int c = 0; c < ycc->Y.width; c += 2) {
+            convert_2x2_block(r, c, rgb, ycc);
+        }
+    }
+}
 
-    // downsample each 2×2 chroma group (here it's already per‑pixel in the 2×2)
-    uint8_t cb_ds = chroma_downsample_neon(cb16);
-    uint8_t cr_ds = chroma_downsample_neon(cr16);
+// Row-pair kernel: walks both rows of a pair left to right and produces
+// one chroma sample per 2x2 block. Also finishes the SIMD kernels' tails.
+int optimized_RGB_to_YCC_row_scalar(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const uint8_t *R[2] = { R0, R1 };
+    const uint8_t *G[2] = { G0, G1 };
+    const uint8_t *B[2] = { B0, B1 };
+    uint8_t *Y[2] = { Y0, Y1 };
 
-    Cb[row>>1][col>>1] = cb_ds;
-    Cr[row>>1][col>>1] = cr_ds;
+    for (int c = 0; c < width; c += 2) {
+        int cb_sum = 0, cr_sum = 0;
+        for (int i = 0; i < 2; i++) {
+            for (int j = c; j < c + 2; j++) {
+                int cb, cr;
+                convert_pixel(R[i][j], G[i][j], B[i][j], &Y[i][j], &cb, &cr);
+                cb_sum += cb;
+                cr_sum += cr;
+            }
+        }
+        Cb[c >> 1] = (uint8_t)(cb_sum >> 2);
+        Cr[c >> 1] = (uint8_t)(cr_sum >> 2);
+    }
+    return width;
 }
 
-void optimized_RGB_to_YCC(
-    const uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1]
+// Packed RGB24/BGR24 row pair, read in place. order only decides which
+// byte of each triplet is red and which is blue.
+int optimized_packed_to_YCC_row_scalar(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
 ) {
-    for (int r = 0; r < IMAGE_ROW_SIZE; r += 2) {
-        for (int c = 0; c < IMAGE_COL_SIZE; c += 2) {
-            convert_2x2_block_neon(r, c, R, G, B, Y, Cb, Cr);
+    const uint8_t *P[2] = { P0, P1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int c = 0; c < width; c += 2) {
+        int cb_sum = 0, cr_sum = 0;
+        for (int i = 0; i < 2; i++) {
+            for (int j = c; j < c + 2; j++) {
+                const uint8_t *px = P[i] + 3 * j;
+                int cb, cr;
+                convert_pixel(px[r_idx], px[1], px[b_idx], &Y[i][j], &cb, &cr);
+                cb_sum += cb;
+                cr_sum += cr;
+            }
         }
+        Cb[c >> 1] = (uint8_t)(cb_sum >> 2);
+        Cr[c >> 1] = (uint8_t)(cr_sum >> 2);
     }
+    return width;
 }
@@ -1,3 +1,4 @@
+// optimized_YCC_to_RGB.c (scalar)
 #include <stdint.h>
 #include "optimized_global.h"
 
@@ -30,76 +31,151 @@ static void upsample_chroma(
 // Convert a single 2x2 YCC block to RGB
 static void convert_2x2_YCC_block(
     int row, int col,
-    const uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t Cb_ds[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    const uint8_t Cr_ds[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]
+    const csc_ycc_image_t *ycc,
+    csc_rgb_image_t *rgb
 ) {
     uint8_t cb00, cb01, cb10, cb11;
     uint8_t cr00, cr01, cr10, cr11;
 
+    const uint8_t *Y0 = PLANE_ROW(&ycc->Y, row), *Y1 = PLANE_ROW(&ycc->Y, row + 1);
+    uint8_t *R0 = PLANE_ROW(&rgb->R, row), *R1 = PLANE_ROW(&rgb->R, row + 1);
+    uint8_t *G0 = PLANE_ROW(&rgb->G, row), *G1 = PLANE_ROW(&rgb->G, row + 1);
+    uint8_t *B0 = PLANE_ROW(&rgb->B, row), *B1 = PLANE_ROW(&rgb->B, row + 1);
+
+    // The last chroma row and column reuse themselves as their neighbour
+    int c_row = row >> 1, c_col = col >> 1;
+    int c_row_next = (c_row + 1 < ycc->Cb.height) ? c_row + 1 : c_row;
+    int c_col_next = (c_col + 1 < ycc->Cb.width) ? c_col + 1 : c_col;
+    const uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c_row), *Cb1 = PLANE_ROW(&ycc->Cb, c_row_next);
+    const uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c_row), *Cr1 = PLANE_ROW(&ycc->Cr, c_row_next);
+
     // Upsample chroma for this 2x2 region
     upsample_chroma(
-        Cb_ds[row >> 1][col >> 1], Cb_ds[row >> 1][(col >> 1) + 1],
-        Cb_ds[(row >> 1) + 1][col >> 1], Cb_ds[(row >> 1) + 1][(col >> 1) + 1],
+        Cb0[c_col], Cb0[c_col_next],
+        Cb1[c_col], Cb1[c_col_next],
         &cb00, &cb01, &cb10, &cb11
     );
 
     upsample_chroma(
-        Cr_ds[row >> 1][col >> 1], Cr_ds[row >> 1][(col >> 1) + 1],
-        Cr_ds[(row >> 1) + 1][col >> 1], Cr_ds[(row >> 1) + 1][(col >> 1) + 1],
+        Cr0[c_col], Cr0[c_col_next],
+        Cr1[c_col], Cr1[c_col_next],
         &cr00, &cr01, &cr10, &cr11
     );
 
     int y, cb, cr;
 
     // Top-left pixel
-    y  = ((int)Y[row + 0][col + 0]) - 16;
+    y  = ((int)Y0[col + 0]) - 16;
     cb = ((int)cb00) - 128;
     cr = ((int)cr00) - 128;
-    R[row + 0][col + 0] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
-    G[row + 0][col + 0] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
-    B[row + 0][col + 0] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+    R0[col + 0] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    G0[col + 0] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    B0[col + 0] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
 
     // Top-right pixel
-    y  = ((int)Y[row + 0][col + 1]) - 16;
+    y  = ((int)Y0[col + 1]) - 16;
     cb = ((int)cb01) - 128;
     cr = ((int)cr01) - 128;
-    R[row + 0][col + 1] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
-    G[row + 0][col + 1] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
-    B[row + 0][col + 1] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+    R0[col + 1] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    G0[col + 1] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    B0[col + 1] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
 
     // Bottom-left pixel
-    y  = ((int)Y[row + 1][col + 0]) - 16;
+    y  = ((int)Y1[col + 0]) - 16;
     cb = ((int)cb10) - 128;
     cr = ((int)cr10) - 128;
-    R[row + 1][col + 0] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
-    G[row + 1][col + 0] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
-    B[row + 1][col + 0] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+    R1[col + 0] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    G1[col + 0] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    B1[col + 0] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
 
     // Bottom-right pixel
-    y  = ((int)Y[row + 1][col + 1]) - 16;
+    y  = ((int)Y1[col + 1]) - 16;
     cb = ((int)cb11) - 128;
     cr = ((int)cr11) - 128;
-    R[row + 1][col + 1] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
-    G[row + 1][col + 1] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
-    B[row + 1][col + 1] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+    R1[col + 1] = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    G1[col + 1] = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    B1[col + 1] = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
 }
 
 // Top-level function to process entire image
-void optimized_YCC_to_RGB(
-    const uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    const uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]
+void optimized_YCC_to_RGB_block_scalar(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    for (int row = 0; row < ycc->Y.height; row += 2) {
+        for (int col = 0; col < ycc->Y.width; col += 2) {
+            convert_2x2_YCC_block(row, col, ycc, rgb);
+        }
+    }
+}
+
+// Convert one pixel given its upsampled chroma
+static inline void convert_pixel(int y, int cb, int cr, uint8_t *R, uint8_t *G, uint8_t *B) {
+    y  -= 16;
+    cb -= 128;
+    cr -= 128;
+    *R = saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    *G = saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    *B = saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+}
+
+// Row-pair kernel: the chroma is upsampled as the row is walked instead of
+// per 2x2 block. Also finishes the SIMD kernels' tails.
+int optimized_YCC_to_RGB_row_scalar(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
 ) {
-    for (int row = 0; row < IMAGE_ROW_SIZE; row += 2) {
-        for (int col = 0; col < IMAGE_COL_SIZE; col += 2) {
-            convert_2x2_YCC_block(row, col, Y, Cb, Cr, R, G, B);
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        uint8_t cb[4], cr[4];
+        int col = c << 1;
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], &cb[0], &cb[1], &cb[2], &cb[3]);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], &cr[0], &cr[1], &cr[2], &cr[3]);
+
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = col + (i & 1);
+            convert_pixel(Y[r][x], cb[i], cr[i], &R[r][x], &G[r][x], &B[r][x]);
+        }
+    }
+    return width;
+}
+
+// Same as optimized_YCC_to_RGB_row_scalar but writes packed RGB24/BGR24
+int optimized_YCC_to_packed_row_scalar(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        uint8_t cb[4], cr[4];
+        int col = c << 1;
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], &cb[0], &cb[1], &cb[2], &cb[3]);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], &cr[0], &cr[1], &cr[2], &cr[3]);
+
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = col + (i & 1);
+            uint8_t *px = P[r] + 3 * x;
+            convert_pixel(Y[r][x], cb[i], cr[i], &px[r_idx], &px[1], &px[b_idx]);
         }
     }
+    return width;
 }
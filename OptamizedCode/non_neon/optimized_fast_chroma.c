@@ -0,0 +1,165 @@
+// optimized_fast_chroma.c (scalar)
+// Fast-chroma RGB->YCC: Y per pixel, Cb and Cr once per 2x2 block from the
+// block's summed R, G and B. The SIMD kernels use the same arithmetic and
+// give identical output. csc_fast_chroma_check measures the difference
+// from the per-pixel-then-average kernels.
+#include <stdint.h>
+#include <stdlib.h>
+#include "optimized_global.h"
+
+static inline uint8_t convert_luma(int red, int green, int blue) {
+    return (uint8_t)(((16 << K) + C11 * red + C12 * green + C13 * blue) >> K);
+}
+
+// Chroma of the average of a 2x2 block from its channel sums (at most
+// 1020). The average pixel is an 8-bit colour, so the result is always
+// within 16..240 and is never clamped.
+static inline void convert_chroma_sum(int r_sum, int g_sum, int b_sum, uint8_t *Cb, uint8_t *Cr) {
+    *Cb = (uint8_t)(((128 << (K + 2)) - C21 * r_sum - C22 * g_sum + C23 * b_sum) >> (K + 2));
+    *Cr = (uint8_t)(((128 << (K + 2)) + C31 * r_sum - C32 * g_sum - C33 * b_sum) >> (K + 2));
+}
+
+void optimized_RGB_to_YCC_block_fast_chroma_scalar(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    for (int r = 0; r < ycc->Y.height; r += 2) {
+        for (int c = 0; c < ycc->Y.width; c += 2) {
+            int r_sum = 0, g_sum = 0, b_sum = 0;
+
+            for (int i = 0; i < 2; i++) {
+                const uint8_t *R = PLANE_ROW(&rgb->R, r + i);
+                const uint8_t *G = PLANE_ROW(&rgb->G, r + i);
+                const uint8_t *B = PLANE_ROW(&rgb->B, r + i);
+                uint8_t *Y = PLANE_ROW(&ycc->Y, r + i);
+
+                for (int j = c; j < c + 2; j++) {
+                    Y[j] = convert_luma(R[j], G[j], B[j]);
+                    r_sum += R[j];
+                    g_sum += G[j];
+                    b_sum += B[j];
+                }
+            }
+            convert_chroma_sum(r_sum, g_sum, b_sum,
+                               &PLANE_ROW(&ycc->Cb, r >> 1)[c >> 1], &PLANE_ROW(&ycc->Cr, r >> 1)[c >> 1]);
+        }
+    }
+}
+
+int optimized_RGB_to_YCC_row_fast_chroma(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const uint8_t *R[2] = { R0, R1 };
+    const uint8_t *G[2] = { G0, G1 };
+    const uint8_t *B[2] = { B0, B1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+
+    for (int c = 0; c < width; c += 2) {
+        int r_sum = 0, g_sum = 0, b_sum = 0;
+        for (int i = 0; i < 2; i++) {
+            for (int j = c; j < c + 2; j++) {
+                Y[i][j] = convert_luma(R[i][j], G[i][j], B[i][j]);
+                r_sum += R[i][j];
+                g_sum += G[i][j];
+                b_sum += B[i][j];
+            }
+        }
+        convert_chroma_sum(r_sum, g_sum, b_sum, &Cb[c >> 1], &Cr[c >> 1]);
+    }
+    return width;
+}
+
+int optimized_packed_to_YCC_row_fast_chroma(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const uint8_t *P[2] = { P0, P1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int c = 0; c < width; c += 2) {
+        int r_sum = 0, g_sum = 0, b_sum = 0;
+        for (int i = 0; i < 2; i++) {
+            for (int j = c; j < c + 2; j++) {
+                const uint8_t *px = P[i] + 3 * j;
+                Y[i][j] = convert_luma(px[r_idx], px[1], px[b_idx]);
+                r_sum += px[r_idx];
+                g_sum += px[1];
+                b_sum += px[b_idx];
+            }
+        }
+        convert_chroma_sum(r_sum, g_sum, b_sum, &Cb[c >> 1], &Cr[c >> 1]);
+    }
+    return width;
+}
+
+// Random row pairs (a fixed xorshift sequence, so every run checks the
+// same blocks) through both kernels of the set and the per-pixel scalar
+// kernels. Y must match exactly; any Y difference is reported as 255.
+// The width is a multiple of every kernel's step, so the SIMD kernels
+// convert all of it themselves.
+#define CHECK_WIDTH 256
+#define CHECK_PAIRS 4096
+
+static int max_difference(const uint8_t *a, const uint8_t *b, int n) {
+    int max_dev = 0;
+
+    for (int x = 0; x < n; x++) {
+        int d = abs((int)a[x] - (int)b[x]);
+        if (d > max_dev) {
+            max_dev = d;
+        }
+    }
+    return max_dev;
+}
+
+int csc_fast_chroma_check(const csc_backend_kernels_t *kernels) {
+    uint8_t rgb[2][3][CHECK_WIDTH], packed[2][3 * CHECK_WIDTH];
+    uint8_t Y[2][2][CHECK_WIDTH], Cb[2][CHECK_WIDTH / 2], Cr[2][CHECK_WIDTH / 2]; // [exact, fast]
+    uint32_t state = 2463534242u;
+    int max_dev = 0;
+
+    for (int pair = 0; pair < CHECK_PAIRS; pair++) {
+        for (int i = 0; i < 2; i++) {
+            for (int x = 0; x < CHECK_WIDTH; x++) {
+                for (int ch = 0; ch < 3; ch++) {
+                    state ^= state << 13;
+                    state ^= state >> 17;
+                    state ^= state << 5;
+                    rgb[i][ch][x] = packed[i][3 * x + ch] = (uint8_t)(state >> 24);
+                }
+            }
+        }
+        optimized_RGB_to_YCC_row_scalar(rgb[0][0], rgb[1][0], rgb[0][1], rgb[1][1], rgb[0][2], rgb[1][2],
+                                        Y[0][0], Y[0][1], Cb[0], Cr[0], CHECK_WIDTH);
+
+        for (int packed_kernel = 0; packed_kernel < 2; packed_kernel++) {
+            int done;
+            if (packed_kernel) {
+                done = kernels->packed_to_ycc_row(packed[0], packed[1], CSC_ORDER_RGB,
+                                                  Y[1][0], Y[1][1], Cb[1], Cr[1], CHECK_WIDTH);
+            } else {
+                done = kernels->rgb_to_ycc_row(rgb[0][0], rgb[1][0], rgb[0][1], rgb[1][1],
+                                               rgb[0][2], rgb[1][2], Y[1][0], Y[1][1],
+                                               Cb[1], Cr[1], CHECK_WIDTH);
+            }
+            if (max_difference(Y[0][0], Y[1][0], done) || max_difference(Y[0][1], Y[1][1], done)) {
+                return 255;
+            }
+            int d = max_difference(Cb[0], Cb[1], done >> 1);
+            if (d > max_dev) {
+                max_dev = d;
+            }
+            d = max_difference(Cr[0], Cr[1], done >> 1);
+            if (d > max_dev) {
+                max_dev = d;
+            }
+        }
+    }
+    return max_dev;
+}
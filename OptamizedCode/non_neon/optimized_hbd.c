@@ -0,0 +1,96 @@
+// optimized_hbd.c (scalar)
+// Row-pair kernels for 10- to 16-bit samples in uint16_t planes. Same
+// structure as the 8-bit row kernels, with the K16 coefficients and the
+// offsets and saturation limit scaled to the bit depth.
+#include <stdint.h>
+#include "optimized_global.h"
+
+static inline int saturate16(int value, int max) {
+    if (value > max) return max;
+    if (value < 0) return 0;
+    return value;
+}
+
+// Y and full-precision chroma of one pixel. Valid input cannot leave the
+// sample range, so nothing is clamped.
+static inline void convert_pixel_to_ycc(int32_t y_off, int32_t c_off, int red, int green, int blue,
+                                        uint16_t *Y, int *cb, int *cr) {
+    *Y  = (uint16_t)((y_off + C16_11 * red + C16_12 * green + C16_13 * blue) >> K16);
+    *cb = (c_off - C16_21 * red - C16_22 * green + C16_23 * blue) >> K16;
+    *cr = (c_off + C16_31 * red - C16_32 * green - C16_33 * blue) >> K16;
+}
+
+int optimized_RGB_to_YCC_row16_scalar(
+    const uint16_t *R0, const uint16_t *R1,
+    const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1,
+    uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr,
+    int width, int bits
+) {
+    const uint16_t *R[2] = { R0, R1 };
+    const uint16_t *G[2] = { G0, G1 };
+    const uint16_t *B[2] = { B0, B1 };
+    uint16_t *Y[2] = { Y0, Y1 };
+    const int32_t y_off = (int32_t)(16 << (bits - 8)) << K16;
+    const int32_t c_off = (int32_t)(128 << (bits - 8)) << K16;
+
+    for (int c = 0; c < width; c += 2) {
+        int cb_sum = 0, cr_sum = 0;
+        for (int i = 0; i < 2; i++) {
+            for (int j = c; j < c + 2; j++) {
+                int cb, cr;
+                convert_pixel_to_ycc(y_off, c_off, R[i][j], G[i][j], B[i][j], &Y[i][j], &cb, &cr);
+                cb_sum += cb;
+                cr_sum += cr;
+            }
+        }
+        Cb[c >> 1] = (uint16_t)(cb_sum >> 2);
+        Cr[c >> 1] = (uint16_t)(cr_sum >> 2);
+    }
+    return width;
+}
+
+int optimized_YCC_to_RGB_row16_scalar(
+    const uint16_t *Y0, const uint16_t *Y1,
+    const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1,
+    uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1,
+    uint16_t *B0, uint16_t *B1,
+    int width, int bits
+) {
+    const uint16_t *Y[2] = { Y0, Y1 };
+    uint16_t *R[2] = { R0, R1 };
+    uint16_t *G[2] = { G0, G1 };
+    uint16_t *B[2] = { B0, B1 };
+    const int y_off = 16 << (bits - 8);
+    const int c_off = 128 << (bits - 8);
+    const int max = (1 << bits) - 1;
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        int cb[4], cr[4];
+
+        // upsampled as in the 8-bit kernels, in int so the sums cannot wrap
+        cb[0] = Cb0[c];
+        cb[1] = (Cb0[c] + Cb0[n]) >> 1;
+        cb[2] = (Cb0[c] + Cb1[c]) >> 1;
+        cb[3] = (Cb0[c] + Cb0[n] + Cb1[c] + Cb1[n]) >> 2;
+        cr[0] = Cr0[c];
+        cr[1] = (Cr0[c] + Cr0[n]) >> 1;
+        cr[2] = (Cr0[c] + Cr1[c]) >> 1;
+        cr[3] = (Cr0[c] + Cr0[n] + Cr1[c] + Cr1[n]) >> 2;
+
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = 2 * c + (i & 1);
+            int luma = D16_1 * (Y[r][x] - y_off) + (1 << (K16 - 1));
+            int u = cb[i] - c_off, v = cr[i] - c_off;
+            R[r][x] = (uint16_t)saturate16((luma + D16_2 * v) >> K16, max);
+            G[r][x] = (uint16_t)saturate16((luma - D16_3 * v - D16_4 * u) >> K16, max);
+            B[r][x] = (uint16_t)saturate16((luma + D16_5 * u) >> K16, max);
+        }
+    }
+    return width;
+}
@@ -0,0 +1,27 @@
+// optimized_luma.c (scalar)
+// Luma-only RGB->Y: the Y of the full conversion, with no chroma work.
+// The SIMD luma kernels leave their tails to these.
+#include <stdint.h>
+#include "optimized_global.h"
+
+static inline uint8_t convert_luma(int red, int green, int blue) {
+    return (uint8_t)(((16 << K) + C11 * red + C12 * green + C13 * blue) >> K);
+}
+
+int optimized_RGB_to_Y_row_scalar(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width) {
+    for (int c = 0; c < width; c++) {
+        Y[c] = convert_luma(R[c], G[c], B[c]);
+    }
+    return width;
+}
+
+int optimized_packed_to_Y_row_scalar(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width) {
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int c = 0; c < width; c++) {
+        const uint8_t *px = P + 3 * c;
+        Y[c] = convert_luma(px[r_idx], px[1], px[b_idx]);
+    }
+    return width;
+}
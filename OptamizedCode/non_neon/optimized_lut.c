@@ -0,0 +1,178 @@
+// optimized_lut.c (scalar)
+// Table-driven conversion: every coefficient product is looked up in a
+// 256-entry table per channel instead of being multiplied, as libjpeg
+// does. The tables hold the same fixed-point products as the multiply
+// kernels, so both give identical output.
+#include <pthread.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+static csc_lut_t lut;
+static pthread_once_t lut_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (int v = 0; v < 256; v++) {
+        // the offsets ride along in the R tables
+        lut.y_r[v]  = (16 << K) + C11 * v;
+        lut.y_g[v]  = C12 * v;
+        lut.y_b[v]  = C13 * v;
+        lut.cb_r[v] = (128 << K) - C21 * v;
+        lut.cb_g[v] = -C22 * v;
+        lut.cb_b[v] = C23 * v;
+        lut.cr_r[v] = (128 << K) + C31 * v;
+        lut.cr_g[v] = -C32 * v;
+        lut.cr_b[v] = -C33 * v;
+
+        // and the rounding constant in the Y table
+        lut.y[v]    = D1 * (v - 16) + (1 << (K - 1));
+        lut.r_cr[v] = D2 * (v - 128);
+        lut.g_cr[v] = -D3 * (v - 128);
+        lut.g_cb[v] = -D4 * (v - 128);
+        lut.b_cb[v] = D5 * (v - 128);
+    }
+    for (int i = 0; i < CSC_LUT_RANGE_SIZE; i++) {
+        int v = i - CSC_LUT_RANGE_OFFSET;
+        lut.range[i] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+    }
+}
+
+const csc_lut_t *csc_lut(void) {
+    pthread_once(&lut_once, build_tables);
+    return &lut;
+}
+
+// Y and full-precision chroma of one pixel. The products of 8-bit inputs
+// stay inside 0..255 after the shift, so nothing needs clamping.
+static inline void rgb_to_ycc_pixel(const csc_lut_t *t, int r, int g, int b,
+                                    uint8_t *Y, int *cb, int *cr) {
+    *Y  = (uint8_t)((t->y_r[r] + t->y_g[g] + t->y_b[b]) >> K);
+    *cb = (t->cb_r[r] + t->cb_g[g] + t->cb_b[b]) >> K;
+    *cr = (t->cr_r[r] + t->cr_g[g] + t->cr_b[b]) >> K;
+}
+
+static inline void ycc_to_rgb_pixel(const csc_lut_t *t, int y, int cb, int cr,
+                                    uint8_t *R, uint8_t *G, uint8_t *B) {
+    const uint8_t *range = t->range + CSC_LUT_RANGE_OFFSET;
+    int luma = t->y[y];
+
+    *R = range[(luma + t->r_cr[cr]) >> K];
+    *G = range[(luma + t->g_cr[cr] + t->g_cb[cb]) >> K];
+    *B = range[(luma + t->b_cb[cb]) >> K];
+}
+
+// Chroma of the 2x2 neighbourhood upsampled as in the multiply kernels
+static inline void upsample_chroma(int c00, int c01, int c10, int c11, int up[4]) {
+    up[0] = c00;
+    up[1] = (c00 + c01) >> 1;
+    up[2] = (c00 + c10) >> 1;
+    up[3] = (c00 + c01 + c10 + c11) >> 2;
+}
+
+int optimized_RGB_to_YCC_row_lut(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+
+    for (int c = 0; c < width; c += 2) {
+        int cb[4], cr[4];
+        rgb_to_ycc_pixel(t, R0[c],     G0[c],     B0[c],     &Y0[c],     &cb[0], &cr[0]);
+        rgb_to_ycc_pixel(t, R0[c + 1], G0[c + 1], B0[c + 1], &Y0[c + 1], &cb[1], &cr[1]);
+        rgb_to_ycc_pixel(t, R1[c],     G1[c],     B1[c],     &Y1[c],     &cb[2], &cr[2]);
+        rgb_to_ycc_pixel(t, R1[c + 1], G1[c + 1], B1[c + 1], &Y1[c + 1], &cb[3], &cr[3]);
+        Cb[c >> 1] = (uint8_t)((cb[0] + cb[1] + cb[2] + cb[3]) >> 2);
+        Cr[c >> 1] = (uint8_t)((cr[0] + cr[1] + cr[2] + cr[3]) >> 2);
+    }
+    return width;
+}
+
+int optimized_YCC_to_RGB_row_lut(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        int cb[4], cr[4];
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], cb);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], cr);
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = 2 * c + (i & 1);
+            ycc_to_rgb_pixel(t, Y[r][x], cb[i], cr[i], &R[r][x], &G[r][x], &B[r][x]);
+        }
+    }
+    return width;
+}
+
+int optimized_packed_to_YCC_row_lut(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const uint8_t *P[2] = { P0, P1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int c = 0; c < width; c += 2) {
+        int cb_sum = 0, cr_sum = 0;
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = c + (i & 1);
+            const uint8_t *px = P[r] + 3 * x;
+            int cb, cr;
+            rgb_to_ycc_pixel(t, px[r_idx], px[1], px[b_idx], &Y[r][x], &cb, &cr);
+            cb_sum += cb;
+            cr_sum += cr;
+        }
+        Cb[c >> 1] = (uint8_t)(cb_sum >> 2);
+        Cr[c >> 1] = (uint8_t)(cr_sum >> 2);
+    }
+    return width;
+}
+
+int optimized_YCC_to_packed_row_lut(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        int cb[4], cr[4];
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], cb);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], cr);
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = 2 * c + (i & 1);
+            uint8_t *px = P[r] + 3 * x;
+            ycc_to_rgb_pixel(t, Y[r][x], cb[i], cr[i], &px[r_idx], &px[1], &px[b_idx]);
+        }
+    }
+    return width;
+}
@@ -0,0 +1,134 @@
+// optimized_narrow.c (scalar)
+// Narrow-arithmetic YCC->RGB: the 16-bit-lane formulation of the SIMD
+// narrow kernels, computed one pixel at a time. It gives bit-identical
+// output to them and is what csc_narrow_check measures the SIMD kernels'
+// deviation against the 32-bit kernels with.
+#include <stdint.h>
+#include <stdlib.h>
+#include "optimized_global.h"
+
+static inline uint8_t saturate(int value) {
+    if (value > 255) return 255;
+    if (value < 0) return 0;
+    return (uint8_t)value;
+}
+
+// pmulhrsw / vqrdmulh on one lane: (a * b) / 2^15, rounded
+static inline int mulhrs(int a, int b) {
+    return (a * b + (1 << 14)) >> 15;
+}
+
+static inline void narrow_pixel(int y, int cb, int cr, uint8_t *R, uint8_t *G, uint8_t *B) {
+    int luma = mulhrs(y << 7, D1 << KN);
+    *R = saturate((luma + mulhrs(cr << 7, D2 << KN) + NARROW_R_BIAS) >> KN);
+    *G = saturate((luma - mulhrs(cr << 7, D3 << KN) - mulhrs(cb << 7, D4 << KN) + NARROW_G_BIAS) >> KN);
+    *B = saturate((luma + mulhrs(cb << 7, D5 << KN) + NARROW_B_BIAS) >> KN);
+}
+
+// Chroma of the 2x2 neighbourhood upsampled as in the multiply kernels
+static inline void upsample_chroma(int c00, int c01, int c10, int c11, int up[4]) {
+    up[0] = c00;
+    up[1] = (c00 + c01) >> 1;
+    up[2] = (c00 + c10) >> 1;
+    up[3] = (c00 + c01 + c10 + c11) >> 2;
+}
+
+int optimized_YCC_to_RGB_row_narrow(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        int cb[4], cr[4];
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], cb);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], cr);
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = 2 * c + (i & 1);
+            narrow_pixel(Y[r][x], cb[i], cr[i], &R[r][x], &G[r][x], &B[r][x]);
+        }
+    }
+    return width;
+}
+
+int optimized_YCC_to_packed_row_narrow(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int c_width = width >> 1;
+
+    for (int c = 0; c < c_width; c++) {
+        int n = (c + 1 < c_width) ? c + 1 : c;
+        int cb[4], cr[4];
+
+        upsample_chroma(Cb0[c], Cb0[n], Cb1[c], Cb1[n], cb);
+        upsample_chroma(Cr0[c], Cr0[n], Cr1[c], Cr1[n], cr);
+        for (int i = 0; i < 4; i++) {
+            int r = i >> 1, x = 2 * c + (i & 1);
+            uint8_t *px = P[r] + 3 * x;
+            narrow_pixel(Y[r][x], cb[i], cr[i], &px[r_idx], &px[1], &px[b_idx]);
+        }
+    }
+    return width;
+}
+
+// Every Y, Cb, Cr triple: one row pair per (Cb, Cr) pair, with constant
+// chroma rows so upsampling passes the values through unchanged, and Y
+// running through 0..255. Only the columns the kernel converts itself are
+// compared, which is at least 256 for every kernel at this width.
+#define CHECK_WIDTH 320
+
+int csc_narrow_check(const csc_backend_kernels_t *kernels) {
+    uint8_t Y[CHECK_WIDTH], Cb[CHECK_WIDTH / 2], Cr[CHECK_WIDTH / 2];
+    uint8_t out[2][3][2][CHECK_WIDTH]; // [exact, narrow][R, G, B][row]
+    int max_dev = 0;
+
+    for (int x = 0; x < CHECK_WIDTH; x++) {
+        Y[x] = (uint8_t)x;
+    }
+    for (int cb = 0; cb < 256; cb++) {
+        for (int x = 0; x < CHECK_WIDTH / 2; x++) {
+            Cb[x] = (uint8_t)cb;
+        }
+        for (int cr = 0; cr < 256; cr++) {
+            for (int x = 0; x < CHECK_WIDTH / 2; x++) {
+                Cr[x] = (uint8_t)cr;
+            }
+            optimized_YCC_to_RGB_row_scalar(Y, Y, Cb, Cb, Cr, Cr,
+                                            out[0][0][0], out[0][0][1], out[0][1][0],
+                                            out[0][1][1], out[0][2][0], out[0][2][1], CHECK_WIDTH);
+            int done = kernels->ycc_to_rgb_row(Y, Y, Cb, Cb, Cr, Cr,
+                                               out[1][0][0], out[1][0][1], out[1][1][0],
+                                               out[1][1][1], out[1][2][0], out[1][2][1], CHECK_WIDTH);
+            for (int ch = 0; ch < 3; ch++) {
+                for (int row = 0; row < 2; row++) {
+                    for (int x = 0; x < done; x++) {
+                        int d = abs((int)out[0][ch][row][x] - (int)out[1][ch][row][x]);
+                        if (d > max_dev) {
+                            max_dev = d;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return max_dev;
+}
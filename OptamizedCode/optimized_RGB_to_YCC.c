@@ -12,27 +12,31 @@ static inline uint8_t chroma_downsample_neon(int16x4_t v) {
     return (uint8_t)(sum >> 2);
 }
 
-static void convert_2x2_block_neon(
+// fast: chroma once from the block's summed R, G and B instead of per
+// pixel (see non_neon/optimized_fast_chroma.c)
+static inline void convert_2x2_block_neon(
     int row, int col,
-    const uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Cb[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    uint8_t Cr[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1]
+    const csc_rgb_image_t *rgb,
+    csc_ycc_image_t *ycc,
+    int fast
 ) {
+    const uint8_t *R0 = PLANE_ROW(&rgb->R, row), *R1 = PLANE_ROW(&rgb->R, row + 1);
+    const uint8_t *G0 = PLANE_ROW(&rgb->G, row), *G1 = PLANE_ROW(&rgb->G, row + 1);
+    const uint8_t *B0 = PLANE_ROW(&rgb->B, row), *B1 = PLANE_ROW(&rgb->B, row + 1);
+    uint8_t *Y0 = PLANE_ROW(&ycc->Y, row), *Y1 = PLANE_ROW(&ycc->Y, row + 1);
+
     // load a 2×2 RGB patch into 4‑lane vectors
     int16_t r_vals[4] = {
-        R[row  ][col],   R[row  ][col+1],
-        R[row+1][col],   R[row+1][col+1]
+        R0[col],   R0[col+1],
+        R1[col],   R1[col+1]
     };
     int16_t g_vals[4] = {
-        G[row  ][col],   G[row  ][col+1],
-        G[row+1][col],   G[row+1][col+1]
+        G0[col],   G0[col+1],
+        G1[col],   G1[col+1]
     };
     int16_t b_vals[4] = {
-        B[row  ][col],   B[row  ][col+1],
-        B[row+1][col],   B[row+1][col+1]
+        B0[col],   B0[col+1],
+        B1[col],   B1[col+1]
     };
     int16x4_t rv = vld1_s16(r_vals);
     int16x4_t gv = vld1_s16(g_vals);
@@ -54,10 +58,21 @@ static void convert_2x2_block_neon(
     int16x4_t y16 = vmovn_s32(y32);
 
     // scatter Y
-    Y[row  ][col]   = vget_lane_s16(y16, 0);
-    Y[row  ][col+1] = vget_lane_s16(y16, 1);
-    Y[row+1][col]   = vget_lane_s16(y16, 2);
-    Y[row+1][col+1] = vget_lane_s16(y16, 3);
+    Y0[col]   = vget_lane_s16(y16, 0);
+    Y0[col+1] = vget_lane_s16(y16, 1);
+    Y1[col]   = vget_lane_s16(y16, 2);
+    Y1[col+1] = vget_lane_s16(y16, 3);
+
+    if (fast) {
+        int r_sum = r_vals[0] + r_vals[1] + r_vals[2] + r_vals[3];
+        int g_sum = g_vals[0] + g_vals[1] + g_vals[2] + g_vals[3];
+        int b_sum = b_vals[0] + b_vals[1] + b_vals[2] + b_vals[3];
+        PLANE_ROW(&ycc->Cb, row >> 1)[col >> 1] =
+            (uint8_t)(((128 << (K + 2)) - C21 * r_sum - C22 * g_sum + C23 * b_sum) >> (K + 2));
+        PLANE_ROW(&ycc->Cr, row >> 1)[col >> 1] =
+            (uint8_t)(((128 << (K + 2)) + C31 * r_sum - C32 * g_sum - C33 * b_sum) >> (K + 2));
+        return;
+    }
 
     // per-pixel Cb
     int32x4_t cb32 = vdupq_n_s32(128 << K);
@@ -83,21 +98,248 @@ static void convert_2x2_block_neon(
     uint8_t cb_ds = chroma_downsample_neon(cb16);
     uint8_t cr_ds = chroma_downsample_neon(cr16);
 
-    Cb[row>>1][col>>1] = cb_ds;
-    Cr[row>>1][col>>1] = cr_ds;
+    PLANE_ROW(&ycc->Cb, row >> 1)[col >> 1] = cb_ds;
+    PLANE_ROW(&ycc->Cr, row >> 1)[col >> 1] = cr_ds;
+}
+
+void optimized_RGB_to_YCC_block_neon(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    for (int r = 0; r < ycc->Y.height; r += 2) {
+        for (int c = 0; c < ycc->Y.width; c += 2) {
+            convert_2x2_block_neon(r, c, rgb, ycc, 0);
+        }
+    }
+}
+
+void optimized_RGB_to_YCC_block_fast_chroma_neon(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    for (int r = 0; r < ycc->Y.height; r += 2) {
+        for (int c = 0; c < ycc->Y.width; c += 2) {
+            convert_2x2_block_neon(r, c, rgb, ycc, 1);
+        }
+    }
+}
+
+// Y of 16 pixels, stored: (16<<K + C11·R + C12·G + C13·B) >> K
+static inline void convert_16_luma_neon(uint8x16_t r, uint8x16_t g, uint8x16_t b, uint8_t *Y) {
+    const uint16x8_t y_bias = vdupq_n_u16(16 << K);
+
+    uint16x8_t y_lo = vmlal_u8(y_bias, vget_low_u8(r), vdup_n_u8(C11));
+    uint16x8_t y_hi = vmlal_u8(y_bias, vget_high_u8(r), vdup_n_u8(C11));
+    y_lo = vmlal_u8(y_lo, vget_low_u8(g), vdup_n_u8(C12));
+    y_hi = vmlal_u8(y_hi, vget_high_u8(g), vdup_n_u8(C12));
+    y_lo = vmlal_u8(y_lo, vget_low_u8(b), vdup_n_u8(C13));
+    y_hi = vmlal_u8(y_hi, vget_high_u8(b), vdup_n_u8(C13));
+    vst1q_u8(Y, vcombine_u8(vshrn_n_u16(y_lo, K), vshrn_n_u16(y_hi, K)));
+}
+
+// Fast chroma: Y of 16 pixels, with R, G and B summed over horizontal
+// pairs into rgb_sum (R, G, B) instead of converted per pixel
+static inline void convert_16_luma_sum_neon(uint8x16_t r, uint8x16_t g, uint8x16_t b, uint8_t *Y,
+                                            uint16x8_t rgb_sum[3]) {
+    convert_16_luma_neon(r, g, b, Y);
+    rgb_sum[0] = vpadalq_u8(rgb_sum[0], r);
+    rgb_sum[1] = vpadalq_u8(rgb_sum[1], g);
+    rgb_sum[2] = vpadalq_u8(rgb_sum[2], b);
+}
+
+// Cb and Cr of 8 blocks from their channel sums (at most 1020) in 32-bit
+// lanes. The positive terms go first, so the unsigned sums never wrap.
+static inline void store_chroma_sums_neon(const uint16x8_t rgb_sum[3], uint8_t *Cb, uint8_t *Cr) {
+    const uint32x4_t bias = vdupq_n_u32(128 << (K + 2));
+    uint16x4_t r[2] = { vget_low_u16(rgb_sum[0]), vget_high_u16(rgb_sum[0]) };
+    uint16x4_t g[2] = { vget_low_u16(rgb_sum[1]), vget_high_u16(rgb_sum[1]) };
+    uint16x4_t b[2] = { vget_low_u16(rgb_sum[2]), vget_high_u16(rgb_sum[2]) };
+    uint16x4_t cb[2], cr[2];
+
+    for (int h = 0; h < 2; h++) {
+        uint32x4_t cb32 = vmlal_n_u16(bias, b[h], C23);
+        cb32 = vmlsl_n_u16(cb32, r[h], C21);
+        cb32 = vmlsl_n_u16(cb32, g[h], C22);
+        cb[h] = vshrn_n_u32(cb32, K + 2);
+
+        uint32x4_t cr32 = vmlal_n_u16(bias, r[h], C31);
+        cr32 = vmlsl_n_u16(cr32, g[h], C32);
+        cr32 = vmlsl_n_u16(cr32, b[h], C33);
+        cr[h] = vshrn_n_u32(cr32, K + 2);
+    }
+    vst1_u8(Cb, vmovn_u16(vcombine_u16(cb[0], cb[1])));
+    vst1_u8(Cr, vmovn_u16(vcombine_u16(cr[0], cr[1])));
+}
+
+// Convert 16 pixels of one row: store Y and add the per-pixel chroma,
+// summed over horizontal pairs, into cb_sum/cr_sum. All three equations
+// stay within 0..65535 when evaluated with the positive terms first, so
+// the products are formed directly in 16-bit lanes with widening
+// multiplies and the results never need clamping.
+static inline void convert_16_pixels_neon(
+    uint8x16_t r, uint8x16_t g, uint8x16_t b,
+    uint8_t *Y, uint16x8_t *cb_sum, uint16x8_t *cr_sum
+) {
+    const uint8x8_t c21 = vdup_n_u8(C21), c22 = vdup_n_u8(C22), c23 = vdup_n_u8(C23);
+    const uint8x8_t c31 = vdup_n_u8(C31), c32 = vdup_n_u8(C32), c33 = vdup_n_u8(C33);
+    const uint16x8_t c_bias = vdupq_n_u16(128 << K);
+
+    uint8x8_t r_lo = vget_low_u8(r), r_hi = vget_high_u8(r);
+    uint8x8_t g_lo = vget_low_u8(g), g_hi = vget_high_u8(g);
+    uint8x8_t b_lo = vget_low_u8(b), b_hi = vget_high_u8(b);
+
+    convert_16_luma_neon(r, g, b, Y);
+
+    // Cb = (128<<K - C21·R - C22·G + C23·B) >> K
+    uint16x8_t cb_lo = vmlal_u8(c_bias, b_lo, c23);
+    uint16x8_t cb_hi = vmlal_u8(c_bias, b_hi, c23);
+    cb_lo = vmlsl_u8(cb_lo, r_lo, c21);
+    cb_hi = vmlsl_u8(cb_hi, r_hi, c21);
+    cb_lo = vmlsl_u8(cb_lo, g_lo, c22);
+    cb_hi = vmlsl_u8(cb_hi, g_hi, c22);
+
+    // Cr = (128<<K + C31·R - C32·G - C33·B) >> K
+    uint16x8_t cr_lo = vmlal_u8(c_bias, r_lo, c31);
+    uint16x8_t cr_hi = vmlal_u8(c_bias, r_hi, c31);
+    cr_lo = vmlsl_u8(cr_lo, g_lo, c32);
+    cr_hi = vmlsl_u8(cr_hi, g_hi, c32);
+    cr_lo = vmlsl_u8(cr_lo, b_lo, c33);
+    cr_hi = vmlsl_u8(cr_hi, b_hi, c33);
+
+    // accumulate horizontal pairs
+    *cb_sum = vpadalq_u8(*cb_sum, vcombine_u8(vshrn_n_u16(cb_lo, K), vshrn_n_u16(cb_hi, K)));
+    *cr_sum = vpadalq_u8(*cr_sum, vcombine_u8(vshrn_n_u16(cr_lo, K), vshrn_n_u16(cr_hi, K)));
+}
+
+// Convert one row pair, 16 pixels per iteration, with contiguous loads.
+// Chroma is averaged over each 2x2 block with pairwise adds instead of
+// lane extraction.
+// fast is a constant at every call, so each kernel inlines one way of
+// computing chroma.
+static inline int rgb_to_ycc_row_neon(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
+) {
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        if (fast) {
+            uint16x8_t rgb_sum[3] = { vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0) };
+
+            convert_16_luma_sum_neon(vld1q_u8(R0 + col), vld1q_u8(G0 + col), vld1q_u8(B0 + col),
+                                     Y0 + col, rgb_sum);
+            convert_16_luma_sum_neon(vld1q_u8(R1 + col), vld1q_u8(G1 + col), vld1q_u8(B1 + col),
+                                     Y1 + col, rgb_sum);
+            store_chroma_sums_neon(rgb_sum, Cb + (col >> 1), Cr + (col >> 1));
+            continue;
+        }
+
+        uint16x8_t cb_sum = vdupq_n_u16(0);
+        uint16x8_t cr_sum = vdupq_n_u16(0);
+
+        convert_16_pixels_neon(vld1q_u8(R0 + col), vld1q_u8(G0 + col), vld1q_u8(B0 + col),
+                               Y0 + col, &cb_sum, &cr_sum);
+        convert_16_pixels_neon(vld1q_u8(R1 + col), vld1q_u8(G1 + col), vld1q_u8(B1 + col),
+                               Y1 + col, &cb_sum, &cr_sum);
+
+        vst1_u8(Cb + (col >> 1), vshrn_n_u16(cb_sum, 2));
+        vst1_u8(Cr + (col >> 1), vshrn_n_u16(cr_sum, 2));
+    }
+    return col;
+}
+
+int optimized_RGB_to_YCC_row_neon(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row_neon(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_RGB_to_YCC_row_fast_chroma_neon(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row_neon(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 1);
 }
 
-void optimized_RGB_to_YCC(
-    const uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Cb[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    uint8_t Cr[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1]
+// Packed RGB24/BGR24 row pair: vld3q deinterleaves 16 pixels per load, so
+// no planar copy of the input is ever made
+static inline int packed_to_ycc_row_neon(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
 ) {
-    for (int r = 0; r < IMAGE_ROW_SIZE; r += 2) {
-        for (int c = 0; c < IMAGE_COL_SIZE; c += 2) {
-            convert_2x2_block_neon(r, c, R, G, B, Y, Cb, Cr);
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        uint16x8_t cb_sum = vdupq_n_u16(0);
+        uint16x8_t cr_sum = vdupq_n_u16(0);
+        uint8x16x3_t p0 = vld3q_u8(P0 + 3 * col);
+        uint8x16x3_t p1 = vld3q_u8(P1 + 3 * col);
+
+        if (fast) {
+            uint16x8_t rgb_sum[3] = { vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0) };
+
+            convert_16_luma_sum_neon(p0.val[r_idx], p0.val[1], p0.val[b_idx], Y0 + col, rgb_sum);
+            convert_16_luma_sum_neon(p1.val[r_idx], p1.val[1], p1.val[b_idx], Y1 + col, rgb_sum);
+            store_chroma_sums_neon(rgb_sum, Cb + (col >> 1), Cr + (col >> 1));
+            continue;
         }
+
+        convert_16_pixels_neon(p0.val[r_idx], p0.val[1], p0.val[b_idx], Y0 + col, &cb_sum, &cr_sum);
+        convert_16_pixels_neon(p1.val[r_idx], p1.val[1], p1.val[b_idx], Y1 + col, &cb_sum, &cr_sum);
+
+        vst1_u8(Cb + (col >> 1), vshrn_n_u16(cb_sum, 2));
+        vst1_u8(Cr + (col >> 1), vshrn_n_u16(cr_sum, 2));
+    }
+    return col;
+}
+
+int optimized_packed_to_YCC_row_neon(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return packed_to_ycc_row_neon(P0, P1, order, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_packed_to_YCC_row_fast_chroma_neon(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return packed_to_ycc_row_neon(P0, P1, order, Y0, Y1, Cb, Cr, width, 1);
+}
+
+// Luma only: Y of one row, no chroma
+int optimized_RGB_to_Y_row_neon(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width) {
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        convert_16_luma_neon(vld1q_u8(R + col), vld1q_u8(G + col), vld1q_u8(B + col), Y + col);
+    }
+    return col;
+}
+
+int optimized_packed_to_Y_row_neon(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width) {
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        uint8x16x3_t p = vld3q_u8(P + 3 * col);
+        convert_16_luma_neon(p.val[r_idx], p.val[1], p.val[b_idx], Y + col);
     }
+    return col;
 }
@@ -19,35 +19,40 @@ static inline int16x4_t upsample_neon_quad(
 
 static void convert_2x2_YCC_block_neon(
     int row, int col,
-    const uint8_t Y [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t Cb_ds[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    const uint8_t Cr_ds[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    uint8_t R [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t G [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t B [IMAGE_ROW_SIZE][IMAGE_COL_SIZE]
+    const csc_ycc_image_t *ycc,
+    csc_rgb_image_t *rgb
 ) {
+    const uint8_t *Y0 = PLANE_ROW(&ycc->Y, row), *Y1 = PLANE_ROW(&ycc->Y, row + 1);
+
+    // The last chroma row and column have no neighbour below/right, so
+    // they reuse themselves instead of reading past the plane
+    int c_row = row >> 1, c_col = col >> 1;
+    int c_row_next = (c_row + 1 < ycc->Cb.height) ? c_row + 1 : c_row;
+    int c_col_next = (c_col + 1 < ycc->Cb.width) ? c_col + 1 : c_col;
+    const uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c_row), *Cb1 = PLANE_ROW(&ycc->Cb, c_row_next);
+    const uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c_row), *Cr1 = PLANE_ROW(&ycc->Cr, c_row_next);
+
     // Load and subtract bias from Y
     int16_t y_arr[4] = {
-        (int16_t)Y[row  ][col]   - 16,
-        (int16_t)Y[row  ][col+1] - 16,
-        (int16_t)Y[row+1][col]   - 16,
-        (int16_t)Y[row+1][col+1] - 16
+        (int16_t)Y0[col]   - 16,
+        (int16_t)Y0[col+1] - 16,
+        (int16_t)Y1[col]   - 16,
+        (int16_t)Y1[col+1] - 16
     };
     int16x4_t yv = vld1_s16(y_arr);
 
     // Upsample chroma
     int16x4_t cbv = upsample_neon_quad(
-       Cb_ds[(row >> 1)][(col >> 1)],
-       Cb_ds[(row >> 1)][(col >> 1) + 1],
-       Cb_ds[(row >> 1) + 1][(col >> 1)],
-       Cb_ds[(row >> 1) + 1][(col >> 1) + 1]
-
+       Cb0[c_col],
+       Cb0[c_col_next],
+       Cb1[c_col],
+       Cb1[c_col_next]
     );
     int16x4_t crv = upsample_neon_quad(
-        Cr_ds[(row>>1)][(col>>1)],
-        Cr_ds[(row>>1)][(col>>1) + 1],
-        Cr_ds[(row>>1) + 1][(col>>1)],
-        Cr_ds[(row>>1) + 1][(col>>1) + 1]
+        Cr0[c_col],
+        Cr0[c_col_next],
+        Cr1[c_col],
+        Cr1[c_col_next]
     );
 
     // Bias chroma by -128
@@ -81,39 +86,273 @@ static void convert_2x2_YCC_block_neon(
     b32 = vqaddq_s32(b32, round);
     b32 = vshrq_n_s32(b32, K);
 
-    uint16x4_t r_u16 = vqmovun_s32(r32); // saturates to 0–255
-    uint16x4_t g_u16 = vqmovun_s32(g32);
-    uint16x4_t b_u16 = vqmovun_s32(b32);
+    // vqmovun only saturates to 0–65535, so clamp to 255 before the
+    // lanes are truncated to bytes
+    const uint16x4_t max8 = vdup_n_u16(255);
+    uint16x4_t r_u16 = vmin_u16(vqmovun_s32(r32), max8);
+    uint16x4_t g_u16 = vmin_u16(vqmovun_s32(g32), max8);
+    uint16x4_t b_u16 = vmin_u16(vqmovun_s32(b32), max8);
 
     // Store to output
-    R[row  ][col]   = vget_lane_u16(r_u16, 0); // red lane 0
-    R[row  ][col+1] = vget_lane_u16(r_u16, 1); // red lane 1
-    R[row+1][col]   = vget_lane_u16(r_u16, 2); // red lane 2
-    R[row+1][col+1] = vget_lane_u16(r_u16, 3); // red lane 3
+    uint8_t *R0 = PLANE_ROW(&rgb->R, row), *R1 = PLANE_ROW(&rgb->R, row + 1);
+    uint8_t *G0 = PLANE_ROW(&rgb->G, row), *G1 = PLANE_ROW(&rgb->G, row + 1);
+    uint8_t *B0 = PLANE_ROW(&rgb->B, row), *B1 = PLANE_ROW(&rgb->B, row + 1);
+
+    R0[col]   = vget_lane_u16(r_u16, 0); // red lane 0
+    R0[col+1] = vget_lane_u16(r_u16, 1); // red lane 1
+    R1[col]   = vget_lane_u16(r_u16, 2); // red lane 2
+    R1[col+1] = vget_lane_u16(r_u16, 3); // red lane 3
+
+    G0[col]   = vget_lane_u16(g_u16, 0);
+    G0[col+1] = vget_lane_u16(g_u16, 1);
+    G1[col]   = vget_lane_u16(g_u16, 2);
+    G1[col+1] = vget_lane_u16(g_u16, 3);
+
+    B0[col]   = vget_lane_u16(b_u16, 0);
+    B0[col+1] = vget_lane_u16(b_u16, 1);
+    B1[col]   = vget_lane_u16(b_u16, 2);
+    B1[col+1] = vget_lane_u16(b_u16, 3);
+
+}
+
+// Convert 16 pixels of one row given their already upsampled chroma
+static inline void convert_16_pixels_neon(
+    const uint8_t *Y, uint8x16_t cb, uint8x16_t cr,
+    uint8x16_t *R, uint8x16_t *G, uint8x16_t *B
+) {
+    uint8x16_t y = vld1q_u8(Y);
+    const int16x8_t y_bias = vdupq_n_s16(16);
+    const int16x8_t c_bias = vdupq_n_s16(128);
+    uint8x8_t r_out[2], g_out[2], b_out[2];
+
+    for (int half = 0; half < 2; half++) {
+        uint8x8_t y8  = half ? vget_high_u8(y)  : vget_low_u8(y);
+        uint8x8_t cb8 = half ? vget_high_u8(cb) : vget_low_u8(cb);
+        uint8x8_t cr8 = half ? vget_high_u8(cr) : vget_low_u8(cr);
+
+        int16x8_t y16  = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)),  y_bias);
+        int16x8_t cb16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cb8)), c_bias);
+        int16x8_t cr16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cr8)), c_bias);
+        uint16x4_t r16[2], g16[2], b16[2];
+
+        // D1..D5 do not fit the 8-bit range, so products are widened to 32 bits
+        for (int q = 0; q < 2; q++) {
+            int16x4_t y4  = q ? vget_high_s16(y16)  : vget_low_s16(y16);
+            int16x4_t cb4 = q ? vget_high_s16(cb16) : vget_low_s16(cb16);
+            int16x4_t cr4 = q ? vget_high_s16(cr16) : vget_low_s16(cr16);
+            int32x4_t yd  = vmull_n_s16(y4, D1);
+
+            int32x4_t r32 = vmlal_n_s16(yd, cr4, D2);
+            int32x4_t g32 = vmlsl_n_s16(vmlsl_n_s16(yd, cr4, D3), cb4, D4);
+            int32x4_t b32 = vmlal_n_s16(yd, cb4, D5);
+
+            // rounding shift by K with saturation to 0..65535
+            r16[q] = vqrshrun_n_s32(r32, K);
+            g16[q] = vqrshrun_n_s32(g32, K);
+            b16[q] = vqrshrun_n_s32(b32, K);
+        }
+
+        // saturate to 0..255
+        r_out[half] = vqmovn_u16(vcombine_u16(r16[0], r16[1]));
+        g_out[half] = vqmovn_u16(vcombine_u16(g16[0], g16[1]));
+        b_out[half] = vqmovn_u16(vcombine_u16(b16[0], b16[1]));
+    }
+
+    *R = vcombine_u8(r_out[0], r_out[1]);
+    *G = vcombine_u8(g_out[0], g_out[1]);
+    *B = vcombine_u8(b_out[0], b_out[1]);
+}
+
+// Narrow variant of convert_16_pixels_neon: vqrdmulh keeps every product
+// in 16-bit lanes, so one op covers 8 pixels instead of 4 (see the narrow
+// section of optimized_global.h)
+static inline void convert_16_pixels_narrow_neon(
+    const uint8_t *Y, uint8x16_t cb, uint8x16_t cr,
+    uint8x16_t *R, uint8x16_t *G, uint8x16_t *B
+) {
+    uint8x16_t y = vld1q_u8(Y);
+    uint8x8_t r_out[2], g_out[2], b_out[2];
+
+    for (int half = 0; half < 2; half++) {
+        uint8x8_t y8  = half ? vget_high_u8(y)  : vget_low_u8(y);
+        uint8x8_t cb8 = half ? vget_high_u8(cb) : vget_low_u8(cb);
+        uint8x8_t cr8 = half ? vget_high_u8(cr) : vget_low_u8(cr);
+
+        // the samples are widened and scaled by 128 in one step
+        int16x8_t y16  = vreinterpretq_s16_u16(vshll_n_u8(y8, 7));
+        int16x8_t cb16 = vreinterpretq_s16_u16(vshll_n_u8(cb8, 7));
+        int16x8_t cr16 = vreinterpretq_s16_u16(vshll_n_u8(cr8, 7));
+
+        int16x8_t luma = vqrdmulhq_n_s16(y16, D1 << KN);
+        int16x8_t r16 = vaddq_s16(luma, vqrdmulhq_n_s16(cr16, D2 << KN));
+        int16x8_t g16 = vsubq_s16(vsubq_s16(luma, vqrdmulhq_n_s16(cr16, D3 << KN)),
+                                  vqrdmulhq_n_s16(cb16, D4 << KN));
+        int16x8_t b16 = vaddq_s16(luma, vqrdmulhq_n_s16(cb16, D5 << KN));
+
+        // the biases carry the rounding; shift by KN and saturate to 0..255
+        r_out[half] = vqshrun_n_s16(vaddq_s16(r16, vdupq_n_s16(NARROW_R_BIAS)), KN);
+        g_out[half] = vqshrun_n_s16(vaddq_s16(g16, vdupq_n_s16(NARROW_G_BIAS)), KN);
+        b_out[half] = vqshrun_n_s16(vaddq_s16(b16, vdupq_n_s16(NARROW_B_BIAS)), KN);
+    }
+
+    *R = vcombine_u8(r_out[0], r_out[1]);
+    *G = vcombine_u8(g_out[0], g_out[1]);
+    *B = vcombine_u8(b_out[0], b_out[1]);
+}
+
+// Upsample 8 chroma samples (plus their right neighbours) from the current
+// and next chroma row into 16 samples for each of the two output rows
+static inline void upsample_chroma_16_neon(
+    const uint8_t *C0, const uint8_t *C1,
+    uint8x16_t *top, uint8x16_t *bottom
+) {
+    uint8x8_t a = vld1_u8(C0), b = vld1_u8(C0 + 1);
+    uint8x8_t c = vld1_u8(C1), d = vld1_u8(C1 + 1);
 
-    G[row  ][col]   = vget_lane_u16(g_u16, 0);
-    G[row  ][col+1] = vget_lane_u16(g_u16, 1);
-    G[row+1][col]   = vget_lane_u16(g_u16, 2);
-    G[row+1][col+1] = vget_lane_u16(g_u16, 3);
+    // even output columns copy/average vertically, odd ones average with
+    // the right neighbour; zipping interleaves them back into pixel order
+    uint8x8_t right  = vhadd_u8(a, b);
+    uint8x8_t below  = vhadd_u8(a, c);
+    uint8x8_t middle = vshrn_n_u16(vaddq_u16(vaddl_u8(a, b), vaddl_u8(c, d)), 2);
 
-    B[row  ][col]   = vget_lane_u16(b_u16, 0);
-    B[row  ][col+1] = vget_lane_u16(b_u16, 1);
-    B[row+1][col]   = vget_lane_u16(b_u16, 2);
-    B[row+1][col+1] = vget_lane_u16(b_u16, 3);
+    uint8x8x2_t t = vzip_u8(a, right);
+    uint8x8x2_t m = vzip_u8(below, middle);
+    *top    = vcombine_u8(t.val[0], t.val[1]);
+    *bottom = vcombine_u8(m.val[0], m.val[1]);
+}
+
+// Convert one row pair 16 pixels at a time. Each step reads 8 chroma samples
+// plus one to the right, so the loop stops before the last chroma column.
+// narrow is a constant at every call, so each kernel inlines one arithmetic.
+static inline int ycc_to_rgb_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width, int narrow
+) {
+    int col = 0;
+
+    for (; col + 16 < width; col += 16) {
+        int c = col >> 1;
+        uint8x16_t cb_top, cb_bottom, cr_top, cr_bottom;
+
+        upsample_chroma_16_neon(Cb0 + c, Cb1 + c, &cb_top, &cb_bottom);
+        upsample_chroma_16_neon(Cr0 + c, Cr1 + c, &cr_top, &cr_bottom);
+
+        uint8x16_t r, g, b;
+
+        if (narrow) {
+            convert_16_pixels_narrow_neon(Y0 + col, cb_top, cr_top, &r, &g, &b);
+        } else {
+            convert_16_pixels_neon(Y0 + col, cb_top, cr_top, &r, &g, &b);
+        }
+        vst1q_u8(R0 + col, r);
+        vst1q_u8(G0 + col, g);
+        vst1q_u8(B0 + col, b);
 
+        if (narrow) {
+            convert_16_pixels_narrow_neon(Y1 + col, cb_bottom, cr_bottom, &r, &g, &b);
+        } else {
+            convert_16_pixels_neon(Y1 + col, cb_bottom, cr_bottom, &r, &g, &b);
+        }
+        vst1q_u8(R1 + col, r);
+        vst1q_u8(G1 + col, g);
+        vst1q_u8(B1 + col, b);
+    }
+    return col;
+}
+
+int optimized_YCC_to_RGB_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row_neon(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 0);
+}
+
+int optimized_YCC_to_RGB_row_narrow_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row_neon(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 1);
 }
 
-void optimized_YCC_to_RGB(
-    const uint8_t Y [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t Cb[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    const uint8_t Cr[IMAGE_ROW_SIZE>>1][IMAGE_COL_SIZE>>1],
-    uint8_t R [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t G [IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t B [IMAGE_ROW_SIZE][IMAGE_COL_SIZE]
+// Same as ycc_to_rgb_row_neon but stores packed RGB24/BGR24 with
+// interleaving vst3q stores
+static inline int ycc_to_packed_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width, int narrow
 ) {
-    for (int r = 0; r < IMAGE_ROW_SIZE; r += 2) {
-        for (int c = 0; c < IMAGE_COL_SIZE; c += 2) {
-            convert_2x2_YCC_block_neon(r, c, Y, Cb, Cr, R, G, B);
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int col = 0;
+
+    for (; col + 16 < width; col += 16) {
+        int c = col >> 1;
+        uint8x16_t cb_top, cb_bottom, cr_top, cr_bottom;
+        uint8x16x3_t px;
+
+        upsample_chroma_16_neon(Cb0 + c, Cb1 + c, &cb_top, &cb_bottom);
+        upsample_chroma_16_neon(Cr0 + c, Cr1 + c, &cr_top, &cr_bottom);
+
+        if (narrow) {
+            convert_16_pixels_narrow_neon(Y0 + col, cb_top, cr_top,
+                                          &px.val[r_idx], &px.val[1], &px.val[b_idx]);
+        } else {
+            convert_16_pixels_neon(Y0 + col, cb_top, cr_top, &px.val[r_idx], &px.val[1], &px.val[b_idx]);
+        }
+        vst3q_u8(P0 + 3 * col, px);
+
+        if (narrow) {
+            convert_16_pixels_narrow_neon(Y1 + col, cb_bottom, cr_bottom,
+                                          &px.val[r_idx], &px.val[1], &px.val[b_idx]);
+        } else {
+            convert_16_pixels_neon(Y1 + col, cb_bottom, cr_bottom, &px.val[r_idx], &px.val[1], &px.val[b_idx]);
+        }
+        vst3q_u8(P1 + 3 * col, px);
+    }
+    return col;
+}
+
+int optimized_YCC_to_packed_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    return ycc_to_packed_row_neon(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, width, 0);
+}
+
+int optimized_YCC_to_packed_row_narrow_neon(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    return ycc_to_packed_row_neon(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, width, 1);
+}
+
+void optimized_YCC_to_RGB_block_neon(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    for (int r = 0; r < ycc->Y.height; r += 2) {
+        for (int c = 0; c < ycc->Y.width; c += 2) {
+            convert_2x2_YCC_block_neon(r, c, ycc, rgb);
         }
     }
 }
@@ -0,0 +1,426 @@
+// optimized_batch.c
+// Batch round trip of many same-sized images in one process. Three stages
+// hand a small ring of image slots to each other through queues: a reader
+// thread fills a slot from disk, the calling thread converts it
+// RGB->YCC->RGB on the worker pool, and a writer thread saves it. While
+// image N is being converted, image N+1 is read and image N-1 written, and
+// the slots, the YCC frame pool and the stdio buffers are reused for every
+// image. Inputs are mapped and converted in place, like single images.
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "optimized_global.h"
+
+// One slot per stage keeps all three busy
+#define BATCH_SLOTS 3
+
+// Marks the end of the batch in a queue
+#define BATCH_END -1
+
+// Bounded FIFO of slot numbers. It never holds more than every slot plus
+// the end marker, so a push never waits.
+typedef struct {
+    int items[BATCH_SLOTS + 1];
+    int head;
+    int count;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} batch_queue_t;
+
+typedef struct {
+    int index;   // position in the path list
+    int failed;  // read failed; the slot is passed on but not converted
+    csc_file_map_t map;
+    csc_packed_image_t in; // view of the pixels in map
+    csc_packed_image_t out;
+} batch_slot_t;
+
+typedef struct {
+    char *const *paths;
+    int count;
+    const char *out_dir;
+    int width;
+    int height;
+    csc_pixel_order_t order;
+    batch_slot_t slots[BATCH_SLOTS];
+    batch_queue_t free_slots;
+    batch_queue_t read_slots;
+    batch_queue_t converted_slots;
+    // written only by the stage that owns them, read after the join
+    double read_ms;
+    double write_ms;
+    int failed;
+} batch_job_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void queue_init(batch_queue_t *q) {
+    q->head = 0;
+    q->count = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->ready, NULL);
+}
+
+static void queue_destroy(batch_queue_t *q) {
+    pthread_cond_destroy(&q->ready);
+    pthread_mutex_destroy(&q->lock);
+}
+
+static void queue_push(batch_queue_t *q, int item) {
+    pthread_mutex_lock(&q->lock);
+    q->items[(q->head + q->count) % (BATCH_SLOTS + 1)] = item;
+    q->count++;
+    pthread_cond_signal(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int queue_pop(batch_queue_t *q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        pthread_cond_wait(&q->ready, &q->lock);
+    }
+    int item = q->items[q->head];
+    q->head = (q->head + 1) % (BATCH_SLOTS + 1);
+    q->count--;
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+// Map an input and describe its pixels in slot->in. BMP and 8-bit P6
+// files are recognised by their header and must be width x height; any
+// other file is raw pixels and must be exactly 3 * width * height bytes
+// rather than converted from its first bytes. Grayscale and deeper files
+// are rejected.
+static int read_image(const batch_job_t *job, const char *path, batch_slot_t *slot) {
+    csc_image_view_t view;
+
+    if (csc_file_map_read(&slot->map, path) != 0) {
+        return -1;
+    }
+    if (csc_image_parse(&slot->map, &view) != 0) {
+        goto fail;
+    }
+    if (view.format == CSC_FORMAT_RAW) {
+        if (slot->map.size != 3 * (size_t)job->width * (size_t)job->height) {
+            goto fail;
+        }
+        csc_packed_image_t raw = { slot->map.data, job->width, job->height,
+                                   3 * (ptrdiff_t)job->width, job->order };
+        slot->in = raw;
+        return 0;
+    }
+    if ((view.format != CSC_FORMAT_BMP && view.format != CSC_FORMAT_PPM) || view.maxval != 255 ||
+        view.width != job->width || view.height != job->height) {
+        goto fail;
+    }
+    slot->in = view.packed;
+    return 0;
+
+fail:
+    csc_file_unmap(&slot->map);
+    return -1;
+}
+
+// out_dir/<input name without extension>.ppm
+static void output_path(char *buf, size_t size, const char *out_dir, const char *input) {
+    const char *base = strrchr(input, '/');
+    base = base ? base + 1 : input;
+    const char *dot = strrchr(base, '.');
+    int len = dot && dot != base ? (int)(dot - base) : (int)strlen(base);
+
+    snprintf(buf, size, "%s/%.*s.ppm", out_dir, len, base);
+}
+
+static int write_image(const char *path, const csc_packed_image_t *image) {
+    size_t row_bytes = 3 * (size_t)image->width;
+    FILE *out = fopen(path, "wb");
+    int status = 0;
+
+    if (!out) {
+        return -1;
+    }
+    fprintf(out, "P6\n%d %d\n255\n", image->width, image->height);
+    for (int row = 0; row < image->height && status == 0; row++) {
+        if (fwrite(PLANE_ROW(image, row), 1, row_bytes, out) != row_bytes) {
+            status = -1;
+        }
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+static void *reader_main(void *arg) {
+    batch_job_t *job = arg;
+
+    for (int i = 0; i < job->count; i++) {
+        int s = queue_pop(&job->free_slots);
+        batch_slot_t *slot = &job->slots[s];
+        double t0 = now_ms();
+
+        slot->index = i;
+        slot->failed = read_image(job, job->paths[i], slot) != 0;
+        job->read_ms += now_ms() - t0;
+        queue_push(&job->read_slots, s);
+    }
+    queue_push(&job->read_slots, BATCH_END);
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    batch_job_t *job = arg;
+    char path[4096];
+
+    for (;;) {
+        int s = queue_pop(&job->converted_slots);
+        if (s == BATCH_END) {
+            break;
+        }
+        batch_slot_t *slot = &job->slots[s];
+        const char *input = job->paths[slot->index];
+        double t0 = now_ms();
+
+        if (slot->failed) {
+            fprintf(stderr, "%s: not a readable %dx%d RGB image\n", input, job->width, job->height);
+            job->failed++;
+        } else {
+            output_path(path, sizeof path, job->out_dir, input);
+            if (write_image(path, &slot->out) != 0) {
+                fprintf(stderr, "%s: cannot write\n", path);
+                job->failed++;
+            }
+        }
+        csc_file_unmap(&slot->map);
+        job->write_ms += now_ms() - t0;
+        queue_push(&job->free_slots, s);
+    }
+    return NULL;
+}
+
+int csc_batch_convert(char *const *paths, int count, const char *out_dir,
+                      int width, int height, csc_pixel_order_t order,
+                      csc_batch_stats_t *stats) {
+    batch_job_t job;
+    csc_frame_pool_t frames;
+    pthread_t reader, writer;
+    int status = -1;
+
+    if (stats) {
+        memset(stats, 0, sizeof *stats);
+    }
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+        return -1;
+    }
+
+    memset(&job, 0, sizeof job);
+    memset(&frames, 0, sizeof frames);
+    job.paths = paths;
+    job.count = count;
+    job.out_dir = out_dir;
+    job.width = width;
+    job.height = height;
+    job.order = order;
+
+    // every buffer is allocated once for the whole batch
+    if (csc_frame_pool_init(&frames, 1, width, height, CSC_CHROMA_420, CSC_FRAME_YCC) != 0) {
+        goto done;
+    }
+    for (int s = 0; s < BATCH_SLOTS; s++) {
+        if (csc_packed_image_alloc(&job.slots[s].out, width, height, CSC_ORDER_RGB) != 0) {
+            goto done;
+        }
+    }
+
+    queue_init(&job.free_slots);
+    queue_init(&job.read_slots);
+    queue_init(&job.converted_slots);
+    for (int s = 0; s < BATCH_SLOTS; s++) {
+        queue_push(&job.free_slots, s);
+    }
+
+    double t_start = now_ms();
+    double convert_ms = 0.0;
+    int started = 0;
+    if (pthread_create(&reader, NULL, reader_main, &job) == 0) {
+        started++;
+        if (pthread_create(&writer, NULL, writer_main, &job) == 0) {
+            started++;
+        }
+    }
+    if (started < 2) {
+        // without a writer nothing frees slots, so drain the reader here
+        if (started == 1) {
+            int s;
+            do {
+                s = queue_pop(&job.read_slots);
+                if (s != BATCH_END) {
+                    queue_push(&job.free_slots, s);
+                }
+            } while (s != BATCH_END);
+            pthread_join(reader, NULL);
+        }
+        goto destroy;
+    }
+
+    // convert stage, on the calling thread so it can use the worker pool
+    for (;;) {
+        int s = queue_pop(&job.read_slots);
+        if (s == BATCH_END) {
+            break;
+        }
+        batch_slot_t *slot = &job.slots[s];
+        csc_frame_t *frame = csc_frame_pool_get(&frames);
+        if (!slot->failed) {
+            double t0 = now_ms();
+            optimized_packed_to_YCC(&slot->in, &frame->ycc);
+            optimized_YCC_to_packed(&frame->ycc, &slot->out);
+            convert_ms += now_ms() - t0;
+        }
+        csc_frame_pool_put(&frames, frame);
+        queue_push(&job.converted_slots, s);
+    }
+    queue_push(&job.converted_slots, BATCH_END);
+
+    pthread_join(reader, NULL);
+    pthread_join(writer, NULL);
+
+    if (stats) {
+        stats->images = count - job.failed;
+        stats->failed = job.failed;
+        stats->total_ms = now_ms() - t_start;
+        stats->read_ms = job.read_ms;
+        stats->convert_ms = convert_ms;
+        stats->write_ms = job.write_ms;
+    }
+    status = job.failed ? -1 : 0;
+
+destroy:
+    queue_destroy(&job.converted_slots);
+    queue_destroy(&job.read_slots);
+    queue_destroy(&job.free_slots);
+
+done:
+    for (int s = 0; s < BATCH_SLOTS; s++) {
+        csc_file_unmap(&job.slots[s].map);
+        csc_packed_image_free(&job.slots[s].out);
+    }
+    csc_frame_pool_destroy(&frames);
+    return status;
+}
+
+static int list_append(csc_path_list_t *list, const char *path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? 2 * list->capacity : 16;
+        char **paths = realloc(list->paths, sizeof(char *) * capacity);
+        if (!paths) {
+            return -1;
+        }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    list->paths[list->count] = strdup(path);
+    if (!list->paths[list->count]) {
+        return -1;
+    }
+    list->count++;
+    return 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Regular files directly inside dir, in name order
+static int append_directory(csc_path_list_t *list, const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    char path[4096];
+    struct stat st;
+    int first = list->count;
+
+    if (!d) {
+        return -1;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof path, "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode) && list_append(list, path) != 0) {
+            closedir(d);
+            return -1;
+        }
+    }
+    closedir(d);
+    qsort(list->paths + first, list->count - first, sizeof(char *), compare_paths);
+    return 0;
+}
+
+// One path per line; blank lines and lines starting with # are skipped
+static int append_list_file(csc_path_list_t *list, const char *file) {
+    FILE *f = fopen(file, "r");
+    char line[4096];
+    int status = 0;
+
+    if (!f) {
+        return -1;
+    }
+    while (status == 0 && fgets(line, sizeof line, f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') {
+            status = list_append(list, line);
+        }
+    }
+    fclose(f);
+    return status;
+}
+
+int csc_path_list_add(csc_path_list_t *list, const char *arg) {
+    struct stat st;
+
+    if (arg[0] == '@') {
+        return append_list_file(list, arg + 1);
+    }
+    if (strpbrk(arg, "*?[")) {
+        glob_t g;
+        int status = 0;
+        int rc = glob(arg, 0, NULL, &g);
+        if (rc == GLOB_NOMATCH) {
+            return 0;
+        }
+        if (rc != 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < g.gl_pathc && status == 0; i++) {
+            status = list_append(list, g.gl_pathv[i]);
+        }
+        globfree(&g);
+        return status;
+    }
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        return append_directory(list, arg);
+    }
+    return list_append(list, arg);
+}
+
+void csc_path_list_free(csc_path_list_t *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
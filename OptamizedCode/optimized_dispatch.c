@@ -0,0 +1,990 @@
+// optimized_dispatch.c
+// Runtime backend selection. The CPU is probed once and the widest
+// supported kernels are bound; everything else calls through the table.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimized_global.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CSC_HAVE_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CSC_HAVE_NEON 1
+#endif
+
+static const csc_backend_kernels_t backend_table[CSC_BACKEND_COUNT] = {
+    [CSC_BACKEND_SCALAR] = {
+        "scalar",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_scalar, optimized_YCC_to_RGB_row_scalar,
+        optimized_packed_to_YCC_row_scalar, optimized_YCC_to_packed_row_scalar
+    },
+#ifdef CSC_HAVE_NEON
+    [CSC_BACKEND_NEON] = {
+        "neon",
+        optimized_RGB_to_YCC_block_neon, optimized_YCC_to_RGB_block_neon,
+        optimized_RGB_to_YCC_row_neon, optimized_YCC_to_RGB_row_neon,
+        optimized_packed_to_YCC_row_neon, optimized_YCC_to_packed_row_neon
+    },
+#endif
+#ifdef CSC_HAVE_X86
+    // the wider x86 backends share the SSE4.1 packed kernels: the pshufb
+    // deinterleave works within 128-bit lanes
+    [CSC_BACKEND_SSE41] = {
+        "sse4.1",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_sse41, optimized_YCC_to_RGB_row_sse41,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_sse41
+    },
+    [CSC_BACKEND_AVX2] = {
+        "avx2",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_avx2, optimized_YCC_to_RGB_row_avx2,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_sse41
+    },
+    [CSC_BACKEND_AVX512] = {
+        "avx512",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_avx512, optimized_YCC_to_RGB_row_avx512,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_sse41
+    },
+#endif
+};
+
+// Table-driven kernels: scalar, and the AVX2 gather variant for backends
+// that can run it
+static const csc_backend_kernels_t lut_table[] = {
+    {
+        "lut",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_lut, optimized_YCC_to_RGB_row_lut,
+        optimized_packed_to_YCC_row_lut, optimized_YCC_to_packed_row_lut
+    },
+#ifdef CSC_HAVE_X86
+    {
+        "lut-avx2",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_lut_avx2, optimized_YCC_to_RGB_row_lut_avx2,
+        optimized_packed_to_YCC_row_lut_avx2, optimized_YCC_to_packed_row_lut_avx2
+    },
+#endif
+};
+
+// Narrow-arithmetic kernel sets, one per backend: the backend's own
+// kernels with the 16-bit-lane YCC->RGB ones swapped in. AVX-512 runs the
+// AVX2 narrow kernel, and the x86 backends share the SSE4.1 packed one.
+static const csc_backend_kernels_t narrow_table[CSC_BACKEND_COUNT] = {
+    [CSC_BACKEND_SCALAR] = {
+        "scalar-narrow",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_scalar, optimized_YCC_to_RGB_row_narrow,
+        optimized_packed_to_YCC_row_scalar, optimized_YCC_to_packed_row_narrow
+    },
+#ifdef CSC_HAVE_NEON
+    [CSC_BACKEND_NEON] = {
+        "neon-narrow",
+        optimized_RGB_to_YCC_block_neon, optimized_YCC_to_RGB_block_neon,
+        optimized_RGB_to_YCC_row_neon, optimized_YCC_to_RGB_row_narrow_neon,
+        optimized_packed_to_YCC_row_neon, optimized_YCC_to_packed_row_narrow_neon
+    },
+#endif
+#ifdef CSC_HAVE_X86
+    [CSC_BACKEND_SSE41] = {
+        "sse4.1-narrow",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_sse41, optimized_YCC_to_RGB_row_narrow_sse41,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_narrow_sse41
+    },
+    [CSC_BACKEND_AVX2] = {
+        "avx2-narrow",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_avx2, optimized_YCC_to_RGB_row_narrow_avx2,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_narrow_sse41
+    },
+    [CSC_BACKEND_AVX512] = {
+        "avx512-narrow",
+        optimized_RGB_to_YCC_block_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_avx512, optimized_YCC_to_RGB_row_narrow_avx2,
+        optimized_packed_to_YCC_row_sse41, optimized_YCC_to_packed_row_narrow_sse41
+    },
+#endif
+};
+
+// Fast-chroma kernel sets, one per backend: the backend's own kernels
+// with the RGB->YCC ones swapped for kernels that convert chroma once per
+// 2x2 block. AVX-512 shares the SSE4.1 packed kernel like the exact sets.
+static const csc_backend_kernels_t fast_chroma_table[CSC_BACKEND_COUNT] = {
+    [CSC_BACKEND_SCALAR] = {
+        "scalar-fast-chroma",
+        optimized_RGB_to_YCC_block_fast_chroma_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_fast_chroma, optimized_YCC_to_RGB_row_scalar,
+        optimized_packed_to_YCC_row_fast_chroma, optimized_YCC_to_packed_row_scalar
+    },
+#ifdef CSC_HAVE_NEON
+    [CSC_BACKEND_NEON] = {
+        "neon-fast-chroma",
+        optimized_RGB_to_YCC_block_fast_chroma_neon, optimized_YCC_to_RGB_block_neon,
+        optimized_RGB_to_YCC_row_fast_chroma_neon, optimized_YCC_to_RGB_row_neon,
+        optimized_packed_to_YCC_row_fast_chroma_neon, optimized_YCC_to_packed_row_neon
+    },
+#endif
+#ifdef CSC_HAVE_X86
+    [CSC_BACKEND_SSE41] = {
+        "sse4.1-fast-chroma",
+        optimized_RGB_to_YCC_block_fast_chroma_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_fast_chroma_sse41, optimized_YCC_to_RGB_row_sse41,
+        optimized_packed_to_YCC_row_fast_chroma_sse41, optimized_YCC_to_packed_row_sse41
+    },
+    [CSC_BACKEND_AVX2] = {
+        "avx2-fast-chroma",
+        optimized_RGB_to_YCC_block_fast_chroma_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_fast_chroma_avx2, optimized_YCC_to_RGB_row_avx2,
+        optimized_packed_to_YCC_row_fast_chroma_sse41, optimized_YCC_to_packed_row_sse41
+    },
+    [CSC_BACKEND_AVX512] = {
+        "avx512-fast-chroma",
+        optimized_RGB_to_YCC_block_fast_chroma_scalar, optimized_YCC_to_RGB_block_scalar,
+        optimized_RGB_to_YCC_row_fast_chroma_avx512, optimized_YCC_to_RGB_row_avx512,
+        optimized_packed_to_YCC_row_fast_chroma_sse41, optimized_YCC_to_packed_row_sse41
+    },
+#endif
+};
+
+// Luma-only kernels, per backend. AVX2 and AVX-512 share the SSE4.1 packed
+// kernel, like the full conversions.
+static const csc_luma_kernels_t luma_table[CSC_BACKEND_COUNT] = {
+    [CSC_BACKEND_SCALAR] = { "scalar", optimized_RGB_to_Y_row_scalar, optimized_packed_to_Y_row_scalar },
+#ifdef CSC_HAVE_NEON
+    [CSC_BACKEND_NEON] = { "neon", optimized_RGB_to_Y_row_neon, optimized_packed_to_Y_row_neon },
+#endif
+#ifdef CSC_HAVE_X86
+    [CSC_BACKEND_SSE41] = { "sse4.1", optimized_RGB_to_Y_row_sse41, optimized_packed_to_Y_row_sse41 },
+    [CSC_BACKEND_AVX2] = { "avx2", optimized_RGB_to_Y_row_avx2, optimized_packed_to_Y_row_sse41 },
+    [CSC_BACKEND_AVX512] = { "avx512", optimized_RGB_to_Y_row_avx512, optimized_packed_to_Y_row_sse41 },
+#endif
+};
+
+// 16-bit kernels: scalar, SSE4.1 and AVX2
+static const csc_hbd_kernels_t hbd_table[] = {
+    { "scalar", optimized_RGB_to_YCC_row16_scalar, optimized_YCC_to_RGB_row16_scalar },
+#ifdef CSC_HAVE_X86
+    { "sse4.1", optimized_RGB_to_YCC_row16_sse41, optimized_YCC_to_RGB_row16_sse41 },
+    { "avx2",   optimized_RGB_to_YCC_row16_avx2,  optimized_YCC_to_RGB_row16_avx2 },
+#endif
+};
+
+static int cpu_probed = 0;
+static int cpu_supported[CSC_BACKEND_COUNT];
+static const csc_backend_kernels_t *active = NULL;
+
+#ifdef CSC_HAVE_X86
+// XCR0: which register state the OS saves on context switch
+static uint64_t read_xcr0(void) {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+static void probe_cpu(void) {
+    if (cpu_probed) {
+        return;
+    }
+    cpu_probed = 1;
+    cpu_supported[CSC_BACKEND_SCALAR] = 1;
+
+#ifdef CSC_HAVE_NEON
+    cpu_supported[CSC_BACKEND_NEON] = 1;
+#endif
+
+#ifdef CSC_HAVE_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+    cpu_supported[CSC_BACKEND_SSE41] = (ecx & bit_SSE4_1) != 0;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0) as well as
+    // reported by the CPU
+    if (!(ecx & bit_OSXSAVE)) {
+        return;
+    }
+    uint64_t xcr0 = read_xcr0();
+    int os_avx = (xcr0 & 0x6) == 0x6;          // XMM | YMM
+    int os_avx512 = os_avx && (xcr0 & 0xE0) == 0xE0; // opmask | ZMM
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+    cpu_supported[CSC_BACKEND_AVX2] = os_avx && (ebx & bit_AVX2);
+    cpu_supported[CSC_BACKEND_AVX512] = os_avx512 && (ebx & bit_AVX512F) && (ebx & bit_AVX512BW);
+#endif
+}
+
+int csc_backend_supported(csc_backend_t backend) {
+    if (backend < 0 || backend >= CSC_BACKEND_COUNT) {
+        return 0;
+    }
+    probe_cpu();
+    return cpu_supported[backend] && backend_table[backend].name != NULL;
+}
+
+csc_backend_t csc_backend_parse(const char *name) {
+    if (strcmp(name, "auto") == 0) {
+        return CSC_BACKEND_AUTO;
+    }
+    for (int i = 0; i < CSC_BACKEND_COUNT; i++) {
+        static const char *names[CSC_BACKEND_COUNT] = { "scalar", "neon", "sse4.1", "avx2", "avx512" };
+        if (strcmp(name, names[i]) == 0) {
+            return (csc_backend_t)i;
+        }
+    }
+    return CSC_BACKEND_COUNT;
+}
+
+int csc_backend_select(csc_backend_t backend) {
+    if (backend == CSC_BACKEND_AUTO) {
+        // CSC_BACKEND forces a backend, e.g. to test a narrower one
+        const char *forced = getenv("CSC_BACKEND");
+        if (forced && *forced) {
+            return csc_backend_select(csc_backend_parse(forced));
+        }
+        for (int i = CSC_BACKEND_COUNT - 1; i >= 0; i--) {
+            if (csc_backend_supported((csc_backend_t)i)) {
+                active = &backend_table[i];
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    if (!csc_backend_supported(backend)) {
+        return -1;
+    }
+    active = &backend_table[backend];
+    return 0;
+}
+
+const csc_backend_kernels_t *csc_backend_kernels(void) {
+    if (!active && csc_backend_select(CSC_BACKEND_AUTO) != 0) {
+        active = &backend_table[CSC_BACKEND_SCALAR];
+    }
+    return active;
+}
+
+const csc_backend_kernels_t *csc_lut_kernels(void) {
+#ifdef CSC_HAVE_X86
+    const csc_backend_kernels_t *k = csc_backend_kernels();
+    if (k == &backend_table[CSC_BACKEND_AVX2] || k == &backend_table[CSC_BACKEND_AVX512]) {
+        return &lut_table[1];
+    }
+#endif
+    return &lut_table[0];
+}
+
+const csc_backend_kernels_t *csc_narrow_kernels(void) {
+    return &narrow_table[csc_backend_kernels() - backend_table];
+}
+
+const csc_backend_kernels_t *csc_fast_chroma_kernels(void) {
+    return &fast_chroma_table[csc_backend_kernels() - backend_table];
+}
+
+const csc_luma_kernels_t *csc_luma_kernels(void) {
+    return &luma_table[csc_backend_kernels() - backend_table];
+}
+
+// There are no NEON or AVX-512 16-bit kernels; AVX-512 runs the AVX2 ones
+const csc_hbd_kernels_t *csc_hbd_kernels(void) {
+#ifdef CSC_HAVE_X86
+    const csc_backend_kernels_t *k = csc_backend_kernels();
+    if (k == &backend_table[CSC_BACKEND_AVX2] || k == &backend_table[CSC_BACKEND_AVX512]) {
+        return &hbd_table[2];
+    }
+    if (k == &backend_table[CSC_BACKEND_SSE41]) {
+        return &hbd_table[1];
+    }
+#endif
+    return &hbd_table[0];
+}
+
+// Source and destination of one whole-image conversion, shared by the
+// bands the rows are split into. The kernels are resolved once up front
+// so worker threads never race on the lazy backend selection. tail
+// finishes the columns the kernels leave; NULL means the exact scalar
+// kernels, and kernel sets with other arithmetic pass their scalar set.
+typedef struct {
+    const csc_backend_kernels_t *kernels;
+    const void *src;
+    void *dst;
+    const csc_backend_kernels_t *tail;
+} convert_job_t;
+
+// Odd sizes. The kernels only convert whole 2x2 blocks, so the band loops
+// run them on the even part of each row pair and peel the rest: an odd
+// last row pairs with itself, and an odd last column goes through the
+// tail kernels as a block with that column repeated. Repeating the edge
+// makes the last chroma samples average, and interpolate towards, real
+// pixels only, and keeps every kernel loop free of edge checks.
+
+// The last column x of an RGB row pair as a 2x2 block with the column repeated
+static void rgb_to_ycc_last_column(csc_rgb_to_ycc_row_fn fn,
+                                   const uint8_t *R0, const uint8_t *R1,
+                                   const uint8_t *G0, const uint8_t *G1,
+                                   const uint8_t *B0, const uint8_t *B1,
+                                   uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int x) {
+    uint8_t r[2][2] = { { R0[x], R0[x] }, { R1[x], R1[x] } };
+    uint8_t g[2][2] = { { G0[x], G0[x] }, { G1[x], G1[x] } };
+    uint8_t b[2][2] = { { B0[x], B0[x] }, { B1[x], B1[x] } };
+    uint8_t y[2][2];
+
+    fn(r[0], r[1], g[0], g[1], b[0], b[1], y[0], y[1], Cb + (x >> 1), Cr + (x >> 1), 2);
+    Y0[x] = y[0][0];
+    Y1[x] = y[1][0];
+}
+
+static void packed_to_ycc_last_column(csc_packed_to_ycc_row_fn fn,
+                                      const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+                                      uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int x) {
+    const uint8_t *src[2] = { P0 + 3 * x, P1 + 3 * x };
+    uint8_t p[2][6], y[2][2];
+
+    for (int i = 0; i < 2; i++) {
+        memcpy(p[i], src[i], 3);
+        memcpy(p[i] + 3, src[i], 3);
+    }
+    fn(p[0], p[1], order, y[0], y[1], Cb + (x >> 1), Cr + (x >> 1), 2);
+    Y0[x] = y[0][0];
+    Y1[x] = y[1][0];
+}
+
+// Pixels [x, width) of a YCC row pair, x even, padded with copies of the
+// last one to two blocks for the tail kernel. A kernel ending at an even
+// column clamps the chroma of its last pixel as if at the right edge, so
+// when the width is odd, or a view has chroma right of it, the drivers
+// start x one block earlier and that pixel is converted again here with
+// its real neighbour.
+static void ycc_to_rgb_last_columns(csc_ycc_to_rgb_row_fn fn,
+                                    const uint8_t *Y0, const uint8_t *Y1,
+                                    const uint8_t *Cb0, const uint8_t *Cb1,
+                                    const uint8_t *Cr0, const uint8_t *Cr1,
+                                    uint8_t *R0, uint8_t *R1, uint8_t *G0, uint8_t *G1,
+                                    uint8_t *B0, uint8_t *B1, int x, int width) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *out[3][2] = { { R0, R1 }, { G0, G1 }, { B0, B1 } };
+    int n = width - x, h = x >> 1;
+    uint8_t y[2][4], rgb[3][2][4];
+    uint8_t cb[2][2] = { { Cb0[h], Cb0[h + (n > 1)] }, { Cb1[h], Cb1[h + (n > 1)] } };
+    uint8_t cr[2][2] = { { Cr0[h], Cr0[h + (n > 1)] }, { Cr1[h], Cr1[h + (n > 1)] } };
+
+    for (int i = 0; i < 2; i++) {
+        memcpy(y[i], Y[i] + x, n);
+        memset(y[i] + n, Y[i][width - 1], 4 - n);
+    }
+    fn(y[0], y[1], cb[0], cb[1], cr[0], cr[1], rgb[0][0], rgb[0][1], rgb[1][0], rgb[1][1],
+       rgb[2][0], rgb[2][1], 4);
+    for (int ch = 0; ch < 3; ch++) {
+        for (int i = 0; i < 2; i++) {
+            memcpy(out[ch][i] + x, rgb[ch][i], n);
+        }
+    }
+}
+
+static void ycc_to_packed_last_columns(csc_ycc_to_packed_row_fn fn,
+                                       const uint8_t *Y0, const uint8_t *Y1,
+                                       const uint8_t *Cb0, const uint8_t *Cb1,
+                                       const uint8_t *Cr0, const uint8_t *Cr1,
+                                       uint8_t *P0, uint8_t *P1, csc_pixel_order_t order, int x, int width) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    int n = width - x, h = x >> 1;
+    uint8_t y[2][4], p[2][12];
+    uint8_t cb[2][2] = { { Cb0[h], Cb0[h + (n > 1)] }, { Cb1[h], Cb1[h + (n > 1)] } };
+    uint8_t cr[2][2] = { { Cr0[h], Cr0[h + (n > 1)] }, { Cr1[h], Cr1[h + (n > 1)] } };
+
+    for (int i = 0; i < 2; i++) {
+        memcpy(y[i], Y[i] + x, n);
+        memset(y[i] + n, Y[i][width - 1], 4 - n);
+    }
+    fn(y[0], y[1], cb[0], cb[1], cr[0], cr[1], p[0], p[1], order, 4);
+    for (int i = 0; i < 2; i++) {
+        memcpy(P[i] + 3 * x, p[i], 3 * n);
+    }
+}
+
+// Row pairs [row_begin, row_end) of optimized_RGB_to_YCC
+static void rgb_to_ycc_rows(void *arg, int row_begin, int row_end) {
+    const convert_job_t *job = arg;
+    const csc_rgb_image_t *rgb = job->src;
+    csc_ycc_image_t *ycc = job->dst;
+    csc_rgb_to_ycc_row_fn row_fn = job->kernels->rgb_to_ycc_row;
+    csc_rgb_to_ycc_row_fn tail_fn = job->tail ? job->tail->rgb_to_ycc_row : optimized_RGB_to_YCC_row_scalar;
+    int width = ycc->Y.width, even = width & ~1;
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        const uint8_t *R0 = PLANE_ROW(&rgb->R, r), *R1 = PLANE_ROW(&rgb->R, r1);
+        const uint8_t *G0 = PLANE_ROW(&rgb->G, r), *G1 = PLANE_ROW(&rgb->G, r1);
+        const uint8_t *B0 = PLANE_ROW(&rgb->B, r), *B1 = PLANE_ROW(&rgb->B, r1);
+        uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        uint8_t *Cb = PLANE_ROW(&ycc->Cb, r >> 1), *Cr = PLANE_ROW(&ycc->Cr, r >> 1);
+
+        int done = row_fn(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, even);
+        if (done < even) {
+            int h = done >> 1;
+            tail_fn(R0 + done, R1 + done, G0 + done, G1 + done,
+                    B0 + done, B1 + done, Y0 + done, Y1 + done,
+                    Cb + h, Cr + h, even - done);
+        }
+        if (width & 1) {
+            rgb_to_ycc_last_column(tail_fn, R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, even);
+        }
+    }
+}
+
+// First column the YCC->RGB drivers peel, or -1 if none. An odd last row
+// is its own second row, so it never interpolates downwards either.
+static int edge_column(int width, int c_width) {
+    int even = width & ~1;
+
+    if (width & 1) {
+        return even > 0 ? even - 2 : 0;
+    }
+    return c_width > (width >> 1) ? even - 2 : -1;
+}
+
+static int ycc_edge_column(const csc_ycc_image_t *ycc) {
+    return edge_column(ycc->Y.width, ycc->Cb.width);
+}
+
+// Row pairs [row_begin, row_end) of optimized_YCC_to_RGB
+static void ycc_to_rgb_rows(void *arg, int row_begin, int row_end) {
+    const convert_job_t *job = arg;
+    const csc_ycc_image_t *ycc = job->src;
+    csc_rgb_image_t *rgb = job->dst;
+    csc_ycc_to_rgb_row_fn row_fn = job->kernels->ycc_to_rgb_row;
+    csc_ycc_to_rgb_row_fn tail_fn = job->tail ? job->tail->ycc_to_rgb_row : optimized_YCC_to_RGB_row_scalar;
+    int width = ycc->Y.width, even = width & ~1;
+    int edge_x = ycc_edge_column(ycc);
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        int c_row = r >> 1;
+        int c_row_next = (r1 > r && c_row + 1 < ycc->Cb.height) ? c_row + 1 : c_row;
+        const uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        const uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c_row), *Cb1 = PLANE_ROW(&ycc->Cb, c_row_next);
+        const uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c_row), *Cr1 = PLANE_ROW(&ycc->Cr, c_row_next);
+        uint8_t *R0 = PLANE_ROW(&rgb->R, r), *R1 = PLANE_ROW(&rgb->R, r1);
+        uint8_t *G0 = PLANE_ROW(&rgb->G, r), *G1 = PLANE_ROW(&rgb->G, r1);
+        uint8_t *B0 = PLANE_ROW(&rgb->B, r), *B1 = PLANE_ROW(&rgb->B, r1);
+
+        int done = row_fn(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, even);
+        if (done < even) {
+            int h = done >> 1;
+            tail_fn(Y0 + done, Y1 + done, Cb0 + h, Cb1 + h,
+                    Cr0 + h, Cr1 + h, R0 + done, R1 + done,
+                    G0 + done, G1 + done, B0 + done, B1 + done,
+                    even - done);
+        }
+        if (edge_x >= 0) {
+            ycc_to_rgb_last_columns(tail_fn, Y0, Y1, Cb0, Cb1, Cr0, Cr1,
+                                    R0, R1, G0, G1, B0, B1, edge_x, width);
+        }
+    }
+}
+
+// Row pairs [row_begin, row_end) of optimized_packed_to_YCC
+static void packed_to_ycc_rows(void *arg, int row_begin, int row_end) {
+    const convert_job_t *job = arg;
+    const csc_packed_image_t *packed = job->src;
+    csc_ycc_image_t *ycc = job->dst;
+    csc_packed_to_ycc_row_fn row_fn = job->kernels->packed_to_ycc_row;
+    csc_packed_to_ycc_row_fn tail_fn = job->tail ? job->tail->packed_to_ycc_row : optimized_packed_to_YCC_row_scalar;
+    csc_pixel_order_t order = packed->order;
+    int width = ycc->Y.width, even = width & ~1;
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        const uint8_t *P0 = PLANE_ROW(packed, r), *P1 = PLANE_ROW(packed, r1);
+        uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        uint8_t *Cb = PLANE_ROW(&ycc->Cb, r >> 1), *Cr = PLANE_ROW(&ycc->Cr, r >> 1);
+
+        int done = row_fn(P0, P1, order, Y0, Y1, Cb, Cr, even);
+        if (done < even) {
+            int h = done >> 1;
+            tail_fn(P0 + 3 * done, P1 + 3 * done, order,
+                    Y0 + done, Y1 + done, Cb + h, Cr + h,
+                    even - done);
+        }
+        if (width & 1) {
+            packed_to_ycc_last_column(tail_fn, P0, P1, order, Y0, Y1, Cb, Cr, even);
+        }
+    }
+}
+
+// Row pairs [row_begin, row_end) of optimized_YCC_to_packed
+static void ycc_to_packed_rows(void *arg, int row_begin, int row_end) {
+    const convert_job_t *job = arg;
+    const csc_ycc_image_t *ycc = job->src;
+    csc_packed_image_t *packed = job->dst;
+    csc_ycc_to_packed_row_fn row_fn = job->kernels->ycc_to_packed_row;
+    csc_ycc_to_packed_row_fn tail_fn = job->tail ? job->tail->ycc_to_packed_row : optimized_YCC_to_packed_row_scalar;
+    csc_pixel_order_t order = packed->order;
+    int width = ycc->Y.width, even = width & ~1;
+    int edge_x = ycc_edge_column(ycc);
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        int c_row = r >> 1;
+        int c_row_next = (r1 > r && c_row + 1 < ycc->Cb.height) ? c_row + 1 : c_row;
+        const uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        const uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c_row), *Cb1 = PLANE_ROW(&ycc->Cb, c_row_next);
+        const uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c_row), *Cr1 = PLANE_ROW(&ycc->Cr, c_row_next);
+        uint8_t *P0 = PLANE_ROW(packed, r), *P1 = PLANE_ROW(packed, r1);
+
+        int done = row_fn(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, even);
+        if (done < even) {
+            int h = done >> 1;
+            tail_fn(Y0 + done, Y1 + done, Cb0 + h, Cb1 + h,
+                    Cr0 + h, Cr1 + h, P0 + 3 * done, P1 + 3 * done,
+                    order, even - done);
+        }
+        if (edge_x >= 0) {
+            ycc_to_packed_last_columns(tail_fn, Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, edge_x, width);
+        }
+    }
+}
+
+void optimized_RGB_to_YCC(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_backend_kernels(), rgb, ycc, NULL };
+    csc_parallel_rows(ycc->Y.height, rgb_to_ycc_rows, &job);
+}
+
+void optimized_YCC_to_RGB(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    convert_job_t job = { csc_backend_kernels(), ycc, rgb, NULL };
+    csc_parallel_rows(ycc->Y.height, ycc_to_rgb_rows, &job);
+}
+
+void optimized_packed_to_YCC(const csc_packed_image_t *packed, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_backend_kernels(), packed, ycc, NULL };
+    csc_parallel_rows(ycc->Y.height, packed_to_ycc_rows, &job);
+}
+
+void optimized_YCC_to_packed(const csc_ycc_image_t *ycc, csc_packed_image_t *packed) {
+    convert_job_t job = { csc_backend_kernels(), ycc, packed, NULL };
+    csc_parallel_rows(ycc->Y.height, ycc_to_packed_rows, &job);
+}
+
+// The block kernels convert whole 2x2 blocks of whatever planes they are
+// given. With an odd size they get views of the even part; the last
+// column beside it and the whole last row are peeled off as views of
+// their own and converted, in one band, through the row path with the
+// tail kernels.
+static csc_plane_t plane_view(const csc_plane_t *plane, int col, int row, int width, int height) {
+    csc_plane_t view = { PLANE_ROW(plane, row) + col, width, height, plane->stride };
+    return view;
+}
+
+static void rgb_view(const csc_rgb_image_t *rgb, int col, int row, int width, int height, csc_rgb_image_t *view) {
+    view->R = plane_view(&rgb->R, col, row, width, height);
+    view->G = plane_view(&rgb->G, col, row, width, height);
+    view->B = plane_view(&rgb->B, col, row, width, height);
+}
+
+// Y at (col, row) and the chroma of its block; both even. The chroma
+// planes keep their own extent unless the view is shrunk to its blocks.
+static void ycc_view(const csc_ycc_image_t *ycc, int col, int row, int width, int height, int shrink_chroma,
+                     csc_ycc_image_t *view) {
+    int c_col = col >> 1, c_row = row >> 1;
+    int c_width = shrink_chroma ? (width + 1) >> 1 : ycc->Cb.width - c_col;
+    int c_height = shrink_chroma ? (height + 1) >> 1 : ycc->Cb.height - c_row;
+
+    view->Y = plane_view(&ycc->Y, col, row, width, height);
+    view->Cb = plane_view(&ycc->Cb, c_col, c_row, c_width, c_height);
+    view->Cr = plane_view(&ycc->Cr, c_col, c_row, c_width, c_height);
+}
+
+static void rgb_to_ycc_block_peeled(const csc_backend_kernels_t *kernels, const csc_backend_kernels_t *tail,
+                                    const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    int width = ycc->Y.width, height = ycc->Y.height;
+    int even_width = width & ~1, even_height = height & ~1;
+    csc_rgb_image_t rgb_part;
+    csc_ycc_image_t ycc_part;
+
+    if (!((width | height) & 1)) {
+        kernels->rgb_to_ycc_block(rgb, ycc);
+        return;
+    }
+    if (even_width > 0 && even_height > 0) {
+        rgb_view(rgb, 0, 0, even_width, even_height, &rgb_part);
+        ycc_view(ycc, 0, 0, even_width, even_height, 1, &ycc_part);
+        kernels->rgb_to_ycc_block(&rgb_part, &ycc_part);
+    }
+    convert_job_t job = { tail, &rgb_part, &ycc_part, tail };
+    if ((width & 1) && even_height > 0) {
+        rgb_view(rgb, even_width, 0, 1, even_height, &rgb_part);
+        ycc_view(ycc, even_width, 0, 1, even_height, 1, &ycc_part);
+        rgb_to_ycc_rows(&job, 0, even_height);
+    }
+    if (height & 1) {
+        rgb_view(rgb, 0, even_height, width, 1, &rgb_part);
+        ycc_view(ycc, 0, even_height, width, 1, 1, &ycc_part);
+        rgb_to_ycc_rows(&job, 0, 1);
+    }
+}
+
+// The interior keeps the full chroma planes, so its last odd column and
+// row still interpolate towards the border chroma
+static void ycc_to_rgb_block_peeled(const csc_backend_kernels_t *kernels, const csc_backend_kernels_t *tail,
+                                    const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    int width = ycc->Y.width, height = ycc->Y.height;
+    int even_width = width & ~1, even_height = height & ~1;
+    csc_ycc_image_t ycc_part;
+    csc_rgb_image_t rgb_part;
+
+    if (!((width | height) & 1)) {
+        kernels->ycc_to_rgb_block(ycc, rgb);
+        return;
+    }
+    if (even_width > 0 && even_height > 0) {
+        ycc_view(ycc, 0, 0, even_width, even_height, 0, &ycc_part);
+        rgb_view(rgb, 0, 0, even_width, even_height, &rgb_part);
+        kernels->ycc_to_rgb_block(&ycc_part, &rgb_part);
+    }
+    convert_job_t job = { tail, &ycc_part, &rgb_part, tail };
+    if ((width & 1) && even_height > 0) {
+        ycc_view(ycc, even_width, 0, 1, even_height, 0, &ycc_part);
+        rgb_view(rgb, even_width, 0, 1, even_height, &rgb_part);
+        ycc_to_rgb_rows(&job, 0, even_height);
+    }
+    if (height & 1) {
+        ycc_view(ycc, 0, even_height, width, 1, 0, &ycc_part);
+        rgb_view(rgb, 0, even_height, width, 1, &rgb_part);
+        ycc_to_rgb_rows(&job, 0, 1);
+    }
+}
+
+void optimized_RGB_to_YCC_block(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    rgb_to_ycc_block_peeled(csc_backend_kernels(), &backend_table[CSC_BACKEND_SCALAR], rgb, ycc);
+}
+
+void optimized_YCC_to_RGB_block(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    ycc_to_rgb_block_peeled(csc_backend_kernels(), &backend_table[CSC_BACKEND_SCALAR], ycc, rgb);
+}
+
+void optimized_RGB_to_YCC_lut(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_lut_kernels(), rgb, ycc, NULL };
+    csc_parallel_rows(ycc->Y.height, rgb_to_ycc_rows, &job);
+}
+
+void optimized_YCC_to_RGB_lut(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    convert_job_t job = { csc_lut_kernels(), ycc, rgb, NULL };
+    csc_parallel_rows(ycc->Y.height, ycc_to_rgb_rows, &job);
+}
+
+void optimized_packed_to_YCC_lut(const csc_packed_image_t *packed, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_lut_kernels(), packed, ycc, NULL };
+    csc_parallel_rows(ycc->Y.height, packed_to_ycc_rows, &job);
+}
+
+void optimized_YCC_to_packed_lut(const csc_ycc_image_t *ycc, csc_packed_image_t *packed) {
+    convert_job_t job = { csc_lut_kernels(), ycc, packed, NULL };
+    csc_parallel_rows(ycc->Y.height, ycc_to_packed_rows, &job);
+}
+
+void optimized_YCC_to_RGB_narrow(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb) {
+    convert_job_t job = { csc_narrow_kernels(), ycc, rgb, &narrow_table[CSC_BACKEND_SCALAR] };
+    csc_parallel_rows(ycc->Y.height, ycc_to_rgb_rows, &job);
+}
+
+void optimized_YCC_to_packed_narrow(const csc_ycc_image_t *ycc, csc_packed_image_t *packed) {
+    convert_job_t job = { csc_narrow_kernels(), ycc, packed, &narrow_table[CSC_BACKEND_SCALAR] };
+    csc_parallel_rows(ycc->Y.height, ycc_to_packed_rows, &job);
+}
+
+void optimized_RGB_to_YCC_fast_chroma(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_fast_chroma_kernels(), rgb, ycc, &fast_chroma_table[CSC_BACKEND_SCALAR] };
+    csc_parallel_rows(ycc->Y.height, rgb_to_ycc_rows, &job);
+}
+
+void optimized_packed_to_YCC_fast_chroma(const csc_packed_image_t *packed, csc_ycc_image_t *ycc) {
+    convert_job_t job = { csc_fast_chroma_kernels(), packed, ycc, &fast_chroma_table[CSC_BACKEND_SCALAR] };
+    csc_parallel_rows(ycc->Y.height, packed_to_ycc_rows, &job);
+}
+
+void optimized_RGB_to_YCC_block_fast_chroma(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc) {
+    rgb_to_ycc_block_peeled(csc_fast_chroma_kernels(), &fast_chroma_table[CSC_BACKEND_SCALAR], rgb, ycc);
+}
+
+// A region of interest is converted as views of the images, so the
+// drivers above see a small image of their own. YCC->RGB keeps the chroma
+// from the region to the end of the planes: the row path reads the column
+// and row beyond the region from it and peels the last block to use them.
+// RGB->YCC therefore converts one more block column and row (roi_halo),
+// shrinking the chroma to those blocks, so that chroma is always valid.
+int csc_roi_align(const csc_rect_t *roi, int width, int height, csc_rect_t *aligned) {
+    if (roi->width <= 0 || roi->height <= 0 || roi->x < 0 || roi->y < 0 ||
+        roi->x > width - roi->width || roi->y > height - roi->height) {
+        return -1;
+    }
+    int right = (roi->x + roi->width + 1) & ~1, bottom = (roi->y + roi->height + 1) & ~1;
+
+    aligned->x = roi->x & ~1;
+    aligned->y = roi->y & ~1;
+    aligned->width = (right < width ? right : width) - aligned->x;
+    aligned->height = (bottom < height ? bottom : height) - aligned->y;
+    return 0;
+}
+
+// The aligned rectangle plus the block right of and below it, clipped
+static csc_rect_t roi_halo(const csc_rect_t *r, int width, int height) {
+    csc_rect_t halo = *r;
+
+    halo.width = (r->x + r->width + 2 < width ? r->x + r->width + 2 : width) - r->x;
+    halo.height = (r->y + r->height + 2 < height ? r->y + r->height + 2 : height) - r->y;
+    return halo;
+}
+
+static csc_packed_image_t packed_view(const csc_packed_image_t *packed, int col, int row, int width, int height) {
+    csc_packed_image_t view = { PLANE_ROW(packed, row) + 3 * col, width, height, packed->stride, packed->order };
+    return view;
+}
+
+int optimized_RGB_to_YCC_roi(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc, const csc_rect_t *roi) {
+    csc_rect_t r;
+    csc_rgb_image_t rgb_part;
+    csc_ycc_image_t ycc_part;
+
+    if (csc_roi_align(roi, ycc->Y.width, ycc->Y.height, &r) != 0) {
+        return -1;
+    }
+    r = roi_halo(&r, ycc->Y.width, ycc->Y.height);
+    rgb_view(rgb, r.x, r.y, r.width, r.height, &rgb_part);
+    ycc_view(ycc, r.x, r.y, r.width, r.height, 1, &ycc_part);
+    optimized_RGB_to_YCC(&rgb_part, &ycc_part);
+    return 0;
+}
+
+int optimized_YCC_to_RGB_roi(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb, const csc_rect_t *roi) {
+    csc_rect_t r;
+    csc_ycc_image_t ycc_part;
+    csc_rgb_image_t rgb_part;
+
+    if (csc_roi_align(roi, ycc->Y.width, ycc->Y.height, &r) != 0) {
+        return -1;
+    }
+    ycc_view(ycc, r.x, r.y, r.width, r.height, 0, &ycc_part);
+    rgb_view(rgb, r.x, r.y, r.width, r.height, &rgb_part);
+    optimized_YCC_to_RGB(&ycc_part, &rgb_part);
+    return 0;
+}
+
+int optimized_packed_to_YCC_roi(const csc_packed_image_t *packed, csc_ycc_image_t *ycc, const csc_rect_t *roi) {
+    csc_rect_t r;
+    csc_ycc_image_t ycc_part;
+
+    if (csc_roi_align(roi, ycc->Y.width, ycc->Y.height, &r) != 0) {
+        return -1;
+    }
+    r = roi_halo(&r, ycc->Y.width, ycc->Y.height);
+    csc_packed_image_t packed_part = packed_view(packed, r.x, r.y, r.width, r.height);
+    ycc_view(ycc, r.x, r.y, r.width, r.height, 1, &ycc_part);
+    optimized_packed_to_YCC(&packed_part, &ycc_part);
+    return 0;
+}
+
+int optimized_YCC_to_packed_roi(const csc_ycc_image_t *ycc, csc_packed_image_t *packed, const csc_rect_t *roi) {
+    csc_rect_t r;
+    csc_ycc_image_t ycc_part;
+
+    if (csc_roi_align(roi, ycc->Y.width, ycc->Y.height, &r) != 0) {
+        return -1;
+    }
+    ycc_view(ycc, r.x, r.y, r.width, r.height, 0, &ycc_part);
+    csc_packed_image_t packed_part = packed_view(packed, r.x, r.y, r.width, r.height);
+    optimized_YCC_to_packed(&ycc_part, &packed_part);
+    return 0;
+}
+
+// Luma jobs carry their own kernels too and run single rows
+typedef struct {
+    const csc_luma_kernels_t *kernels;
+    const void *src;
+    csc_plane_t *Y;
+} luma_job_t;
+
+// Rows [row_begin, row_end) of optimized_RGB_to_Y
+static void rgb_to_y_rows(void *arg, int row_begin, int row_end) {
+    const luma_job_t *job = arg;
+    const csc_rgb_image_t *rgb = job->src;
+    csc_rgb_to_y_row_fn row_fn = job->kernels->rgb_to_y_row;
+    int width = job->Y->width;
+
+    for (int r = row_begin; r < row_end; r++) {
+        const uint8_t *R = PLANE_ROW(&rgb->R, r), *G = PLANE_ROW(&rgb->G, r), *B = PLANE_ROW(&rgb->B, r);
+        uint8_t *Y = PLANE_ROW(job->Y, r);
+
+        int done = row_fn(R, G, B, Y, width);
+        if (done < width) {
+            optimized_RGB_to_Y_row_scalar(R + done, G + done, B + done, Y + done, width - done);
+        }
+    }
+}
+
+// Rows [row_begin, row_end) of optimized_packed_to_Y
+static void packed_to_y_rows(void *arg, int row_begin, int row_end) {
+    const luma_job_t *job = arg;
+    const csc_packed_image_t *packed = job->src;
+    csc_packed_to_y_row_fn row_fn = job->kernels->packed_to_y_row;
+    csc_pixel_order_t order = packed->order;
+    int width = job->Y->width;
+
+    for (int r = row_begin; r < row_end; r++) {
+        const uint8_t *P = PLANE_ROW(packed, r);
+        uint8_t *Y = PLANE_ROW(job->Y, r);
+
+        int done = row_fn(P, order, Y, width);
+        if (done < width) {
+            optimized_packed_to_Y_row_scalar(P + 3 * done, order, Y + done, width - done);
+        }
+    }
+}
+
+void optimized_RGB_to_Y(const csc_rgb_image_t *rgb, csc_plane_t *Y) {
+    luma_job_t job = { csc_luma_kernels(), rgb, Y };
+    csc_parallel_rows(Y->height, rgb_to_y_rows, &job);
+}
+
+void optimized_packed_to_Y(const csc_packed_image_t *packed, csc_plane_t *Y) {
+    luma_job_t job = { csc_luma_kernels(), packed, Y };
+    csc_parallel_rows(Y->height, packed_to_y_rows, &job);
+}
+
+// 16-bit jobs carry their own kernel table
+typedef struct {
+    const csc_hbd_kernels_t *kernels;
+    const void *src;
+    void *dst;
+} convert16_job_t;
+
+// An odd last column and row are peeled as in the 8-bit drivers, through
+// the scalar 16-bit kernels
+static void rgb16_to_ycc16_last_column(const uint16_t *R0, const uint16_t *R1,
+                                       const uint16_t *G0, const uint16_t *G1,
+                                       const uint16_t *B0, const uint16_t *B1,
+                                       uint16_t *Y0, uint16_t *Y1, uint16_t *Cb, uint16_t *Cr,
+                                       int x, int bits) {
+    uint16_t r[2][2] = { { R0[x], R0[x] }, { R1[x], R1[x] } };
+    uint16_t g[2][2] = { { G0[x], G0[x] }, { G1[x], G1[x] } };
+    uint16_t b[2][2] = { { B0[x], B0[x] }, { B1[x], B1[x] } };
+    uint16_t y[2][2];
+
+    optimized_RGB_to_YCC_row16_scalar(r[0], r[1], g[0], g[1], b[0], b[1], y[0], y[1],
+                                      Cb + (x >> 1), Cr + (x >> 1), 2, bits);
+    Y0[x] = y[0][0];
+    Y1[x] = y[1][0];
+}
+
+static void ycc16_to_rgb16_last_columns(const uint16_t *Y0, const uint16_t *Y1,
+                                        const uint16_t *Cb0, const uint16_t *Cb1,
+                                        const uint16_t *Cr0, const uint16_t *Cr1,
+                                        uint16_t *R0, uint16_t *R1, uint16_t *G0, uint16_t *G1,
+                                        uint16_t *B0, uint16_t *B1, int x, int width, int bits) {
+    const uint16_t *Y[2] = { Y0, Y1 };
+    uint16_t *out[3][2] = { { R0, R1 }, { G0, G1 }, { B0, B1 } };
+    int n = width - x, h = x >> 1;
+    uint16_t y[2][4], rgb[3][2][4];
+    uint16_t cb[2][2] = { { Cb0[h], Cb0[h + (n > 1)] }, { Cb1[h], Cb1[h + (n > 1)] } };
+    uint16_t cr[2][2] = { { Cr0[h], Cr0[h + (n > 1)] }, { Cr1[h], Cr1[h + (n > 1)] } };
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 4; j++) {
+            y[i][j] = Y[i][j < n ? x + j : width - 1];
+        }
+    }
+    optimized_YCC_to_RGB_row16_scalar(y[0], y[1], cb[0], cb[1], cr[0], cr[1],
+                                      rgb[0][0], rgb[0][1], rgb[1][0], rgb[1][1],
+                                      rgb[2][0], rgb[2][1], 4, bits);
+    for (int ch = 0; ch < 3; ch++) {
+        for (int i = 0; i < 2; i++) {
+            memcpy(out[ch][i] + x, rgb[ch][i], (size_t)n * sizeof(uint16_t));
+        }
+    }
+}
+
+// Row pairs [row_begin, row_end) of optimized_RGB16_to_YCC16
+static void rgb16_to_ycc16_rows(void *arg, int row_begin, int row_end) {
+    const convert16_job_t *job = arg;
+    const csc_rgb16_image_t *rgb = job->src;
+    csc_ycc16_image_t *ycc = job->dst;
+    csc_rgb16_to_ycc_row_fn row_fn = job->kernels->rgb_to_ycc_row;
+    int width = ycc->Y.width, even = width & ~1, bits = ycc->bits;
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        const uint16_t *R0 = PLANE_ROW(&rgb->R, r), *R1 = PLANE_ROW(&rgb->R, r1);
+        const uint16_t *G0 = PLANE_ROW(&rgb->G, r), *G1 = PLANE_ROW(&rgb->G, r1);
+        const uint16_t *B0 = PLANE_ROW(&rgb->B, r), *B1 = PLANE_ROW(&rgb->B, r1);
+        uint16_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        uint16_t *Cb = PLANE_ROW(&ycc->Cb, r >> 1), *Cr = PLANE_ROW(&ycc->Cr, r >> 1);
+
+        int done = row_fn(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, even, bits);
+        if (done < even) {
+            int h = done >> 1;
+            optimized_RGB_to_YCC_row16_scalar(R0 + done, R1 + done, G0 + done, G1 + done,
+                                              B0 + done, B1 + done, Y0 + done, Y1 + done,
+                                              Cb + h, Cr + h, even - done, bits);
+        }
+        if (width & 1) {
+            rgb16_to_ycc16_last_column(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, even, bits);
+        }
+    }
+}
+
+// Row pairs [row_begin, row_end) of optimized_YCC16_to_RGB16
+static void ycc16_to_rgb16_rows(void *arg, int row_begin, int row_end) {
+    const convert16_job_t *job = arg;
+    const csc_ycc16_image_t *ycc = job->src;
+    csc_rgb16_image_t *rgb = job->dst;
+    csc_ycc16_to_rgb_row_fn row_fn = job->kernels->ycc_to_rgb_row;
+    int width = ycc->Y.width, even = width & ~1, bits = ycc->bits;
+    int edge_x = edge_column(width, ycc->Cb.width);
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        int c_row = r >> 1;
+        int c_row_next = (r1 > r && c_row + 1 < ycc->Cb.height) ? c_row + 1 : c_row;
+        const uint16_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        const uint16_t *Cb0 = PLANE_ROW(&ycc->Cb, c_row), *Cb1 = PLANE_ROW(&ycc->Cb, c_row_next);
+        const uint16_t *Cr0 = PLANE_ROW(&ycc->Cr, c_row), *Cr1 = PLANE_ROW(&ycc->Cr, c_row_next);
+        uint16_t *R0 = PLANE_ROW(&rgb->R, r), *R1 = PLANE_ROW(&rgb->R, r1);
+        uint16_t *G0 = PLANE_ROW(&rgb->G, r), *G1 = PLANE_ROW(&rgb->G, r1);
+        uint16_t *B0 = PLANE_ROW(&rgb->B, r), *B1 = PLANE_ROW(&rgb->B, r1);
+
+        int done = row_fn(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, even, bits);
+        if (done < even) {
+            int h = done >> 1;
+            optimized_YCC_to_RGB_row16_scalar(Y0 + done, Y1 + done, Cb0 + h, Cb1 + h,
+                                              Cr0 + h, Cr1 + h, R0 + done, R1 + done,
+                                              G0 + done, G1 + done, B0 + done, B1 + done,
+                                              even - done, bits);
+        }
+        if (edge_x >= 0) {
+            ycc16_to_rgb16_last_columns(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1,
+                                        edge_x, width, bits);
+        }
+    }
+}
+
+void optimized_RGB16_to_YCC16(const csc_rgb16_image_t *rgb, csc_ycc16_image_t *ycc) {
+    convert16_job_t job = { csc_hbd_kernels(), rgb, ycc };
+    csc_parallel_rows(ycc->Y.height, rgb16_to_ycc16_rows, &job);
+}
+
+void optimized_YCC16_to_RGB16(const csc_ycc16_image_t *ycc, csc_rgb16_image_t *rgb) {
+    convert16_job_t job = { csc_hbd_kernels(), ycc, rgb };
+    csc_parallel_rows(ycc->Y.height, ycc16_to_rgb16_rows, &job);
+}
@@ -0,0 +1,186 @@
+// optimized_frames.c
+// Raw frame streaming: back-to-back packed RGB24/BGR24 frames in, I420
+// frames (the Y plane, then Cb, then Cr, without padding) out, for camera
+// pipes. Input frames come from a frame pool and one I420 frame buffer is
+// allocated up front. The YCC planes are laid directly over the I420
+// buffer, so every frame is a single read, the conversion and a single
+// write. The incremental mode holds on to the last converted input frame,
+// which the I420 buffer still matches, and returns it to the pool once the
+// next one is converted, so nothing is copied.
+#define _POSIX_C_SOURCE 200112L
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "optimized_global.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Read up to size bytes, stopping early only at end of input. Returns the
+// bytes read, or -1 on a read error.
+static ptrdiff_t read_full(int fd, uint8_t *buf, size_t size) {
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = read(fd, buf + done, size - done);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return (ptrdiff_t)done;
+}
+
+static int write_full(int fd, const uint8_t *buf, size_t size) {
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = write(fd, buf + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Y, Cb and Cr planes with stride == width over one contiguous I420 frame
+static void wrap_i420(csc_ycc_image_t *ycc, uint8_t *frame, int width, int height) {
+    size_t luma = (size_t)width * height;
+
+    ycc->Y.data = frame;
+    ycc->Y.width = width;
+    ycc->Y.height = height;
+    ycc->Y.stride = width;
+    ycc->Cb.data = frame + luma;
+    ycc->Cb.width = width / 2;
+    ycc->Cb.height = height / 2;
+    ycc->Cb.stride = width / 2;
+    ycc->Cr = ycc->Cb;
+    ycc->Cr.data = frame + luma + luma / 4;
+}
+
+int csc_frame_stream(int in_fd, int out_fd, int width, int height,
+                     csc_pixel_order_t order, double fps, int incremental,
+                     csc_frame_stats_t *stats) {
+    csc_frame_pool_t frames;
+    csc_frame_t *current = NULL, *last = NULL;
+    csc_ycc_image_t ycc;
+    csc_frame_stats_t s;
+    uint8_t *frame = NULL;
+    int status = -1;
+
+    memset(&s, 0, sizeof s);
+    memset(&frames, 0, sizeof frames);
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+        goto done_stats;
+    }
+
+    size_t in_bytes = 3 * (size_t)width * height;
+    size_t out_bytes = (size_t)width * height * 3 / 2;
+    void *p;
+
+    // packed pool frames are unpadded, so each is read as one block; the
+    // incremental mode has the last frame out while the next is read
+    if (csc_frame_pool_init(&frames, incremental ? 2 : 1, width, height,
+                            CSC_CHROMA_420, CSC_FRAME_PACKED) != 0) {
+        goto done_stats;
+    }
+    if (posix_memalign(&p, PLANE_ALIGNMENT, out_bytes) != 0) {
+        goto done;
+    }
+    frame = p;
+    wrap_i420(&ycc, frame, width, height);
+
+    // A live source delivers frame n at n / fps after the first one and
+    // expects it back by (n + 1) / fps. A frame that is already overdue
+    // when it has been read is dropped to catch up; one written after its
+    // deadline is late.
+    double period_ms = fps > 0.0 ? 1e3 / fps : 0.0;
+    double t_start = 0.0;
+    int tiles = csc_tile_count(width, height);
+
+    for (;;) {
+        if (!current) {
+            current = csc_frame_pool_get(&frames);
+            current->packed.order = order;
+        }
+        ptrdiff_t got = read_full(in_fd, current->packed.data, in_bytes);
+        if (got < 0) {
+            goto done;
+        }
+        if ((size_t)got < in_bytes) {
+            s.trailing_bytes = (size_t)got;
+            break;
+        }
+
+        double t_read = now_ms();
+        uint64_t index = s.frames + s.dropped;
+        if (index == 0) {
+            t_start = t_read;
+        }
+        double deadline = t_start + (double)(index + 1) * period_ms;
+        if (period_ms > 0.0 && t_read > deadline) {
+            s.dropped++;
+            continue;
+        }
+
+        int converted = tiles;
+        if (incremental) {
+            converted = optimized_packed_to_YCC_incremental(&current->packed,
+                                                            last ? &last->packed : NULL, &ycc);
+            if (last) {
+                csc_frame_pool_put(&frames, last);
+            }
+            last = current;
+        } else {
+            optimized_packed_to_YCC(&current->packed, &ycc);
+            csc_frame_pool_put(&frames, current);
+        }
+        current = NULL;
+        double t_converted = now_ms();
+        s.tiles += (uint64_t)tiles;
+        s.tiles_skipped += (uint64_t)(tiles - converted);
+        s.convert_ms += t_converted - t_read;
+
+        if (write_full(out_fd, frame, out_bytes) != 0) {
+            goto done;
+        }
+        if (period_ms > 0.0 && now_ms() > deadline) {
+            s.late++;
+        }
+        s.frames++;
+    }
+    s.total_ms = s.frames + s.dropped > 0 ? now_ms() - t_start : 0.0;
+    status = 0;
+
+done:
+    free(frame);
+    if (current) {
+        csc_frame_pool_put(&frames, current);
+    }
+    if (last) {
+        csc_frame_pool_put(&frames, last);
+    }
+    csc_frame_pool_destroy(&frames);
+done_stats:
+    if (stats) {
+        *stats = s;
+    }
+    return status;
+}
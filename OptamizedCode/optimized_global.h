@@ -2,10 +2,24 @@
 #ifndef OPTIMIZED_GLOBAL_H
 #define OPTIMIZED_GLOBAL_H
 
+#include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
-#define IMAGE_ROW_SIZE 480
-#define IMAGE_COL_SIZE 500
+// Image size used when none is given on the command line
+#define DEFAULT_IMAGE_ROW_SIZE 480
+#define DEFAULT_IMAGE_COL_SIZE 500
+
+// Largest supported side, comfortably above 8K (7680x4320)
+#define MAX_IMAGE_DIMENSION 32768
+
+// Every plane row starts on this boundary (bytes) so vector loads are aligned
+#define PLANE_ALIGNMENT 64
+
+// Bytes of address space that map onto distinct L1 sets (64 sets of 64-byte
+// lines). Rows or planes that start a multiple of this apart share sets.
+#define CACHE_SET_SPAN 4096
 
 #define K 8 // fixed-point bit shift
 #define C11  66
@@ -30,22 +44,848 @@
 // outputs, but will decrease runtime. If this option is disabled, only the output file will be produced.
 #define return_all_output_files 0
 
-void optimized_RGB_to_YCC(
-    const uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1]
-);
-
-void optimized_YCC_to_RGB(
-    const uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    const uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    const uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1],
-    uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE],
-    uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]
-);
+// One 8-bit image plane. stride is the distance in bytes between the start
+// of two consecutive rows and is at least width.
+typedef struct {
+    uint8_t *data;
+    int width;
+    int height;
+    ptrdiff_t stride;
+} csc_plane_t;
+
+// Full-resolution R, G and B planes
+typedef struct {
+    csc_plane_t R;
+    csc_plane_t G;
+    csc_plane_t B;
+} csc_rgb_image_t;
+
+// Full-resolution Y plane plus Cb and Cr planes, 4:2:0 subsampled unless
+// allocated for another chroma format. Subsampled planes round up, so an
+// odd last column or row has a chroma sample of its own.
+typedef struct {
+    csc_plane_t Y;
+    csc_plane_t Cb;
+    csc_plane_t Cr;
+} csc_ycc_image_t;
+
+// Byte order of the three channels in a packed pixel
+typedef enum {
+    CSC_ORDER_RGB = 0,
+    CSC_ORDER_BGR
+} csc_pixel_order_t;
+
+// Chroma resolution: 4:2:0 halves both directions (the default), 4:2:2
+// only the width, 4:4:4 keeps full resolution
+typedef enum {
+    CSC_CHROMA_420 = 0,
+    CSC_CHROMA_422,
+    CSC_CHROMA_444,
+    CSC_CHROMA_FORMAT_COUNT
+} csc_chroma_format_t;
+
+// How chroma is reduced and restored; these are the averaging/discarding
+// and interpolating/replicating modes of the original code. RGB averages
+// R, G and B over each chroma sample's pixels and converts the average
+// once (fast chroma), instead of averaging per-pixel chroma.
+typedef enum {
+    CSC_DOWNSAMPLE_AVERAGE = 0,
+    CSC_DOWNSAMPLE_DROP,
+    CSC_DOWNSAMPLE_RGB
+} csc_downsample_t;
+
+typedef enum {
+    CSC_UPSAMPLE_INTERPOLATE = 0,
+    CSC_UPSAMPLE_REPLICATE
+} csc_upsample_t;
+
+typedef struct {
+    csc_chroma_format_t format;
+    csc_downsample_t down;
+    csc_upsample_t up;
+} csc_chroma_mode_t;
+
+// Interleaved 24-bit image (RGB24 or BGR24), 3 bytes per pixel. stride is
+// the distance in bytes between two rows and is at least 3 * width.
+typedef struct {
+    uint8_t *data;
+    int width;
+    int height;
+    ptrdiff_t stride;
+    csc_pixel_order_t order;
+} csc_packed_image_t;
+
+// Pointer to the first pixel of a row
+#define PLANE_ROW(plane, row) ((plane)->data + (ptrdiff_t)(row) * (plane)->stride)
+
+// Plane allocation (optimized_image.c). The alloc functions return 0 on
+// success and -1 if the size is invalid or memory is exhausted. Rows are
+// padded to an odd number of PLANE_ALIGNMENT lines, so neighbouring rows
+// never fall in the same cache sets.
+int  csc_plane_alloc(csc_plane_t *plane, int width, int height);
+void csc_plane_free(csc_plane_t *plane);
+int  csc_rgb_image_alloc(csc_rgb_image_t *image, int width, int height);
+void csc_rgb_image_free(csc_rgb_image_t *image);
+int  csc_ycc_image_alloc(csc_ycc_image_t *image, int width, int height);
+int  csc_ycc_image_alloc_format(csc_ycc_image_t *image, int width, int height,
+                                csc_chroma_format_t format);
+void csc_ycc_image_free(csc_ycc_image_t *image);
+int  csc_packed_image_alloc(csc_packed_image_t *image, int width, int height, csc_pixel_order_t order);
+void csc_packed_image_free(csc_packed_image_t *image);
+
+// Whole frame sets reused across conversions. A pool allocates count frames
+// up front, each one aligned block holding the planes selected by the
+// CSC_FRAME_* flags, with each plane starting in different cache sets from
+// the others. get hands out a free frame (NULL when all are in use) and put
+// returns it, so steady-state conversion allocates nothing. get and put are
+// thread-safe. A packed image (CSC_FRAME_PACKED) has no row padding, so a
+// whole frame is one contiguous read or write; its order is RGB until the
+// caller sets it.
+#define CSC_FRAME_RGB 1
+#define CSC_FRAME_YCC 2
+#define CSC_FRAME_PACKED 4
+
+typedef struct {
+    csc_rgb_image_t rgb;
+    csc_ycc_image_t ycc;
+    csc_packed_image_t packed;
+    void *block;
+} csc_frame_t;
+
+typedef struct {
+    csc_frame_t *frames;
+    csc_frame_t **free_frames;
+    int count;
+    int free_count;
+    pthread_mutex_t lock;
+} csc_frame_pool_t;
+
+int  csc_frame_pool_init(csc_frame_pool_t *pool, int count, int width, int height,
+                         csc_chroma_format_t format, int planes);
+void csc_frame_pool_destroy(csc_frame_pool_t *pool);
+csc_frame_t *csc_frame_pool_get(csc_frame_pool_t *pool);
+void csc_frame_pool_put(csc_frame_pool_t *pool, csc_frame_t *frame);
+
+// Copy between packed and planar layouts, for kernels that only take planes
+void csc_packed_to_planes(const csc_packed_image_t *packed, csc_rgb_image_t *rgb);
+void csc_planes_to_packed(const csc_rgb_image_t *rgb, csc_packed_image_t *packed);
+
+// A file mapped into memory (optimized_io.c)
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} csc_file_map_t;
+
+// Map an existing file read-only, or create a file of exactly size bytes
+// and map it for writing. Both return 0 on success and -1 on failure.
+int  csc_file_map_read(csc_file_map_t *map, const char *path);
+int  csc_file_map_write(csc_file_map_t *map, const char *path, size_t size);
+void csc_file_unmap(csc_file_map_t *map);
+
+// Input file formats told apart by their header. Anything without a known
+// header is taken as a raw RGB24/BGR24 dump of a size given by the caller.
+typedef enum {
+    CSC_FORMAT_RAW = 0,
+    CSC_FORMAT_BMP,
+    CSC_FORMAT_PPM,
+    CSC_FORMAT_PGM
+} csc_file_format_t;
+
+// Pixels of a mapped image file, described in place. packed covers BMP
+// and P6: a bottom-up BMP gets its last row in the file as row 0 and a
+// negative stride, and its BGR order, so it converts with no copy. gray
+// is the single plane of a P5. Files with maxval above 255 leave both
+// empty; csc_ppm16_read loads those.
+typedef struct {
+    csc_file_format_t format;
+    int width;
+    int height;
+    int maxval;                // 255 for BMP
+    csc_packed_image_t packed; // BMP and P6
+    csc_plane_t gray;          // P5
+} csc_image_view_t;
+
+// Parse the header of a mapped file (optimized_io.c). Returns 0 with
+// format CSC_FORMAT_RAW if there is no known header, 0 with the view
+// filled in for an 8-bit 24 bpp uncompressed BMP or binary PNM, and -1 if
+// the header is malformed, the file is short, or the variant (palette,
+// 32 bpp or compressed BMP) is not supported.
+int csc_image_parse(const csc_file_map_t *map, csc_image_view_t *view);
+
+// Binary PNM output. csc_ppm_map_write creates a P6 file with its header
+// written and points image at the mapped pixel area, so a conversion can
+// write straight into the file; unmap it when done. csc_write_pgm writes
+// one plane as P5.
+int csc_ppm_map_write(csc_file_map_t *map, csc_packed_image_t *image,
+                      const char *path, int width, int height);
+int csc_write_pgm(const char *path, const csc_plane_t *plane);
+
+// Conversion entry points share one signature so callers can pick a kernel
+typedef void (*csc_rgb_to_ycc_fn)(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+typedef void (*csc_ycc_to_rgb_fn)(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+
+// Row-pair kernels convert rows 2n and 2n+1 (and chroma row n) starting at
+// column 0. SIMD kernels return how many columns they converted; the
+// caller finishes the rest with the scalar kernel on offset pointers.
+// For YCC->RGB, Cb1/Cr1 is the chroma row below (or Cb0/Cr0 again on the
+// last row) and the last chroma column reuses itself as right neighbour.
+typedef int (*csc_rgb_to_ycc_row_fn)(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width);
+typedef int (*csc_ycc_to_rgb_row_fn)(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width);
+
+// Packed variants of the row-pair kernels: P0/P1 point at the first pixel
+// of each row of a packed RGB24/BGR24 image and width is in pixels.
+typedef int (*csc_packed_to_ycc_row_fn)(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width);
+typedef int (*csc_ycc_to_packed_row_fn)(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width);
+
+// Instruction set backends, narrowest first
+typedef enum {
+    CSC_BACKEND_AUTO = -1,
+    CSC_BACKEND_SCALAR = 0,
+    CSC_BACKEND_NEON,
+    CSC_BACKEND_SSE41,
+    CSC_BACKEND_AVX2,
+    CSC_BACKEND_AVX512,
+    CSC_BACKEND_COUNT
+} csc_backend_t;
+
+// Kernels bound for one backend. Backends without a 2x2 block kernel of
+// their own use the scalar one.
+typedef struct {
+    const char *name;
+    csc_rgb_to_ycc_fn rgb_to_ycc_block;
+    csc_ycc_to_rgb_fn ycc_to_rgb_block;
+    csc_rgb_to_ycc_row_fn rgb_to_ycc_row;
+    csc_ycc_to_rgb_row_fn ycc_to_rgb_row;
+    csc_packed_to_ycc_row_fn packed_to_ycc_row;
+    csc_ycc_to_packed_row_fn ycc_to_packed_row;
+} csc_backend_kernels_t;
+
+// Backend dispatch (optimized_dispatch.c). The CPU is probed once; AUTO
+// binds the widest supported backend unless the CSC_BACKEND environment
+// variable names another one. csc_backend_select returns -1 if the
+// backend is not compiled in or not supported by this CPU.
+int csc_backend_select(csc_backend_t backend);
+int csc_backend_supported(csc_backend_t backend);
+csc_backend_t csc_backend_parse(const char *name);
+const csc_backend_kernels_t *csc_backend_kernels(void);
+
+// Any width and height, with Cb/Cr at half size rounded up. The kernels
+// only see whole 2x2 blocks: an odd last column or row is converted as if
+// repeated, by peeled edge code in the drivers (optimized_dispatch.c).
+// optimized_RGB_to_YCC/optimized_YCC_to_RGB run the row-pair kernels of the
+// selected backend; the _block variants convert one 2x2 block at a time.
+void optimized_RGB_to_YCC(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_YCC_to_RGB(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+void optimized_RGB_to_YCC_block(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_YCC_to_RGB_block(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+
+// Packed RGB24/BGR24 in and out, converted in place without a planar copy
+void optimized_packed_to_YCC(const csc_packed_image_t *packed, csc_ycc_image_t *ycc);
+void optimized_YCC_to_packed(const csc_ycc_image_t *ycc, csc_packed_image_t *packed);
+
+// Packed conversions for any chroma mode (optimized_subsample.c). ycc must
+// be allocated for mode->format. Every format and filter has its own
+// specialized kernel; 4:2:0 with averaging or interpolation runs the
+// backend kernels above, and 4:2:0 averaged in RGB their fast-chroma ones.
+// Every mode takes any size: an odd last row is converted as its own
+// pair and an odd last column through a padded block, as in the backend
+// drivers.
+void optimized_packed_to_YCC_mode(const csc_packed_image_t *packed, csc_ycc_image_t *ycc,
+                                  const csc_chroma_mode_t *mode);
+void optimized_YCC_to_packed_mode(const csc_ycc_image_t *ycc, csc_packed_image_t *packed,
+                                  const csc_chroma_mode_t *mode);
+
+// Table-driven (LUT) engine. Every coefficient product is read from a
+// 256-entry table per input channel instead of multiplied; the output is
+// identical to the multiply kernels. csc_lut_kernels picks the AVX2
+// gather kernels when the selected backend is AVX2 or wider and the
+// scalar table kernels otherwise, and the _lut drivers run them in bands
+// like the drivers above.
+#define CSC_LUT_RANGE_OFFSET 256 // range[] covers -256 .. 767
+#define CSC_LUT_RANGE_SIZE 1024
+
+typedef struct {
+    // RGB->YCC products; the R tables carry the +16 and +128 offsets
+    int32_t y_r[256], y_g[256], y_b[256];
+    int32_t cb_r[256], cb_g[256], cb_b[256];
+    int32_t cr_r[256], cr_g[256], cr_b[256];
+    // YCC->RGB products; y[] carries the rounding constant
+    int32_t y[256];
+    int32_t r_cr[256], g_cr[256], g_cb[256], b_cb[256];
+    // saturation to 0..255, indexed by value + CSC_LUT_RANGE_OFFSET
+    uint8_t range[CSC_LUT_RANGE_SIZE];
+} csc_lut_t;
+
+// Built on first use (non_neon/optimized_lut.c); safe from any thread
+const csc_lut_t *csc_lut(void);
+const csc_backend_kernels_t *csc_lut_kernels(void);
+
+void optimized_RGB_to_YCC_lut(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_YCC_to_RGB_lut(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+void optimized_packed_to_YCC_lut(const csc_packed_image_t *packed, csc_ycc_image_t *ycc);
+void optimized_YCC_to_packed_lut(const csc_ycc_image_t *ycc, csc_packed_image_t *packed);
+
+// Narrow-arithmetic YCC->RGB, opt-in. Y and chroma are scaled by 128 and
+// multiplied by the D coefficients scaled by 1 << KN with a rounding
+// high-half multiply (pmulhrsw, vqrdmulh), so every term and sum fits a
+// 16-bit lane and one 128-bit op converts 8 pixels instead of 4. The
+// terms come out in 1/32 steps of an output level; the Y and chroma
+// offsets and the rounding fold into one constant per channel. The output
+// differs from the 32-bit kernels by at most CSC_NARROW_MAX_DEVIATION, for
+// about 1% of YCC triples. csc_narrow_check runs a kernel set's planar
+// YCC->RGB kernel over every Y, Cb, Cr triple and returns the largest
+// difference it finds; make check runs it for every backend.
+// RGB->YCC already runs in 16-bit lanes on x86 and is exact, so the narrow
+// kernel sets reuse the backend's RGB->YCC kernels.
+#define KN 5
+#define CSC_NARROW_MAX_DEVIATION 1
+#define NARROW_Y_OFFSET (D1 << (KN - 4)) // 16 * D1 in 1 << KN steps
+#define NARROW_R_BIAS ((1 << (KN - 1)) - NARROW_Y_OFFSET - (D2 << (KN - 1)))
+#define NARROW_G_BIAS ((1 << (KN - 1)) - NARROW_Y_OFFSET + (D3 << (KN - 1)) + (D4 << (KN - 1)))
+#define NARROW_B_BIAS ((1 << (KN - 1)) - NARROW_Y_OFFSET - (D5 << (KN - 1)))
+
+const csc_backend_kernels_t *csc_narrow_kernels(void);
+int csc_narrow_check(const csc_backend_kernels_t *kernels);
+
+void optimized_YCC_to_RGB_narrow(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+void optimized_YCC_to_packed_narrow(const csc_ycc_image_t *ycc, csc_packed_image_t *packed);
+
+// Fast chroma, opt-in (--downsample=rgb). The transform is linear, so the
+// average of four pixels' chroma is the chroma of their average pixel:
+// the RGB->YCC kernels sum R, G and B over each 2x2 block and evaluate Cb
+// and Cr once per block instead of four times. Y is unchanged. Per-pixel
+// chroma truncates each of the four terms before averaging, so the fast
+// result is never lower and at most CSC_FAST_CHROMA_MAX_DEVIATION higher.
+// csc_fast_chroma_check compares a kernel set's planar and packed kernels
+// with the per-pixel ones over random blocks and returns the largest
+// difference; make check runs it for every backend, which all give the
+// same output.
+#define CSC_FAST_CHROMA_MAX_DEVIATION 1
+
+const csc_backend_kernels_t *csc_fast_chroma_kernels(void);
+int csc_fast_chroma_check(const csc_backend_kernels_t *kernels);
+
+void optimized_RGB_to_YCC_fast_chroma(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_packed_to_YCC_fast_chroma(const csc_packed_image_t *packed, csc_ycc_image_t *ycc);
+void optimized_RGB_to_YCC_block_fast_chroma(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+
+// Luma only (--luma): Y from R, G and B with no chroma, for grayscale
+// extraction. The row kernels convert one row of any width and return the
+// columns they converted, like the row-pair kernels; the scalar kernels
+// finish the rest. Y is identical to the Y of the full conversion.
+typedef int (*csc_rgb_to_y_row_fn)(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+typedef int (*csc_packed_to_y_row_fn)(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width);
+
+typedef struct {
+    const char *name;
+    csc_rgb_to_y_row_fn rgb_to_y_row;
+    csc_packed_to_y_row_fn packed_to_y_row;
+} csc_luma_kernels_t;
+
+// The luma kernels of the selected backend; the drivers run in bands of
+// single rows, so any image height works. Y must match the input size.
+const csc_luma_kernels_t *csc_luma_kernels(void);
+void optimized_RGB_to_Y(const csc_rgb_image_t *rgb, csc_plane_t *Y);
+void optimized_packed_to_Y(const csc_packed_image_t *packed, csc_plane_t *Y);
+
+// Region of interest: only the pixels of a rectangle are converted, between
+// full-size images, so the cost follows the rectangle and not the image.
+// csc_roi_align widens a rectangle to the 2x2 chroma grid (even x and y,
+// and an even right and bottom edge unless at the image border) and
+// returns -1 if it is empty or not inside width x height. The _roi drivers
+// convert the aligned rectangle with the row-pair kernels of the selected
+// backend. YCC->RGB writes exactly the rectangle but also reads the chroma
+// column right of it and the chroma row below it, so RGB->YCC converts
+// that halo too: one more block column and row, clipped to the image.
+// Everything else is left untouched, and a YCC->RGB pass after a RGB->YCC
+// pass of the same rectangle matches the same pixels of a full-image
+// conversion. Both return 0, or -1 for a bad rectangle.
+typedef struct {
+    int x, y;
+    int width, height;
+} csc_rect_t;
+
+int csc_roi_align(const csc_rect_t *roi, int width, int height, csc_rect_t *aligned);
+int optimized_RGB_to_YCC_roi(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc, const csc_rect_t *roi);
+int optimized_YCC_to_RGB_roi(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb, const csc_rect_t *roi);
+int optimized_packed_to_YCC_roi(const csc_packed_image_t *packed, csc_ycc_image_t *ycc, const csc_rect_t *roi);
+int optimized_YCC_to_packed_roi(const csc_ycc_image_t *ycc, csc_packed_image_t *packed, const csc_rect_t *roi);
+
+// High bit depth (10 to 16 bits per sample) images in uint16_t planes.
+// stride counts samples, not bytes, so PLANE_ROW works on these planes
+// too. Samples must be below 1 << bits; the Y and chroma offsets are the
+// 8-bit ones scaled by 1 << (bits - 8).
+typedef struct {
+    uint16_t *data;
+    int width;
+    int height;
+    ptrdiff_t stride;
+} csc_plane16_t;
+
+typedef struct {
+    csc_plane16_t R;
+    csc_plane16_t G;
+    csc_plane16_t B;
+    int bits;
+} csc_rgb16_image_t;
+
+typedef struct {
+    csc_plane16_t Y;
+    csc_plane16_t Cb; // 4:2:0, rounded up like the 8-bit planes
+    csc_plane16_t Cr;
+    int bits;
+} csc_ycc16_image_t;
+
+// The 8-bit coefficients lose accuracy past 8 bits of input, so the 16-bit
+// kernels use BT.601 at 13 fractional bits. That is as much as fits: the
+// products of 16-bit samples and their sums stay inside 32 bits.
+#define K16 13
+#define C16_11 2104
+#define C16_12 4130
+#define C16_13  802
+#define C16_21 1214
+#define C16_22 2384
+#define C16_23 3598
+#define C16_31 3598
+#define C16_32 3013
+#define C16_33  585
+
+#define D16_1  9539
+#define D16_2 13075
+#define D16_3  6660
+#define D16_4  3209
+#define D16_5 16525
+
+// Row-pair kernels for 16-bit planes, with the contract of the 8-bit ones
+// plus the sample bit depth
+typedef int (*csc_rgb16_to_ycc_row_fn)(
+    const uint16_t *R0, const uint16_t *R1,
+    const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1,
+    uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr,
+    int width, int bits);
+typedef int (*csc_ycc16_to_rgb_row_fn)(
+    const uint16_t *Y0, const uint16_t *Y1,
+    const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1,
+    uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1,
+    uint16_t *B0, uint16_t *B1,
+    int width, int bits);
+
+typedef struct {
+    const char *name;
+    csc_rgb16_to_ycc_row_fn rgb_to_ycc_row;
+    csc_ycc16_to_rgb_row_fn ycc_to_rgb_row;
+} csc_hbd_kernels_t;
+
+// Plane allocation (optimized_image.c); bits must be 8 to 16
+int  csc_plane16_alloc(csc_plane16_t *plane, int width, int height);
+void csc_plane16_free(csc_plane16_t *plane);
+int  csc_rgb16_image_alloc(csc_rgb16_image_t *image, int width, int height, int bits);
+void csc_rgb16_image_free(csc_rgb16_image_t *image);
+int  csc_ycc16_image_alloc(csc_ycc16_image_t *image, int width, int height, int bits);
+void csc_ycc16_image_free(csc_ycc16_image_t *image);
+
+// Binary P6 in 16-bit planes (optimized_io.c). The read allocates rgb
+// with bits = the width of maxval (at least 8) and splits the samples,
+// big-endian when maxval is above 255, into its planes; the write stores
+// rgb as P6 with maxval (1 << bits) - 1.
+// Both return 0 on success and -1 on a format, allocation or I/O error.
+int csc_ppm16_read(const char *path, csc_rgb16_image_t *rgb);
+int csc_ppm16_write(const char *path, const csc_rgb16_image_t *rgb);
+
+// 16-bit conversions (optimized_dispatch.c), run in bands like the 8-bit
+// row kernels, at any size: an odd last column and row are peeled like
+// the 8-bit ones. csc_hbd_kernels picks the widest kernels the selected
+// backend can run. The images must have the same bits.
+const csc_hbd_kernels_t *csc_hbd_kernels(void);
+void optimized_RGB16_to_YCC16(const csc_rgb16_image_t *rgb, csc_ycc16_image_t *ycc);
+void optimized_YCC16_to_RGB16(const csc_ycc16_image_t *ycc, csc_rgb16_image_t *rgb);
+
+// Worker pool (optimized_threads.c). The row-pair drivers above split the
+// image into bands of whole row pairs, one per thread. Bands only share
+// read-only chroma halo rows, so the output does not depend on the thread
+// count. csc_threads_init starts count - 1 workers next to the caller
+// (count <= 0: one per online CPU) and returns the count in use; the pool
+// runs one conversion at a time, and csc_parallel_rows called from inside
+// a band runs serially.
+#define CSC_MAX_THREADS 64
+
+typedef void (*csc_band_fn)(void *arg, int row_begin, int row_end);
+
+int  csc_threads_init(int count);
+void csc_threads_shutdown(void);
+int  csc_threads_count(void);
+void csc_parallel_rows(int height, csc_band_fn fn, void *arg);
+
+// Per-stage instrumentation (optimized_perf.c), off unless enabled at run
+// time. Each stage accumulates wall time and, where perf_event_open is
+// allowed, user-space cycles, instructions and cache misses. The counters
+// are inherited by threads created after csc_perf_enable, so enabling
+// before csc_threads_init counts the bands of every worker.
+// csc_perf_enable returns how many counters opened; csc_perf_report prints
+// a table, or one line of JSON, with the thread count.
+typedef enum {
+    CSC_STAGE_INPUT = 0,  // mapping, header parsing, planar copy
+    CSC_STAGE_RGB_TO_YCC,
+    CSC_STAGE_DUMP,       // optional per-plane PGM files
+    CSC_STAGE_YCC_TO_RGB,
+    CSC_STAGE_OUTPUT,     // packing and unmapping the output file
+    CSC_STAGE_ROUND_TRIP, // fused RGB->YCC->RGB
+    CSC_STAGE_COUNT
+} csc_stage_t;
+
+typedef struct {
+    int calls;
+    double ms;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cache_misses;
+} csc_stage_stats_t;
+
+extern int csc_perf_enabled;
+
+int  csc_perf_enable(void);
+void csc_perf_disable(void);
+void csc_perf_stage_begin(csc_stage_t stage);
+void csc_perf_stage_end(csc_stage_t stage);
+void csc_perf_report(FILE *out, int json);
+
+#define CSC_PERF_BEGIN(stage) do { if (csc_perf_enabled) csc_perf_stage_begin(stage); } while (0)
+#define CSC_PERF_END(stage)   do { if (csc_perf_enabled) csc_perf_stage_end(stage); } while (0)
+
+// Fused round trip (optimized_roundtrip.c): converts packed in to YCC and
+// back into out in strips, so the intermediate YCC never leaves the cache,
+// and reports how far out is from in. in and out may differ in channel
+// order. The strips come from scratch, set up once by
+// csc_round_trip_pool_init for images width pixels wide with strips of
+// strip_rows rows (<= 0: sized for L2) and one strip per worker thread,
+// and reused by every round trip of that width. Both return 0 on success;
+// optimized_round_trip returns -1 on a size mismatch or if scratch has
+// fewer strips than there are threads.
+typedef struct {
+    uint64_t sum_sq;  // sum of squared per-channel differences
+    int max_abs;      // largest per-channel difference
+    uint64_t samples; // channel values compared
+} csc_error_stats_t;
+
+int csc_round_trip_pool_init(csc_frame_pool_t *scratch, int width, int strip_rows);
+int optimized_round_trip(const csc_packed_image_t *in, csc_packed_image_t *out,
+                         csc_frame_pool_t *scratch, csc_error_stats_t *error);
+
+// Streaming round trip (optimized_stream.c): reads a packed RGB24/BGR24
+// image of the given size from in, converts it to YCC and back strip by
+// strip, and writes it to out as P6. Only about strip_rows rows are held
+// in memory at a time. Returns 0 on success and -1 on a size, allocation
+// or I/O error.
+typedef struct {
+    int strip_rows;      // rows per strip actually used
+    int strips;          // strips converted
+    size_t buffer_bytes; // memory held by the strip buffers
+} csc_stream_stats_t;
+
+int csc_stream_convert(FILE *in, FILE *out, int width, int height,
+                       csc_pixel_order_t order, int strip_rows,
+                       csc_stream_stats_t *stats);
+
+// Batch round trip (optimized_batch.c): converts every file in paths, each
+// a BMP, an 8-bit P6 or a packed RGB24/BGR24 image (order) of the given
+// size, to YCC and back and writes it to out_dir as <name>.ppm. Reading,
+// converting and writing run as a pipeline on reused buffers. Files that
+// cannot be read or written, are of another size (raw: not exactly
+// 3 * width * height bytes) or another format are reported and skipped;
+// returns 0 if all succeeded and -1 otherwise.
+typedef struct {
+    int images;        // images converted and written
+    int failed;        // images skipped
+    double total_ms;   // wall time of the whole batch
+    double read_ms;    // busy time of each stage; they overlap, so the
+    double convert_ms; // sum can exceed total_ms
+    double write_ms;
+} csc_batch_stats_t;
+
+int csc_batch_convert(char *const *paths, int count, const char *out_dir,
+                      int width, int height, csc_pixel_order_t order,
+                      csc_batch_stats_t *stats);
+
+// Dirty-tile incremental RGB->YCC (optimized_tiles.c), for video that
+// changes in a small part of the frame. ycc holds the conversion of
+// previous; the tiles of packed that differ from it are converted again
+// and the others are left as they are, so ycc ends up as the full
+// conversion of packed. previous NULL converts the whole frame. Returns
+// the number of tiles converted, out of csc_tile_count, or -1 if the
+// sizes or channel orders differ.
+#define CSC_TILE_WIDTH 64
+#define CSC_TILE_HEIGHT 16
+
+int csc_tile_count(int width, int height);
+int optimized_packed_to_YCC_incremental(const csc_packed_image_t *packed, const csc_packed_image_t *previous,
+                                        csc_ycc_image_t *ycc);
+
+// Raw frame stream (optimized_frames.c): reads back-to-back packed frames
+// of the given size from in_fd until end of input and writes each one to
+// out_fd as an I420 frame (Y, then Cb, then Cr). No memory is allocated
+// per frame. With fps > 0 the input is treated as a live source: frames
+// that are overdue once read are dropped, and frames written after their
+// deadline are counted as late. With incremental set, each frame is
+// converted from the last converted one with the dirty-tile driver above.
+// Returns 0 at end of input and -1 on a size, allocation or I/O error.
+typedef struct {
+    uint64_t frames;        // frames converted and written
+    uint64_t dropped;       // frames skipped to catch up with fps
+    uint64_t late;          // frames written after their deadline
+    size_t trailing_bytes;  // incomplete frame at the end of the input
+    double total_ms;        // from the first frame to the end of input
+    double convert_ms;      // time spent in the conversion
+    uint64_t tiles;         // tiles of all converted frames
+    uint64_t tiles_skipped; // of those, unchanged and not converted
+} csc_frame_stats_t;
+
+int csc_frame_stream(int in_fd, int out_fd, int width, int height,
+                     csc_pixel_order_t order, double fps, int incremental,
+                     csc_frame_stats_t *stats);
+
+// Growable list of input paths for a batch. csc_path_list_add appends arg
+// as a file, every regular file of a directory, the matches of a glob
+// pattern, or the lines of a list file given as @FILE. Returns 0 on
+// success and -1 if a directory or list file cannot be read.
+typedef struct {
+    char **paths;
+    int count;
+    int capacity;
+} csc_path_list_t;
+
+int  csc_path_list_add(csc_path_list_t *list, const char *arg);
+void csc_path_list_free(csc_path_list_t *list);
+
+// Per-backend kernels
+// scalar (non_neon/)
+void optimized_RGB_to_YCC_block_scalar(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_YCC_to_RGB_block_scalar(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+int optimized_RGB_to_YCC_row_scalar(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_scalar(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_packed_to_YCC_row_scalar(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_packed_row_scalar(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+
+// scalar table kernels (non_neon/optimized_lut.c)
+int optimized_RGB_to_YCC_row_lut(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_lut(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_packed_to_YCC_row_lut(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_packed_row_lut(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+
+// scalar narrow kernels, the reference for the SIMD ones
+// (non_neon/optimized_narrow.c)
+int optimized_YCC_to_RGB_row_narrow(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_YCC_to_packed_row_narrow(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+
+// scalar fast-chroma kernels (non_neon/optimized_fast_chroma.c)
+void optimized_RGB_to_YCC_block_fast_chroma_scalar(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+int optimized_RGB_to_YCC_row_fast_chroma(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_packed_to_YCC_row_fast_chroma(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+
+// scalar luma kernels (non_neon/optimized_luma.c)
+int optimized_RGB_to_Y_row_scalar(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+int optimized_packed_to_Y_row_scalar(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width);
+
+// 16-bit kernels (non_neon/optimized_hbd.c, x86/optimized_hbd_sse41.c,
+// x86/optimized_hbd_avx2.c)
+int optimized_RGB_to_YCC_row16_scalar(
+    const uint16_t *R0, const uint16_t *R1, const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1, uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr, int width, int bits);
+int optimized_YCC_to_RGB_row16_scalar(
+    const uint16_t *Y0, const uint16_t *Y1, const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1, uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1, uint16_t *B0, uint16_t *B1, int width, int bits);
+int optimized_RGB_to_YCC_row16_sse41(
+    const uint16_t *R0, const uint16_t *R1, const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1, uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr, int width, int bits);
+int optimized_YCC_to_RGB_row16_sse41(
+    const uint16_t *Y0, const uint16_t *Y1, const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1, uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1, uint16_t *B0, uint16_t *B1, int width, int bits);
+int optimized_RGB_to_YCC_row16_avx2(
+    const uint16_t *R0, const uint16_t *R1, const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1, uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr, int width, int bits);
+int optimized_YCC_to_RGB_row16_avx2(
+    const uint16_t *Y0, const uint16_t *Y1, const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1, uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1, uint16_t *B0, uint16_t *B1, int width, int bits);
+
+// ARM NEON (optimized_RGB_to_YCC.c, optimized_YCC_to_RGB.c)
+void optimized_RGB_to_YCC_block_neon(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+void optimized_YCC_to_RGB_block_neon(const csc_ycc_image_t *ycc, csc_rgb_image_t *rgb);
+int optimized_RGB_to_YCC_row_neon(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_packed_to_YCC_row_neon(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_packed_row_neon(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+int optimized_YCC_to_RGB_row_narrow_neon(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_YCC_to_packed_row_narrow_neon(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+void optimized_RGB_to_YCC_block_fast_chroma_neon(const csc_rgb_image_t *rgb, csc_ycc_image_t *ycc);
+int optimized_RGB_to_YCC_row_fast_chroma_neon(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_packed_to_YCC_row_fast_chroma_neon(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_RGB_to_Y_row_neon(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+int optimized_packed_to_Y_row_neon(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width);
+
+// x86 (x86/optimized_sse41.c, x86/optimized_avx2.c, x86/optimized_avx512.c,
+// x86/optimized_lut_avx2.c)
+int optimized_RGB_to_YCC_row_sse41(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_sse41(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_RGB_to_YCC_row_avx2(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_avx2(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_RGB_to_YCC_row_avx512(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_avx512(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_packed_to_YCC_row_sse41(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_packed_row_sse41(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+int optimized_YCC_to_RGB_row_narrow_sse41(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_YCC_to_packed_row_narrow_sse41(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
+int optimized_YCC_to_RGB_row_narrow_avx2(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_RGB_to_YCC_row_fast_chroma_sse41(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_packed_to_YCC_row_fast_chroma_sse41(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_RGB_to_YCC_row_fast_chroma_avx2(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_RGB_to_YCC_row_fast_chroma_avx512(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_RGB_to_Y_row_sse41(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+int optimized_packed_to_Y_row_sse41(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width);
+int optimized_RGB_to_Y_row_avx2(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+int optimized_RGB_to_Y_row_avx512(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width);
+int optimized_RGB_to_YCC_row_lut_avx2(
+    const uint8_t *R0, const uint8_t *R1, const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1, uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_RGB_row_lut_avx2(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1, uint8_t *B0, uint8_t *B1, int width);
+int optimized_packed_to_YCC_row_lut_avx2(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb, uint8_t *Cr, int width);
+int optimized_YCC_to_packed_row_lut_avx2(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    csc_pixel_order_t order, int width);
 
 #endif
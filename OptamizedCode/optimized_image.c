@@ -0,0 +1,371 @@
+// optimized_image.c
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimized_global.h"
+
+// Row pitch for rows of row_bytes: whole PLANE_ALIGNMENT lines, and an odd
+// number of them, so consecutive rows cycle through the cache sets instead
+// of piling into the same few at power-of-two widths
+static ptrdiff_t padded_stride(size_t row_bytes) {
+    ptrdiff_t lines = ((ptrdiff_t)row_bytes + PLANE_ALIGNMENT - 1) / PLANE_ALIGNMENT;
+    return (lines | 1) * PLANE_ALIGNMENT;
+}
+
+int csc_plane_alloc(csc_plane_t *plane, int width, int height) {
+    void *data;
+
+    plane->data = NULL;
+    plane->width = 0;
+    plane->height = 0;
+    plane->stride = 0;
+
+    if (width <= 0 || height <= 0 ||
+        width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return -1;
+    }
+
+    ptrdiff_t stride = padded_stride((size_t)width);
+
+    if (posix_memalign(&data, PLANE_ALIGNMENT, (size_t)stride * (size_t)height) != 0) {
+        return -1;
+    }
+
+    plane->data = (uint8_t *)data;
+    plane->width = width;
+    plane->height = height;
+    plane->stride = stride;
+    return 0;
+}
+
+void csc_plane_free(csc_plane_t *plane) {
+    free(plane->data);
+    plane->data = NULL;
+    plane->width = 0;
+    plane->height = 0;
+    plane->stride = 0;
+}
+
+int csc_rgb_image_alloc(csc_rgb_image_t *image, int width, int height) {
+    image->G.data = NULL;
+    image->B.data = NULL;
+
+    if (csc_plane_alloc(&image->R, width, height) != 0 ||
+        csc_plane_alloc(&image->G, width, height) != 0 ||
+        csc_plane_alloc(&image->B, width, height) != 0) {
+        csc_rgb_image_free(image);
+        return -1;
+    }
+    return 0;
+}
+
+void csc_rgb_image_free(csc_rgb_image_t *image) {
+    csc_plane_free(&image->R);
+    csc_plane_free(&image->G);
+    csc_plane_free(&image->B);
+}
+
+int csc_ycc_image_alloc(csc_ycc_image_t *image, int width, int height) {
+    return csc_ycc_image_alloc_format(image, width, height, CSC_CHROMA_420);
+}
+
+int csc_ycc_image_alloc_format(csc_ycc_image_t *image, int width, int height,
+                               csc_chroma_format_t format) {
+    int c_width = (format == CSC_CHROMA_444) ? width : (width + 1) >> 1;
+    int c_height = (format == CSC_CHROMA_420) ? (height + 1) >> 1 : height;
+
+    image->Cb.data = NULL;
+    image->Cr.data = NULL;
+
+    if (csc_plane_alloc(&image->Y, width, height) != 0 ||
+        csc_plane_alloc(&image->Cb, c_width, c_height) != 0 ||
+        csc_plane_alloc(&image->Cr, c_width, c_height) != 0) {
+        csc_ycc_image_free(image);
+        return -1;
+    }
+    return 0;
+}
+
+void csc_ycc_image_free(csc_ycc_image_t *image) {
+    csc_plane_free(&image->Y);
+    csc_plane_free(&image->Cb);
+    csc_plane_free(&image->Cr);
+}
+
+int csc_packed_image_alloc(csc_packed_image_t *image, int width, int height, csc_pixel_order_t order) {
+    void *data;
+
+    image->data = NULL;
+    image->width = 0;
+    image->height = 0;
+    image->stride = 0;
+    image->order = order;
+
+    if (width <= 0 || height <= 0 ||
+        width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return -1;
+    }
+
+    ptrdiff_t stride = padded_stride(3 * (size_t)width);
+
+    if (posix_memalign(&data, PLANE_ALIGNMENT, (size_t)stride * (size_t)height) != 0) {
+        return -1;
+    }
+
+    image->data = (uint8_t *)data;
+    image->width = width;
+    image->height = height;
+    image->stride = stride;
+    return 0;
+}
+
+void csc_packed_image_free(csc_packed_image_t *image) {
+    free(image->data);
+    image->data = NULL;
+    image->width = 0;
+    image->height = 0;
+    image->stride = 0;
+}
+
+void csc_packed_to_planes(const csc_packed_image_t *packed, csc_rgb_image_t *rgb) {
+    const int r_idx = (packed->order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int row = 0; row < packed->height; row++) {
+        const uint8_t *P = PLANE_ROW(packed, row);
+        uint8_t *R = PLANE_ROW(&rgb->R, row);
+        uint8_t *G = PLANE_ROW(&rgb->G, row);
+        uint8_t *B = PLANE_ROW(&rgb->B, row);
+        for (int col = 0; col < packed->width; col++) {
+            R[col] = P[3 * col + r_idx];
+            G[col] = P[3 * col + 1];
+            B[col] = P[3 * col + b_idx];
+        }
+    }
+}
+
+void csc_planes_to_packed(const csc_rgb_image_t *rgb, csc_packed_image_t *packed) {
+    const int r_idx = (packed->order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+
+    for (int row = 0; row < packed->height; row++) {
+        const uint8_t *R = PLANE_ROW(&rgb->R, row);
+        const uint8_t *G = PLANE_ROW(&rgb->G, row);
+        const uint8_t *B = PLANE_ROW(&rgb->B, row);
+        uint8_t *P = PLANE_ROW(packed, row);
+        for (int col = 0; col < packed->width; col++) {
+            P[3 * col + r_idx] = R[col];
+            P[3 * col + 1]     = G[col];
+            P[3 * col + b_idx] = B[col];
+        }
+    }
+}
+
+int csc_plane16_alloc(csc_plane16_t *plane, int width, int height) {
+    void *data;
+
+    plane->data = NULL;
+    plane->width = 0;
+    plane->height = 0;
+    plane->stride = 0;
+
+    if (width <= 0 || height <= 0 ||
+        width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return -1;
+    }
+
+    // stride is in samples; rows still start on PLANE_ALIGNMENT bytes
+    ptrdiff_t stride = padded_stride((size_t)width * sizeof(uint16_t)) / (ptrdiff_t)sizeof(uint16_t);
+
+    if (posix_memalign(&data, PLANE_ALIGNMENT, (size_t)stride * (size_t)height * sizeof(uint16_t)) != 0) {
+        return -1;
+    }
+
+    plane->data = (uint16_t *)data;
+    plane->width = width;
+    plane->height = height;
+    plane->stride = stride;
+    return 0;
+}
+
+void csc_plane16_free(csc_plane16_t *plane) {
+    free(plane->data);
+    plane->data = NULL;
+    plane->width = 0;
+    plane->height = 0;
+    plane->stride = 0;
+}
+
+int csc_rgb16_image_alloc(csc_rgb16_image_t *image, int width, int height, int bits) {
+    image->R.data = NULL;
+    image->G.data = NULL;
+    image->B.data = NULL;
+    image->bits = bits;
+
+    if (bits < 8 || bits > 16 ||
+        csc_plane16_alloc(&image->R, width, height) != 0 ||
+        csc_plane16_alloc(&image->G, width, height) != 0 ||
+        csc_plane16_alloc(&image->B, width, height) != 0) {
+        csc_rgb16_image_free(image);
+        return -1;
+    }
+    return 0;
+}
+
+void csc_rgb16_image_free(csc_rgb16_image_t *image) {
+    csc_plane16_free(&image->R);
+    csc_plane16_free(&image->G);
+    csc_plane16_free(&image->B);
+}
+
+int csc_ycc16_image_alloc(csc_ycc16_image_t *image, int width, int height, int bits) {
+    image->Y.data = NULL;
+    image->Cb.data = NULL;
+    image->Cr.data = NULL;
+    image->bits = bits;
+
+    if (bits < 8 || bits > 16 ||
+        csc_plane16_alloc(&image->Y, width, height) != 0 ||
+        csc_plane16_alloc(&image->Cb, (width + 1) >> 1, (height + 1) >> 1) != 0 ||
+        csc_plane16_alloc(&image->Cr, (width + 1) >> 1, (height + 1) >> 1) != 0) {
+        csc_ycc16_image_free(image);
+        return -1;
+    }
+    return 0;
+}
+
+void csc_ycc16_image_free(csc_ycc16_image_t *image) {
+    csc_plane16_free(&image->Y);
+    csc_plane16_free(&image->Cb);
+    csc_plane16_free(&image->Cr);
+}
+
+// Planes of a frame start this far apart modulo CACHE_SET_SPAN, so the same
+// pixel of every plane maps to a different cache set
+#define FRAME_PLANE_STAGGER (CACHE_SET_SPAN / 8)
+
+#define FRAME_MAX_PLANES 6
+
+// The planes of a frame selected by the CSC_FRAME_* flags, in layout order
+static int frame_planes(csc_frame_t *frame, int planes, csc_plane_t *plane[FRAME_MAX_PLANES]) {
+    int n = 0;
+
+    if (planes & CSC_FRAME_RGB) {
+        plane[n++] = &frame->rgb.R;
+        plane[n++] = &frame->rgb.G;
+        plane[n++] = &frame->rgb.B;
+    }
+    if (planes & CSC_FRAME_YCC) {
+        plane[n++] = &frame->ycc.Y;
+        plane[n++] = &frame->ycc.Cb;
+        plane[n++] = &frame->ycc.Cr;
+    }
+    return n;
+}
+
+int csc_frame_pool_init(csc_frame_pool_t *pool, int count, int width, int height,
+                        csc_chroma_format_t format, int planes) {
+    int c_width = (format == CSC_CHROMA_444) ? width : (width + 1) >> 1;
+    int c_height = (format == CSC_CHROMA_420) ? (height + 1) >> 1 : height;
+    csc_frame_t layout;
+    csc_plane_t *plane[FRAME_MAX_PLANES];
+    size_t offset[FRAME_MAX_PLANES];
+    size_t size = 0;
+
+    memset(pool, 0, sizeof *pool);
+    if (count <= 0 || width <= 0 || height <= 0 ||
+        width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION ||
+        !(planes & (CSC_FRAME_RGB | CSC_FRAME_YCC | CSC_FRAME_PACKED))) {
+        return -1;
+    }
+
+    // plane geometry and offsets are the same for every frame; the packed
+    // image comes first, unpadded so it reads and writes as one block
+    memset(&layout, 0, sizeof layout);
+    if (planes & CSC_FRAME_PACKED) {
+        layout.packed.width = width;
+        layout.packed.height = height;
+        layout.packed.stride = 3 * (ptrdiff_t)width;
+        layout.packed.order = CSC_ORDER_RGB;
+        size = (size_t)layout.packed.stride * (size_t)height;
+    }
+    int n = frame_planes(&layout, planes, plane);
+    for (int i = 0; i < n; i++) {
+        int chroma = plane[i] == &layout.ycc.Cb || plane[i] == &layout.ycc.Cr;
+        plane[i]->width = chroma ? c_width : width;
+        plane[i]->height = chroma ? c_height : height;
+        plane[i]->stride = padded_stride((size_t)plane[i]->width);
+        size = (size + CACHE_SET_SPAN - 1) & ~(size_t)(CACHE_SET_SPAN - 1);
+        offset[i] = size + (size_t)i * FRAME_PLANE_STAGGER;
+        size = offset[i] + (size_t)plane[i]->stride * (size_t)plane[i]->height;
+    }
+
+    pool->frames = calloc((size_t)count, sizeof *pool->frames);
+    pool->free_frames = calloc((size_t)count, sizeof *pool->free_frames);
+    if (!pool->frames || !pool->free_frames) {
+        free(pool->frames);
+        free(pool->free_frames);
+        pool->frames = NULL;
+        pool->free_frames = NULL;
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+
+    for (int f = 0; f < count; f++) {
+        csc_frame_t *frame = &pool->frames[f];
+        void *block;
+
+        if (posix_memalign(&block, CACHE_SET_SPAN, size) != 0) {
+            csc_frame_pool_destroy(pool);
+            return -1;
+        }
+        *frame = layout;
+        frame->block = block;
+        if (planes & CSC_FRAME_PACKED) {
+            frame->packed.data = block;
+        }
+        frame_planes(frame, planes, plane);
+        for (int i = 0; i < n; i++) {
+            plane[i]->data = (uint8_t *)block + offset[i];
+        }
+        pool->count++;
+        pool->free_frames[pool->free_count++] = frame;
+    }
+    return 0;
+}
+
+// Safe on a pool whose init failed or that was already destroyed
+void csc_frame_pool_destroy(csc_frame_pool_t *pool) {
+    if (!pool->frames) {
+        return;
+    }
+    for (int f = 0; f < pool->count; f++) {
+        free(pool->frames[f].block);
+    }
+    free(pool->frames);
+    free(pool->free_frames);
+    pthread_mutex_destroy(&pool->lock);
+    pool->frames = NULL;
+    pool->free_frames = NULL;
+    pool->count = 0;
+    pool->free_count = 0;
+}
+
+csc_frame_t *csc_frame_pool_get(csc_frame_pool_t *pool) {
+    csc_frame_t *frame = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->free_count > 0) {
+        frame = pool->free_frames[--pool->free_count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return frame;
+}
+
+void csc_frame_pool_put(csc_frame_pool_t *pool, csc_frame_t *frame) {
+    pthread_mutex_lock(&pool->lock);
+    pool->free_frames[pool->free_count++] = frame;
+    pthread_mutex_unlock(&pool->lock);
+}
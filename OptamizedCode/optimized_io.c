@@ -0,0 +1,372 @@
+// optimized_io.c
+// Binary image I/O through memory maps. Input files are mapped read-only
+// and converted in place; output files are created at their final size and
+// mapped, so the kernels write pixels straight into the page cache.
+#define _POSIX_C_SOURCE 200112L
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "optimized_global.h"
+
+int csc_file_map_read(csc_file_map_t *map, const char *path) {
+    struct stat st;
+
+    map->data = NULL;
+    map->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    // the kernels walk the file front to back once
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
+
+    map->data = (uint8_t *)data;
+    map->size = (size_t)st.st_size;
+    return 0;
+}
+
+int csc_file_map_write(csc_file_map_t *map, const char *path, size_t size) {
+    map->data = NULL;
+    map->size = 0;
+
+    if (size == 0) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    // size the file up front so the whole mapping is backed
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    map->data = (uint8_t *)data;
+    map->size = size;
+    return 0;
+}
+
+void csc_file_unmap(csc_file_map_t *map) {
+    if (map->data) {
+        munmap(map->data, map->size);
+    }
+    map->data = NULL;
+    map->size = 0;
+}
+
+// Create a binary PNM file (P5 or P6) and map it; returns the offset of
+// the first pixel, or 0 on failure
+static size_t map_pnm(csc_file_map_t *map, const char *path, const char *magic,
+                      int width, int height, int channels) {
+    char header[64];
+    int header_len = snprintf(header, sizeof header, "%s\n%d %d\n255\n", magic, width, height);
+    size_t size = (size_t)header_len + (size_t)width * (size_t)height * (size_t)channels;
+
+    if (csc_file_map_write(map, path, size) != 0) {
+        return 0;
+    }
+    memcpy(map->data, header, (size_t)header_len);
+    return (size_t)header_len;
+}
+
+int csc_ppm_map_write(csc_file_map_t *map, csc_packed_image_t *image,
+                      const char *path, int width, int height) {
+    size_t offset = map_pnm(map, path, "P6", width, height, 3);
+    if (offset == 0) {
+        return -1;
+    }
+
+    // P6 rows are tightly packed RGB
+    image->data = map->data + offset;
+    image->width = width;
+    image->height = height;
+    image->stride = 3 * (ptrdiff_t)width;
+    image->order = CSC_ORDER_RGB;
+    return 0;
+}
+
+int csc_write_pgm(const char *path, const csc_plane_t *plane) {
+    csc_file_map_t map;
+    size_t offset = map_pnm(&map, path, "P5", plane->width, plane->height, 1);
+    if (offset == 0) {
+        return -1;
+    }
+
+    uint8_t *dst = map.data + offset;
+    for (int row = 0; row < plane->height; row++) {
+        memcpy(dst, PLANE_ROW(plane, row), (size_t)plane->width);
+        dst += plane->width;
+    }
+    csc_file_unmap(&map);
+    return 0;
+}
+
+// Parse the header of a binary PNM file of the given magic ("P6", "P5"), which
+// may carry comments. Returns the offset of the first sample, or 0 if the
+// header is malformed.
+static size_t parse_pnm_header(const csc_file_map_t *map, const char *magic,
+                               int *width, int *height, int *maxval) {
+    const uint8_t *p = map->data, *end = map->data + map->size;
+    int fields[3];
+
+    if (map->size < 2 || p[0] != magic[0] || p[1] != magic[1]) {
+        return 0;
+    }
+    p += 2;
+    for (int i = 0; i < 3; i++) {
+        // whitespace and comments up to the next number
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '#')) {
+            if (*p == '#') {
+                while (p < end && *p != '\n') {
+                    p++;
+                }
+            } else {
+                p++;
+            }
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return 0;
+        }
+        long value = 0;
+        while (p < end && *p >= '0' && *p <= '9' && value <= 65535) {
+            value = value * 10 + (*p++ - '0');
+        }
+        if (value <= 0 || value > 65535) {
+            return 0;
+        }
+        fields[i] = (int)value;
+    }
+    // exactly one whitespace byte ends the header
+    if (p == end || !(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        return 0;
+    }
+    *width = fields[0];
+    *height = fields[1];
+    *maxval = fields[2];
+    return (size_t)(p + 1 - map->data);
+}
+
+static uint32_t read_le16(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// BITMAPFILEHEADER (14 bytes) followed by a BITMAPINFOHEADER or one of its
+// longer successors, which only add fields after the ones read here
+#define BMP_FILE_HEADER_SIZE 14
+#define BMP_INFO_HEADER_SIZE 40
+
+static int parse_bmp(const csc_file_map_t *map, csc_image_view_t *view) {
+    const uint8_t *h = map->data;
+
+    if (map->size < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE ||
+        read_le32(h + 14) < BMP_INFO_HEADER_SIZE) {
+        return -1;
+    }
+    uint32_t offset = read_le32(h + 10);
+    int32_t width = (int32_t)read_le32(h + 18);
+    int32_t height = (int32_t)read_le32(h + 22);
+    uint32_t bpp = read_le16(h + 28);
+    uint32_t compression = read_le32(h + 30);
+
+    // only uncompressed (BI_RGB) 24 bpp maps onto the packed kernels
+    if (read_le16(h + 26) != 1 || bpp != 24 || compression != 0) {
+        return -1;
+    }
+    int top_down = height < 0;
+    if (top_down) {
+        height = -height;
+    }
+    if (width <= 0 || height <= 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return -1;
+    }
+
+    // rows are padded to 4 bytes
+    ptrdiff_t row_bytes = (3 * (ptrdiff_t)width + 3) & ~(ptrdiff_t)3;
+    if (offset > map->size || map->size - offset < (size_t)row_bytes * (size_t)height) {
+        return -1;
+    }
+
+    view->format = CSC_FORMAT_BMP;
+    view->width = width;
+    view->height = height;
+    view->maxval = 255;
+    view->packed.width = width;
+    view->packed.height = height;
+    view->packed.order = CSC_ORDER_BGR;
+    if (top_down) {
+        view->packed.data = map->data + offset;
+        view->packed.stride = row_bytes;
+    } else {
+        view->packed.data = map->data + offset + (size_t)row_bytes * (size_t)(height - 1);
+        view->packed.stride = -row_bytes;
+    }
+    return 0;
+}
+
+// P6 and P5; 16-bit samples are left to csc_ppm16_read
+static int parse_pnm(const csc_file_map_t *map, csc_image_view_t *view) {
+    int gray = map->data[1] == '5';
+    int width, height, maxval;
+    size_t offset = parse_pnm_header(map, gray ? "P5" : "P6", &width, &height, &maxval);
+
+    if (offset == 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return -1;
+    }
+    int channels = gray ? 1 : 3;
+    size_t sample_bytes = maxval > 255 ? 2 : 1;
+    if (map->size - offset < (size_t)width * height * channels * sample_bytes) {
+        return -1;
+    }
+
+    view->format = gray ? CSC_FORMAT_PGM : CSC_FORMAT_PPM;
+    view->width = width;
+    view->height = height;
+    view->maxval = maxval;
+    if (maxval > 255) {
+        return 0;
+    }
+    if (gray) {
+        view->gray.data = map->data + offset;
+        view->gray.width = width;
+        view->gray.height = height;
+        view->gray.stride = width;
+    } else {
+        view->packed.data = map->data + offset;
+        view->packed.width = width;
+        view->packed.height = height;
+        view->packed.stride = 3 * (ptrdiff_t)width;
+        view->packed.order = CSC_ORDER_RGB;
+    }
+    return 0;
+}
+
+int csc_image_parse(const csc_file_map_t *map, csc_image_view_t *view) {
+    memset(view, 0, sizeof *view);
+    view->format = CSC_FORMAT_RAW;
+
+    if (map->size >= 2 && map->data[0] == 'B' && map->data[1] == 'M') {
+        return parse_bmp(map, view);
+    }
+    if (map->size >= 2 && map->data[0] == 'P' && (map->data[1] == '5' || map->data[1] == '6')) {
+        return parse_pnm(map, view);
+    }
+    return 0;
+}
+
+int csc_ppm16_read(const char *path, csc_rgb16_image_t *rgb) {
+    csc_file_map_t map;
+    int width, height, maxval;
+    int status = -1;
+
+    rgb->R.data = rgb->G.data = rgb->B.data = NULL;
+    if (csc_file_map_read(&map, path) != 0) {
+        return -1;
+    }
+    size_t offset = parse_pnm_header(&map, "P6", &width, &height, &maxval);
+    if (offset == 0) {
+        goto done;
+    }
+
+    int bits = 8;
+    while ((maxval >> bits) != 0) {
+        bits++;
+    }
+    size_t sample_bytes = maxval > 255 ? 2 : 1;
+    if (map.size - offset < (size_t)width * height * 3 * sample_bytes ||
+        csc_rgb16_image_alloc(rgb, width, height, bits) != 0) {
+        goto done;
+    }
+
+    // P6 samples are big-endian when they take two bytes
+    const uint8_t *src = map.data + offset;
+    for (int row = 0; row < height; row++) {
+        uint16_t *R = PLANE_ROW(&rgb->R, row);
+        uint16_t *G = PLANE_ROW(&rgb->G, row);
+        uint16_t *B = PLANE_ROW(&rgb->B, row);
+        if (sample_bytes == 2) {
+            for (int col = 0; col < width; col++, src += 6) {
+                R[col] = (uint16_t)(src[0] << 8 | src[1]);
+                G[col] = (uint16_t)(src[2] << 8 | src[3]);
+                B[col] = (uint16_t)(src[4] << 8 | src[5]);
+            }
+        } else {
+            for (int col = 0; col < width; col++, src += 3) {
+                R[col] = src[0];
+                G[col] = src[1];
+                B[col] = src[2];
+            }
+        }
+    }
+    status = 0;
+
+done:
+    csc_file_unmap(&map);
+    return status;
+}
+
+int csc_ppm16_write(const char *path, const csc_rgb16_image_t *rgb) {
+    csc_file_map_t map;
+    int width = rgb->R.width, height = rgb->R.height;
+    size_t sample_bytes = rgb->bits > 8 ? 2 : 1;
+    char header[64];
+    int header_len = snprintf(header, sizeof header, "P6\n%d %d\n%d\n",
+                              width, height, (1 << rgb->bits) - 1);
+
+    if (csc_file_map_write(&map, path,
+                           (size_t)header_len + (size_t)width * height * 3 * sample_bytes) != 0) {
+        return -1;
+    }
+    memcpy(map.data, header, (size_t)header_len);
+
+    uint8_t *dst = map.data + header_len;
+    for (int row = 0; row < height; row++) {
+        const uint16_t *R = PLANE_ROW(&rgb->R, row);
+        const uint16_t *G = PLANE_ROW(&rgb->G, row);
+        const uint16_t *B = PLANE_ROW(&rgb->B, row);
+        if (sample_bytes == 2) {
+            for (int col = 0; col < width; col++, dst += 6) {
+                dst[0] = (uint8_t)(R[col] >> 8);
+                dst[1] = (uint8_t)R[col];
+                dst[2] = (uint8_t)(G[col] >> 8);
+                dst[3] = (uint8_t)G[col];
+                dst[4] = (uint8_t)(B[col] >> 8);
+                dst[5] = (uint8_t)B[col];
+            }
+        } else {
+            for (int col = 0; col < width; col++, dst += 3) {
+                dst[0] = (uint8_t)R[col];
+                dst[1] = (uint8_t)G[col];
+                dst[2] = (uint8_t)B[col];
+            }
+        }
+    }
+    csc_file_unmap(&map);
+    return 0;
+}
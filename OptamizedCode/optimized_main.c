@@ -1,155 +1,879 @@
+#define _POSIX_C_SOURCE 199309L
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "optimized_global.h"
 
-int main(int argc, char *argv[]) {
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
 
-    if (argc < 2) {
-        // If no input file is specified print this message
-        printf("Usage: %s <input_file>\n", argv[0]);
-        return 1;
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--kernel=block|row|lut|narrow] [--backend=auto|scalar|neon|sse4.1|avx2|avx512]\n"
+           "       [--order=rgb|bgr] [--threads=N] [--strip=ROWS] [--fused]\n"
+           "       [--chroma=420|422|444] [--downsample=average|drop|rgb]\n"
+           "       [--upsample=interpolate|replicate] [--profile[=text|json]] [--luma]\n"
+           "       [--roi=WxH+X+Y]\n"
+           "       <input_file> [width height]\n"
+           "       %s [--backend=...] [--threads=N] <input.ppm with maxval > 255>\n"
+           "       %s --batch=OUT_DIR [--size=WxH] [options] <file|dir|glob|@list>...\n"
+           "       %s --raw [--size=WxH] [--fps=F] [--incremental] [options] [input|-] > frames.i420\n"
+           "--threads=0 (default) uses one thread per CPU, 1 runs serially\n"
+           "--fused converts RGB->YCC->RGB in cache-sized strips and reports the\n"
+           "        reconstruction error\n"
+           "--strip streams the image through buffers of ROWS rows instead of\n"
+           "        holding it in memory\n"
+           "--batch converts every input (default size %dx%d) with the row kernels,\n"
+           "        overlapping reads, conversion and writes, into OUT_DIR/<name>.ppm;\n"
+           "        BMP and P6 inputs must be that size too\n"
+           "--raw converts back-to-back RGB frames (stdin by default) to I420 frames\n"
+           "        on stdout; --fps=F counts dropped and late frames against F;\n"
+           "        --incremental only reconverts the tiles that changed since the\n"
+           "        last frame and reports the fraction skipped\n"
+           "--profile reports time, cycles, instructions and cache misses per stage\n"
+           "        (counters where perf_event_open is permitted)\n"
+           "--downsample=rgb averages R, G and B and converts chroma once per\n"
+           "        sample, within %d of averaging per-pixel chroma\n"
+           "--kernel=narrow converts YCC->RGB in 16-bit lanes, within %d of the\n"
+           "        row kernels\n"
+           "--roi converts only that rectangle, widened to whole chroma blocks,\n"
+           "        into an otherwise black output_RGB.ppm\n"
+           "--luma converts RGB or grayscale input of any size to Y only, written\n"
+           "        to output_Y.pgm\n"
+           "24-bit BMP, P6 and P5 inputs are read in place at their own size;\n"
+           "        other files are raw RGB (default size %dx%d)\n"
+           "A 10- to 16-bit P6 input is converted in 16-bit planes into a P6 of the\n"
+           "same depth\n",
+           prog, prog, prog, prog, DEFAULT_IMAGE_COL_SIZE, DEFAULT_IMAGE_ROW_SIZE,
+           CSC_FAST_CHROMA_MAX_DEVIATION, CSC_NARROW_MAX_DEVIATION, DEFAULT_IMAGE_COL_SIZE, DEFAULT_IMAGE_ROW_SIZE);
+}
+
+// Fused mode: round trip through cache-sized strips taken from scratch,
+// timed as one conversion. Returns the time in ms, or -1 on failure.
+static double run_fused(const csc_packed_image_t *input, csc_packed_image_t *output,
+                        csc_frame_pool_t *scratch) {
+    csc_error_stats_t error;
+    struct timespec t_start, t_end;
+
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    CSC_PERF_BEGIN(CSC_STAGE_ROUND_TRIP);
+    int failed = optimized_round_trip(input, output, scratch, &error);
+    CSC_PERF_END(CSC_STAGE_ROUND_TRIP);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    if (failed) {
+        fprintf(stderr, "Fused round trip failed\n");
+        return -1.0;
     }
 
-    const char *input_filename = argv[1];
-    FILE *input_file = fopen(input_filename, "rb");
+    double ms = elapsed_ms(&t_start, &t_end);
+    double mse = (double)error.sum_sq / (double)error.samples;
+    printf("RGB->YCC->RGB (fused): %.3f ms, %.2f ns/pixel\n",
+           ms, ms * 1e6 / ((double)input->width * input->height));
+    if (mse > 0.0) {
+        printf("Reconstruction error: max %d, MSE %.3f, PSNR %.2f dB\n",
+               error.max_abs, mse, 10.0 * log10(255.0 * 255.0 / mse));
+    } else {
+        printf("Reconstruction error: none\n");
+    }
+    return ms;
+}
 
-    if (!input_file) {
+// Streaming mode: convert the file strip by strip into output_RGB.ppm
+static int run_streaming(const char *input_filename, int width, int height,
+                         csc_pixel_order_t order, int strip_rows) {
+    FILE *in = fopen(input_filename, "rb");
+    if (!in) {
         printf("Cannot open file.\n");
         return 1;
     }
+    FILE *out = fopen("output_RGB.ppm", "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open output_RGB.ppm\n");
+        fclose(in);
+        return 1;
+    }
+    printf("Streaming input file: %s (%dx%d)\n", input_filename, width, height);
 
-    printf("Opened input file: %s\n", input_filename);
+    csc_stream_stats_t stats;
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    int status = csc_stream_convert(in, out, width, height, order, strip_rows, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    fclose(in);
+    if (fclose(out) != 0) {
+        status = -1;
+    }
 
-    uint8_t R[IMAGE_ROW_SIZE][IMAGE_COL_SIZE];
-    uint8_t G[IMAGE_ROW_SIZE][IMAGE_COL_SIZE];
-    uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE];
+    if (status != 0) {
+        fprintf(stderr, "Streaming conversion failed (short input or write error)\n");
+        return 1;
+    }
+    double ms = elapsed_ms(&t_start, &t_end);
+    printf("Streamed %d strips of %d rows: %.3f ms, %.2f ns/pixel, %.1f MB/s\n",
+           stats.strips, stats.strip_rows, ms, ms * 1e6 / ((double)width * height),
+           2.0 * 3 * (double)width * height / (ms * 1e3));
+    printf("Strip buffers: %zu bytes\n", stats.buffer_bytes);
+    return 0;
+}
+
+// Batch mode: round trip every input into out_dir through the pipeline
+static int run_batch(char *const *args, int count, const char *out_dir,
+                     int width, int height, csc_pixel_order_t order) {
+    csc_path_list_t list = { NULL, 0, 0 };
+    csc_batch_stats_t stats;
 
-    for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-        for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-        // Removed the fputc lines since I don't think storing the R, G and B
-        // data into their own files has any use, and takes extra time
-            R[row][col] = (uint8_t)fgetc(input_file);
-            G[row][col] = (uint8_t)fgetc(input_file);
-            B[row][col] = (uint8_t)fgetc(input_file);
+    for (int i = 0; i < count; i++) {
+        if (csc_path_list_add(&list, args[i]) != 0) {
+            fprintf(stderr, "Cannot list inputs from '%s'\n", args[i]);
+            csc_path_list_free(&list);
+            return 1;
         }
     }
-    fclose(input_file);
+    if (list.count == 0) {
+        fprintf(stderr, "No input files\n");
+        return 1;
+    }
+    printf("Batch of %d images (%dx%d) into %s\n", list.count, width, height, out_dir);
 
-    if (return_all_output_files) {
-        // === Write R Channel as PGM ===
-        FILE *f_R = fopen("output_R.pgm", "w");
-        if (!f_R) {
-            fprintf(stderr, "Failed to open output_R.pgm\n");
+    int status = csc_batch_convert(list.paths, list.count, out_dir, width, height, order, &stats);
+    csc_path_list_free(&list);
+    if (status != 0 && stats.images == 0) {
+        fprintf(stderr, "Batch conversion failed\n");
+        return 1;
+    }
+    printf("Converted %d images (%d failed): %.3f ms, %.1f images/s\n",
+           stats.images, stats.failed, stats.total_ms, stats.images * 1e3 / stats.total_ms);
+    printf("Stage busy time: read %.3f ms, convert %.3f ms, write %.3f ms\n",
+           stats.read_ms, stats.convert_ms, stats.write_ms);
+    return status == 0 ? 0 : 1;
+}
+
+// Raw mode: RGB24/BGR24 frames from input ("-" for stdin) to I420 frames
+// on stdout until the input ends
+static int run_raw(const char *input_filename, int width, int height,
+                   csc_pixel_order_t order, double fps, int incremental) {
+    int in_fd = STDIN_FILENO;
+    if (strcmp(input_filename, "-") != 0) {
+        in_fd = open(input_filename, O_RDONLY);
+        if (in_fd < 0) {
+            fprintf(stderr, "Cannot open file.\n");
             return 1;
         }
-        fprintf(f_R, "P2\n%d %d\n255\n", IMAGE_COL_SIZE, IMAGE_ROW_SIZE);
-        for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-            for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-                fprintf(f_R, "%3d ", R[row][col]);
+    }
+    // a closed reader should end the stream with an error, not a signal
+    signal(SIGPIPE, SIG_IGN);
+
+    csc_frame_stats_t stats;
+    int status = csc_frame_stream(in_fd, STDOUT_FILENO, width, height, order, fps, incremental, &stats);
+    if (in_fd != STDIN_FILENO) {
+        close(in_fd);
+    }
+
+    double seconds = stats.total_ms / 1e3;
+    fprintf(stderr, "Frames: %llu converted, %llu dropped, %llu late",
+            (unsigned long long)stats.frames, (unsigned long long)stats.dropped,
+            (unsigned long long)stats.late);
+    if (seconds > 0.0) {
+        fprintf(stderr, "; %.1f frames/s, %.3f ms conversion per frame",
+                stats.frames / seconds, stats.frames ? stats.convert_ms / stats.frames : 0.0);
+    }
+    fprintf(stderr, "\n");
+    if (incremental && stats.tiles) {
+        fprintf(stderr, "Tiles: %.1f%% of %llu skipped as unchanged (%dx%d tiles)\n",
+                100.0 * (double)stats.tiles_skipped / (double)stats.tiles,
+                (unsigned long long)stats.tiles, CSC_TILE_WIDTH, CSC_TILE_HEIGHT);
+    }
+    if (stats.trailing_bytes) {
+        fprintf(stderr, "Ignored an incomplete last frame of %zu bytes\n", stats.trailing_bytes);
+    }
+    if (status != 0) {
+        fprintf(stderr, "Frame stream failed (read or write error)\n");
+        return 1;
+    }
+    return 0;
+}
+
+// High bit depth mode: a P6 with maxval above 255 is converted in 16-bit
+// planes, round trip into a P6 of the same depth
+static int run_high_depth(const char *input_filename) {
+    csc_rgb16_image_t rgb, out = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, 0 };
+    csc_ycc16_image_t ycc = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, 0 };
+    struct timespec t_start, t_end;
+    int status = 1;
+
+    if (csc_ppm16_read(input_filename, &rgb) != 0) {
+        fprintf(stderr, "Cannot read %s as a P6 image\n", input_filename);
+        return 1;
+    }
+    int width = rgb.R.width, height = rgb.R.height;
+    printf("Opened input file: %s (%dx%d, %d-bit)\n", input_filename, width, height, rgb.bits);
+    if (csc_ycc16_image_alloc(&ycc, width, height, rgb.bits) != 0 ||
+        csc_rgb16_image_alloc(&out, width, height, rgb.bits) != 0) {
+        fprintf(stderr, "Failed to allocate 16-bit planes\n");
+        goto done;
+    }
+
+    const char *kernel_name = csc_hbd_kernels()->name;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    optimized_RGB16_to_YCC16(&rgb, &ycc);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    double ms = elapsed_ms(&t_start, &t_end);
+    printf("RGB->YCC (16-bit %s kernel): %.3f ms, %.2f ns/pixel\n",
+           kernel_name, ms, ms * 1e6 / ((double)width * height));
+
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    optimized_YCC16_to_RGB16(&ycc, &out);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    ms = elapsed_ms(&t_start, &t_end);
+    printf("YCC->RGB (16-bit %s kernel): %.3f ms, %.2f ns/pixel\n",
+           kernel_name, ms, ms * 1e6 / ((double)width * height));
+
+    // the round trip error, in units of the input's bit depth
+    double sum_sq = 0.0;
+    int max_abs = 0;
+    const csc_plane16_t *in_planes[3] = { &rgb.R, &rgb.G, &rgb.B };
+    const csc_plane16_t *out_planes[3] = { &out.R, &out.G, &out.B };
+    for (int p = 0; p < 3; p++) {
+        for (int row = 0; row < height; row++) {
+            const uint16_t *a = PLANE_ROW(in_planes[p], row), *b = PLANE_ROW(out_planes[p], row);
+            for (int col = 0; col < width; col++) {
+                int d = abs(a[col] - b[col]);
+                sum_sq += (double)d * d;
+                max_abs = d > max_abs ? d : max_abs;
             }
-            fprintf(f_R, "\n");
         }
-        fclose(f_R);
+    }
+    double mse = sum_sq / (3.0 * width * height);
+    double peak = (double)((1 << rgb.bits) - 1);
+    if (mse > 0.0) {
+        printf("Reconstruction error: max %d, MSE %.3f, PSNR %.2f dB\n",
+               max_abs, mse, 10.0 * log10(peak * peak / mse));
+    } else {
+        printf("Reconstruction error: none\n");
+    }
+
+    if (csc_ppm16_write("output_RGB.ppm", &out) != 0) {
+        fprintf(stderr, "Failed to write output_RGB.ppm\n");
+        goto done;
+    }
+    status = 0;
+
+done:
+    csc_rgb16_image_free(&out);
+    csc_ycc16_image_free(&ycc);
+    csc_rgb16_image_free(&rgb);
+    return status;
+}
 
-        // === Write G Channel as PGM ===
-        FILE *f_G = fopen("output_G.pgm", "w");
-        if (!f_G) {
-            fprintf(stderr, "Failed to open output_G.pgm\n");
+int main(int argc, char *argv[]) {
+
+    static const struct option long_options[] = {
+        { "kernel", required_argument, NULL, 'k' },
+        { "backend", required_argument, NULL, 'b' },
+        { "order",  required_argument, NULL, 'o' },
+        { "threads", required_argument, NULL, 't' },
+        { "strip",  required_argument, NULL, 's' },
+        { "fused",  no_argument,       NULL, 'f' },
+        { "batch",  required_argument, NULL, 'B' },
+        { "size",   required_argument, NULL, 'z' },
+        { "raw",    no_argument,       NULL, 'r' },
+        { "fps",    required_argument, NULL, 'F' },
+        { "incremental", no_argument,  NULL, 'i' },
+        { "chroma", required_argument, NULL, 'c' },
+        { "downsample", required_argument, NULL, 'd' },
+        { "upsample", required_argument, NULL, 'u' },
+        { "profile", optional_argument, NULL, 'p' },
+        { "luma",   no_argument,       NULL, 'l' },
+        { "roi",    required_argument, NULL, 'R' },
+        { "help",   no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    // The row kernels read and write the packed pixels directly; the block
+    // kernels only take planes and are fed through a planar copy. The LUT
+    // kernels are row kernels that look products up instead of multiplying;
+    // the narrow kernels are row kernels with 16-bit-lane YCC->RGB.
+    int use_block = 0;
+    int use_lut = 0;
+    int use_narrow = 0;
+    int luma = 0; // Y only, no chroma and no YCC->RGB
+    int use_roi = 0;
+    csc_rect_t roi = { 0, 0, 0, 0 };
+    int profile = 0; // 1: table, 2: JSON
+    const char *kernel_name = "row";
+    csc_pixel_order_t order = CSC_ORDER_RGB;
+    int threads = 0;
+    int strip_rows = 0;
+    int fused = 0;
+    const char *batch_dir = NULL;
+    csc_chroma_mode_t chroma = { CSC_CHROMA_420, CSC_DOWNSAMPLE_AVERAGE, CSC_UPSAMPLE_INTERPOLATE };
+    int raw = 0;
+    double fps = 0.0;
+    int incremental = 0;
+    // --size, for the modes that take many images or frames
+    int size_width = DEFAULT_IMAGE_COL_SIZE;
+    int size_height = DEFAULT_IMAGE_ROW_SIZE;
+    csc_backend_t backend = CSC_BACKEND_AUTO;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "k:b:o:t:s:fB:z:rF:ic:d:u:lR:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'k':
+                use_block = strcmp(optarg, "block") == 0;
+                use_lut = strcmp(optarg, "lut") == 0;
+                use_narrow = strcmp(optarg, "narrow") == 0;
+                if (!use_block && !use_lut && !use_narrow && strcmp(optarg, "row") != 0) {
+                    fprintf(stderr, "Unknown kernel '%s'\n", optarg);
+                    return 1;
+                }
+                kernel_name = optarg;
+                break;
+            case 'b':
+                backend = csc_backend_parse(optarg);
+                if (backend == CSC_BACKEND_COUNT) {
+                    fprintf(stderr, "Unknown backend '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (strcmp(optarg, "rgb") == 0) {
+                    order = CSC_ORDER_RGB;
+                } else if (strcmp(optarg, "bgr") == 0) {
+                    order = CSC_ORDER_BGR;
+                } else {
+                    fprintf(stderr, "Unknown pixel order '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                threads = atoi(optarg);
+                if (threads < 0) {
+                    fprintf(stderr, "Thread count must not be negative\n");
+                    return 1;
+                }
+                break;
+            case 's':
+                strip_rows = atoi(optarg);
+                if (strip_rows < 2) {
+                    fprintf(stderr, "Strip height must be at least 2 rows\n");
+                    return 1;
+                }
+                break;
+            case 'f':
+                fused = 1;
+                break;
+            case 'l':
+                luma = 1;
+                break;
+            case 'R':
+                if (sscanf(optarg, "%dx%d+%d+%d", &roi.width, &roi.height, &roi.x, &roi.y) != 4) {
+                    fprintf(stderr, "Region must be WxH+X+Y\n");
+                    return 1;
+                }
+                use_roi = 1;
+                break;
+            case 'B':
+                batch_dir = optarg;
+                break;
+            case 'z':
+                if (sscanf(optarg, "%dx%d", &size_width, &size_height) != 2) {
+                    fprintf(stderr, "Size must be WxH\n");
+                    return 1;
+                }
+                break;
+            case 'r':
+                raw = 1;
+                break;
+            case 'F':
+                fps = atof(optarg);
+                if (fps < 0.0) {
+                    fprintf(stderr, "Frame rate must not be negative\n");
+                    return 1;
+                }
+                break;
+            case 'i':
+                incremental = 1;
+                break;
+            case 'c':
+                if (strcmp(optarg, "420") == 0) {
+                    chroma.format = CSC_CHROMA_420;
+                } else if (strcmp(optarg, "422") == 0) {
+                    chroma.format = CSC_CHROMA_422;
+                } else if (strcmp(optarg, "444") == 0) {
+                    chroma.format = CSC_CHROMA_444;
+                } else {
+                    fprintf(stderr, "Unknown chroma format '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'd':
+                if (strcmp(optarg, "average") == 0) {
+                    chroma.down = CSC_DOWNSAMPLE_AVERAGE;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    chroma.down = CSC_DOWNSAMPLE_DROP;
+                } else if (strcmp(optarg, "rgb") == 0) {
+                    chroma.down = CSC_DOWNSAMPLE_RGB;
+                } else {
+                    fprintf(stderr, "Unknown downsampling filter '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (!optarg || strcmp(optarg, "text") == 0) {
+                    profile = 1;
+                } else if (strcmp(optarg, "json") == 0) {
+                    profile = 2;
+                } else {
+                    fprintf(stderr, "Unknown profile format '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'u':
+                if (strcmp(optarg, "interpolate") == 0) {
+                    chroma.up = CSC_UPSAMPLE_INTERPOLATE;
+                } else if (strcmp(optarg, "replicate") == 0) {
+                    chroma.up = CSC_UPSAMPLE_REPLICATE;
+                } else {
+                    fprintf(stderr, "Unknown upsampling filter '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc && !raw) {
+        // If no input file is specified print this message
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // only the single-image row path takes other chroma modes; the block
+    // kernels also have 4:2:0 fast-chroma variants
+    int default_chroma = chroma.format == CSC_CHROMA_420 &&
+                         chroma.down == CSC_DOWNSAMPLE_AVERAGE &&
+                         chroma.up == CSC_UPSAMPLE_INTERPOLATE;
+    int fast_chroma = chroma.format == CSC_CHROMA_420 && chroma.down == CSC_DOWNSAMPLE_RGB;
+    if (!default_chroma && ((use_block && !(fast_chroma && chroma.up == CSC_UPSAMPLE_INTERPOLATE)) || use_lut || use_narrow || fused || strip_rows > 0 || batch_dir || raw)) {
+        fprintf(stderr, "--chroma, --downsample and --upsample only apply to the row kernels\n"
+                        "on a single image\n");
+        return 1;
+    }
+    if ((use_lut || use_narrow) && (fused || strip_rows > 0 || batch_dir || raw)) {
+        fprintf(stderr, "--kernel=%s only applies to a single image\n", kernel_name);
+        return 1;
+    }
+    if (luma && (use_block || use_lut || use_narrow || !default_chroma || fused || strip_rows > 0 ||
+                 batch_dir || raw)) {
+        fprintf(stderr, "--luma only takes --backend, --order, --threads and --profile\n");
+        return 1;
+    }
+    if (use_roi && (use_block || use_lut || use_narrow || luma || !default_chroma || fused ||
+                    strip_rows > 0 || batch_dir || raw)) {
+        fprintf(stderr, "--roi only applies to the row kernels on a single image\n");
+        return 1;
+    }
+    if (incremental && !raw) {
+        fprintf(stderr, "--incremental only applies to --raw\n");
+        return 1;
+    }
+    if (profile && (strip_rows > 0 || batch_dir || raw)) {
+        fprintf(stderr, "--profile only applies to a single image\n");
+        return 1;
+    }
+
+    if (csc_backend_select(backend) != 0) {
+        fprintf(stderr, "Requested backend is not available on this CPU\n");
+        return 1;
+    }
+
+    if (raw) {
+        // stdout carries the frames, so everything else goes to stderr
+        if (use_block || fused || strip_rows > 0 || batch_dir) {
+            fprintf(stderr, "--raw cannot be combined with --kernel=block, --fused, --strip or --batch\n");
             return 1;
         }
-        fprintf(f_G, "P2\n%d %d\n255\n", IMAGE_COL_SIZE, IMAGE_ROW_SIZE);
-        for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-            for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-                fprintf(f_G, "%3d ", G[row][col]);
-            }
-            fprintf(f_G, "\n");
+        if (size_width <= 0 || size_height <= 0 || (size_width & 1) || (size_height & 1)) {
+            fprintf(stderr, "Image width and height must be positive and even (got %dx%d)\n",
+                    size_width, size_height);
+            return 1;
         }
-        fclose(f_G);
+        fprintf(stderr, "Using %s backend\n", csc_backend_kernels()->name);
+        threads = csc_threads_init(threads);
+        fprintf(stderr, "Using %d thread%s\n", threads, threads == 1 ? "" : "s");
+        int status = run_raw(optind < argc ? argv[optind] : "-", size_width, size_height, order, fps, incremental);
+        csc_threads_shutdown();
+        return status;
+    }
+    printf("Using %s backend\n", csc_backend_kernels()->name);
+    if (use_lut) {
+        kernel_name = csc_lut_kernels()->name;
+    }
+    if (use_narrow) {
+        kernel_name = csc_narrow_kernels()->name;
+    }
+    // fast chroma only replaces RGB->YCC; YCC->RGB keeps its kernels
+    const char *inverse_name = kernel_name;
+    if (fast_chroma && !use_block) {
+        kernel_name = csc_fast_chroma_kernels()->name;
+    }
+    if (luma) {
+        kernel_name = csc_luma_kernels()->name;
+    }
+
 
-        // === Write B Channel as PGM ===
-        FILE *f_B = fopen("output_B.pgm", "w");
-        if (!f_B) {
-            fprintf(stderr, "Failed to open output_B.pgm\n");
+    if (batch_dir) {
+        if (use_block || fused || strip_rows > 0) {
+            fprintf(stderr, "--batch cannot be combined with --kernel=block, --fused or --strip\n");
             return 1;
         }
-        fprintf(f_B, "P2\n%d %d\n255\n", IMAGE_COL_SIZE, IMAGE_ROW_SIZE);
-        for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-            for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-                fprintf(f_B, "%3d ", B[row][col]);
-            }
-            fprintf(f_B, "\n");
+        if (size_width <= 0 || size_height <= 0 || (size_width & 1) || (size_height & 1)) {
+            fprintf(stderr, "Image width and height must be positive and even (got %dx%d)\n",
+                    size_width, size_height);
+            return 1;
         }
-        fclose(f_B);
+        threads = csc_threads_init(threads);
+        printf("Using %d thread%s\n", threads, threads == 1 ? "" : "s");
+        int status = run_batch(argv + optind, argc - optind, batch_dir,
+                               size_width, size_height, order);
+        csc_threads_shutdown();
+        return status;
     }
 
-    uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE];
-    uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1];
-    uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1];
+    const char *input_filename = argv[optind];
+    struct timespec t_start, t_end, t_io_start;
+    double convert_ms = 0.0;
 
-    // Call the conversion function
-    optimized_RGB_to_YCC(R, G, B, Y, Cb, Cr);
+    // The input is mapped rather than read, and converted from the mapping.
+    // BMP and PNM files are recognised by their header; anything else is
+    // taken as raw packed pixels. Profiling starts before the worker pool
+    // so its threads inherit the counters.
+    if (profile) {
+        int counters = csc_perf_enable();
+        printf("Profiling stages with %d of 3 hardware counters\n", counters);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_io_start);
+    CSC_PERF_BEGIN(CSC_STAGE_INPUT);
+    csc_file_map_t in_map, out_map = { NULL, 0 };
+    csc_image_view_t view;
+    if (csc_file_map_read(&in_map, input_filename) != 0) {
+        printf("Cannot open file.\n");
+        return 1;
+    }
+    if (csc_image_parse(&in_map, &view) != 0) {
+        fprintf(stderr, "Unsupported or truncated image file: %s\n", input_filename);
+        csc_file_unmap(&in_map);
+        return 1;
+    }
 
-    if(return_all_output_files){
-        // === Write Y as PGM ===
-        FILE *f_Y = fopen("output_Y.pgm", "w");
-        if (!f_Y) {
-            fprintf(stderr, "Failed to write output_Y.pgm\n");
+    // P6 input deeper than 8 bits goes through the 16-bit kernels
+    if (view.format == CSC_FORMAT_PPM && view.maxval > 255) {
+        csc_file_unmap(&in_map);
+        if (use_block || use_lut || use_narrow || luma || fused || strip_rows > 0 || !default_chroma || profile) {
+            fprintf(stderr, "High bit depth input only runs the 4:2:0 row kernels, unprofiled\n");
             return 1;
         }
-        fprintf(f_Y, "P2\n%d %d\n255\n", IMAGE_COL_SIZE, IMAGE_ROW_SIZE);
-        for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-            for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-                fprintf(f_Y, "%3d ", Y[row][col]);
-            }
-            fprintf(f_Y, "\n");
-        }
-        fclose(f_Y);
-    
-        // === Write Cb as PGM ===
-        FILE *f_Cb = fopen("output_Cb.pgm", "w");
-        if (!f_Cb) {
-            fprintf(stderr, "Failed to write output_Cb.pgm\n");
+        threads = csc_threads_init(threads);
+        printf("Using %d thread%s\n", threads, threads == 1 ? "" : "s");
+        int status = run_high_depth(input_filename);
+        csc_threads_shutdown();
+        return status;
+    }
+    if (view.format == CSC_FORMAT_PGM && (view.maxval > 255 || fused || !default_chroma)) {
+        fprintf(stderr, "Grayscale input only runs 8-bit 4:2:0 without --fused\n");
+        csc_file_unmap(&in_map);
+        return 1;
+    }
+
+    // the strip path reads raw files itself
+    if (strip_rows > 0 && view.format != CSC_FORMAT_RAW) {
+        fprintf(stderr, "--strip only reads raw input\n");
+        csc_file_unmap(&in_map);
+        return 1;
+    }
+
+    int width = DEFAULT_IMAGE_COL_SIZE;
+    int height = DEFAULT_IMAGE_ROW_SIZE;
+    if (view.format != CSC_FORMAT_RAW) {
+        width = view.width;
+        height = view.height;
+    } else if (argc - optind >= 3) {
+        width = atoi(argv[optind + 1]);
+        height = atoi(argv[optind + 2]);
+    }
+    // Luma has no chroma grid, and the drivers of every chroma mode peel
+    // an odd last column and row; --fused and --strip work in whole 2x2
+    // blocks only
+    int odd_ok = luma || (!fused && strip_rows == 0);
+    if (width <= 0 || height <= 0 || (!odd_ok && ((width & 1) || (height & 1)))) {
+        fprintf(stderr, "Image width and height must be positive%s (got %dx%d)\n",
+                odd_ok ? "" : " and even", width, height);
+        csc_file_unmap(&in_map);
+        return 1;
+    }
+
+    // timings are per pixel of the region actually converted
+    csc_rect_t region = { 0, 0, width, height };
+    if (use_roi && csc_roi_align(&roi, width, height, &region) != 0) {
+        fprintf(stderr, "Region %dx%d+%d+%d is not inside the %dx%d image\n",
+                roi.width, roi.height, roi.x, roi.y, width, height);
+        csc_file_unmap(&in_map);
+        return 1;
+    }
+    double pixels = (double)region.width * region.height;
+
+    if (strip_rows > 0) {
+        csc_file_unmap(&in_map);
+        threads = csc_threads_init(threads);
+        printf("Using %d thread%s\n", threads, threads == 1 ? "" : "s");
+        int status = run_streaming(input_filename, width, height, order, strip_rows);
+        csc_threads_shutdown();
+        return status;
+    }
+
+    static const char *const format_names[] = { "raw", "BMP", "PPM", "PGM" };
+    int gray = view.format == CSC_FORMAT_PGM;
+    size_t image_bytes = (size_t)width * (size_t)height * (gray ? 1 : 3);
+    size_t output_bytes = luma ? (size_t)width * (size_t)height : image_bytes;
+    if (view.format == CSC_FORMAT_RAW && in_map.size < image_bytes) {
+        fprintf(stderr, "Input file is shorter than %dx%d pixels\n", width, height);
+        csc_file_unmap(&in_map);
+        return 1;
+    }
+
+    printf("Opened input file: %s (%s, %dx%d)\n", input_filename, format_names[view.format], width, height);
+    if (use_roi) {
+        printf("Region: %dx%d+%d+%d\n", region.width, region.height, region.x, region.y);
+    }
+
+    // The mapping is read-only; the packed image is only ever read through
+    // the const input of the conversions. BMP rows run bottom-up, which the
+    // header view expresses as a negative stride. Grayscale feeds the one
+    // plane as R, G and B.
+    csc_packed_image_t input = { in_map.data, width, height, 3 * (ptrdiff_t)width, order };
+    if (view.format == CSC_FORMAT_BMP || view.format == CSC_FORMAT_PPM) {
+        input = view.packed;
+    }
+    csc_packed_image_t output;
+    csc_rgb_image_t rgb = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 } };
+    csc_ycc_image_t ycc = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 } };
+    csc_rgb_image_t gray_rgb = { view.gray, view.gray, view.gray };
+    const csc_rgb_image_t *planes = gray ? &gray_rgb : &rgb;
+    csc_plane_t luma_plane = { NULL, 0, 0, 0 };
+
+    // The YCC planes, and the RGB planes the block kernels work on, come as
+    // one frame with its planes spread over the cache sets; fused mode
+    // takes its strips from the same pool once the thread count is known
+    int frame_planes = 0;
+    if (!fused && !luma) {
+        frame_planes = CSC_FRAME_YCC;
+        if (use_block || (!gray && return_all_output_files)) {
+            frame_planes |= CSC_FRAME_RGB;
+        }
+    }
+    csc_frame_pool_t frames;
+    csc_frame_t *frame = NULL;
+    memset(&frames, 0, sizeof frames);
+    if (frame_planes) {
+        if (csc_frame_pool_init(&frames, 1, width, height, chroma.format, frame_planes) != 0) {
+            fprintf(stderr, "Failed to allocate image planes\n");
+            csc_file_unmap(&in_map);
             return 1;
         }
+        frame = csc_frame_pool_get(&frames);
+        rgb = frame->rgb;
+        ycc = frame->ycc;
+    }
 
-        // === Write Cr as PGM ===
-        FILE *f_Cr = fopen("output_Cr.pgm", "w");
-        if (!f_Cr) {
-            fprintf(stderr, "Failed to write output_Cr.pgm\n");
-            return 1;
+    // Only the row kernels run in bands; the block kernels stay serial
+    threads = csc_threads_init(use_block && !fused ? 1 : threads);
+    printf("Using %d thread%s\n", threads, threads == 1 ? "" : "s");
+
+    int status = 0;
+
+    if (fused && csc_round_trip_pool_init(&frames, width, 0) != 0) {
+        fprintf(stderr, "Failed to allocate the round trip strips\n");
+        status = 1;
+        goto done;
+    }
+    if (!gray && (frame_planes & CSC_FRAME_RGB)) {
+        csc_packed_to_planes(&input, &rgb);
+    }
+    if (luma && csc_plane_alloc(&luma_plane, width, height) != 0) {
+        fprintf(stderr, "Failed to allocate the Y plane\n");
+        status = 1;
+        goto done;
+    }
+    CSC_PERF_END(CSC_STAGE_INPUT);
+
+    if (luma) {
+        // Y straight from the mapped input; profiled as the RGB->YCC stage
+        clock_gettime(CLOCK_MONOTONIC, &t_start);
+        CSC_PERF_BEGIN(CSC_STAGE_RGB_TO_YCC);
+        if (gray) {
+            optimized_RGB_to_Y(planes, &luma_plane);
+        } else {
+            optimized_packed_to_Y(&input, &luma_plane);
         }
+        CSC_PERF_END(CSC_STAGE_RGB_TO_YCC);
+        clock_gettime(CLOCK_MONOTONIC, &t_end);
 
+        convert_ms = elapsed_ms(&t_start, &t_end);
+        printf("RGB->Y (%s luma kernel): %.3f ms, %.2f ns/pixel\n",
+               kernel_name, convert_ms, convert_ms * 1e6 / ((double)width * height));
 
-        fprintf(f_Cb, "P2\n%d %d\n255\n", IMAGE_COL_SIZE >> 1, IMAGE_ROW_SIZE >> 1);
-        fprintf(f_Cr, "P2\n%d %d\n255\n", IMAGE_COL_SIZE >> 1, IMAGE_ROW_SIZE >> 1);
+        CSC_PERF_BEGIN(CSC_STAGE_OUTPUT);
+        if (csc_write_pgm("output_Y.pgm", &luma_plane) != 0) {
+            fprintf(stderr, "Failed to write output_Y.pgm\n");
+            status = 1;
+            goto done;
+        }
+        CSC_PERF_END(CSC_STAGE_OUTPUT);
+        goto finish;
+    }
 
-        for (int row = 0; row < (IMAGE_ROW_SIZE >> 1); row++) {
-            for (int col = 0; col < (IMAGE_COL_SIZE >> 1); col++) {
-                fprintf(f_Cb, "%3d ", Cb[row][col]);
-                fprintf(f_Cr, "%3d ", Cr[row][col]);
-            }
-            fprintf(f_Cb, "\n");
-            fprintf(f_Cr, "\n");
+    if (fused) {
+        // no full-size YCC planes: each strip goes straight back to RGB
+        CSC_PERF_BEGIN(CSC_STAGE_OUTPUT);
+        if (csc_ppm_map_write(&out_map, &output, "output_RGB.ppm", width, height) != 0) {
+            fprintf(stderr, "Failed to create output_RGB.ppm\n");
+            status = 1;
+            goto done;
+        }
+        CSC_PERF_END(CSC_STAGE_OUTPUT);
+        convert_ms = run_fused(&input, &output, &frames);
+        if (convert_ms < 0.0) {
+            status = 1;
+            goto done;
         }
-        fclose(f_Cb);
-        fclose(f_Cr);
+        goto finish;
     }
-    optimized_YCC_to_RGB(Y, Cb, Cr, R, G, B);
 
-    FILE *f_output = fopen("output_RGB.pgm", "w");
-    if (!f_output) {
-        fprintf(stderr, "Failed to open output_RGB.pgm\n");
-        return 1;
+    if (return_all_output_files) {
+        CSC_PERF_BEGIN(CSC_STAGE_DUMP);
+        if (csc_write_pgm("output_R.pgm", &planes->R) ||
+            csc_write_pgm("output_G.pgm", &planes->G) ||
+            csc_write_pgm("output_B.pgm", &planes->B)) {
+            fprintf(stderr, "Failed to write R/G/B planes\n");
+            status = 1;
+            goto done;
+        }
+        CSC_PERF_END(CSC_STAGE_DUMP);
     }
-    fprintf(f_output, "P3\n%d %d\n255\n", IMAGE_COL_SIZE, IMAGE_ROW_SIZE);
-    for (int row = 0; row < IMAGE_ROW_SIZE; row++) {
-        for (int col = 0; col < IMAGE_COL_SIZE; col++) {
-            fprintf(f_output, "%3d %3d %3d  ", R[row][col], G[row][col], B[row][col]);
+
+    // Call the conversion function
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    CSC_PERF_BEGIN(CSC_STAGE_RGB_TO_YCC);
+    if (use_block && fast_chroma) {
+        optimized_RGB_to_YCC_block_fast_chroma(planes, &ycc);
+    } else if (use_block) {
+        optimized_RGB_to_YCC_block(planes, &ycc);
+    } else if (use_roi) {
+        if (gray) {
+            optimized_RGB_to_YCC_roi(planes, &ycc, &region);
+        } else {
+            optimized_packed_to_YCC_roi(&input, &ycc, &region);
+        }
+    } else if (gray) {
+        if (use_lut) {
+            optimized_RGB_to_YCC_lut(planes, &ycc);
+        } else {
+            optimized_RGB_to_YCC(planes, &ycc);
         }
-        fprintf(f_output, "\n");
+    } else if (use_lut) {
+        optimized_packed_to_YCC_lut(&input, &ycc);
+    } else {
+        optimized_packed_to_YCC_mode(&input, &ycc, &chroma);
     }
-    fclose(f_output);
+    CSC_PERF_END(CSC_STAGE_RGB_TO_YCC);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
 
-    return 0;
-}
\ No newline at end of file
+    double ms = elapsed_ms(&t_start, &t_end);
+    convert_ms += ms;
+    printf("RGB->YCC (%s kernel): %.3f ms, %.2f ns/pixel\n",
+           kernel_name, ms, ms * 1e6 / pixels);
+
+    if(return_all_output_files){
+        CSC_PERF_BEGIN(CSC_STAGE_DUMP);
+        if (csc_write_pgm("output_Y.pgm", &ycc.Y) ||
+            csc_write_pgm("output_Cb.pgm", &ycc.Cb) ||
+            csc_write_pgm("output_Cr.pgm", &ycc.Cr)) {
+            fprintf(stderr, "Failed to write Y/Cb/Cr planes\n");
+            status = 1;
+            goto done;
+        }
+        CSC_PERF_END(CSC_STAGE_DUMP);
+    }
+
+    // The output file is created at its final size and the conversion
+    // writes straight into its mapping
+    CSC_PERF_BEGIN(CSC_STAGE_OUTPUT);
+    if (csc_ppm_map_write(&out_map, &output, "output_RGB.ppm", width, height) != 0) {
+        fprintf(stderr, "Failed to create output_RGB.ppm\n");
+        status = 1;
+        goto done;
+    }
+    CSC_PERF_END(CSC_STAGE_OUTPUT);
+
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    CSC_PERF_BEGIN(CSC_STAGE_YCC_TO_RGB);
+    if (use_block) {
+        optimized_YCC_to_RGB_block(&ycc, &rgb);
+    } else if (use_lut) {
+        optimized_YCC_to_packed_lut(&ycc, &output);
+    } else if (use_narrow) {
+        optimized_YCC_to_packed_narrow(&ycc, &output);
+    } else if (use_roi) {
+        optimized_YCC_to_packed_roi(&ycc, &output, &region);
+    } else {
+        optimized_YCC_to_packed_mode(&ycc, &output, &chroma);
+    }
+    CSC_PERF_END(CSC_STAGE_YCC_TO_RGB);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+    ms = elapsed_ms(&t_start, &t_end);
+    convert_ms += ms;
+    printf("YCC->RGB (%s kernel): %.3f ms, %.2f ns/pixel\n",
+           inverse_name, ms, ms * 1e6 / pixels);
+
+finish:
+    // the block kernels leave the output in planes
+    CSC_PERF_BEGIN(CSC_STAGE_OUTPUT);
+    if (use_block && !fused) {
+        csc_planes_to_packed(&rgb, &output);
+    }
+    csc_file_unmap(&out_map);
+    csc_file_unmap(&in_map);
+    CSC_PERF_END(CSC_STAGE_OUTPUT);
+
+    // Everything outside the two conversions counts as I/O. Throughput is
+    // the input plus output pixel bytes over the end-to-end time.
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    ms = elapsed_ms(&t_io_start, &t_end);
+    printf("I/O: %.3f ms; end to end: %.3f ms, %.1f MB/s\n",
+           ms - convert_ms, ms, (double)(image_bytes + output_bytes) / (ms * 1e3));
+    if (profile) {
+        csc_perf_report(stdout, profile == 2);
+    }
+
+done:
+    csc_perf_disable();
+    csc_threads_shutdown();
+    csc_file_unmap(&out_map);
+    csc_file_unmap(&in_map);
+    if (frame) {
+        csc_frame_pool_put(&frames, frame);
+    }
+    csc_frame_pool_destroy(&frames);
+    csc_plane_free(&luma_plane);
+    return status;
+}
@@ -0,0 +1,164 @@
+// optimized_perf.c
+// Per-stage instrumentation of the single-image path: wall time per stage
+// and, where the kernel allows it, cycles, instructions and cache misses
+// from perf_event_open. Nothing is measured until csc_perf_enable is
+// called; until then the CSC_PERF_* macros are one untaken branch.
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "optimized_global.h"
+
+#define PERF_COUNTERS 3
+
+int csc_perf_enabled = 0;
+
+static const char *const stage_names[CSC_STAGE_COUNT] = {
+    "input", "rgb_to_ycc", "dump", "ycc_to_rgb", "output", "round_trip"
+};
+
+static const char *const counter_names[PERF_COUNTERS] = {
+    "cycles", "instructions", "cache_misses"
+};
+
+static struct {
+    int fd[PERF_COUNTERS]; // -1 where the counter could not be opened
+    struct timespec start[CSC_STAGE_COUNT];
+    uint64_t start_count[CSC_STAGE_COUNT][PERF_COUNTERS];
+    csc_stage_stats_t stats[CSC_STAGE_COUNT];
+} perf;
+
+#ifdef __linux__
+// A user-space-only counter for the calling thread on any CPU, inherited
+// by the threads it creates afterwards. Reading it sums them all, so a
+// stage counts the bands of every pool worker. Kernels that restrict
+// perf_event_open refuse this, and the counter is left out.
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static uint64_t read_counter(int fd) {
+    uint64_t value = 0;
+
+    if (fd < 0 || read(fd, &value, sizeof value) != sizeof value) {
+        return 0;
+    }
+    return value;
+}
+
+int csc_perf_enable(void) {
+    int opened = 0;
+
+    memset(&perf, 0, sizeof perf);
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        perf.fd[c] = -1;
+    }
+#ifdef __linux__
+    static const uint64_t configs[PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+    };
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        perf.fd[c] = open_counter(configs[c]);
+        opened += perf.fd[c] >= 0;
+    }
+#endif
+    csc_perf_enabled = 1;
+    return opened;
+}
+
+void csc_perf_disable(void) {
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (perf.fd[c] >= 0) {
+            close(perf.fd[c]);
+        }
+        perf.fd[c] = -1;
+    }
+    csc_perf_enabled = 0;
+}
+
+void csc_perf_stage_begin(csc_stage_t stage) {
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        perf.start_count[stage][c] = read_counter(perf.fd[c]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &perf.start[stage]);
+}
+
+void csc_perf_stage_end(csc_stage_t stage) {
+    struct timespec now;
+    csc_stage_stats_t *s = &perf.stats[stage];
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    s->ms += (now.tv_sec - perf.start[stage].tv_sec) * 1e3 +
+             (now.tv_nsec - perf.start[stage].tv_nsec) / 1e6;
+    s->calls++;
+    uint64_t *count[PERF_COUNTERS] = { &s->cycles, &s->instructions, &s->cache_misses };
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        *count[c] += read_counter(perf.fd[c]) - perf.start_count[stage][c];
+    }
+}
+
+void csc_perf_report(FILE *out, int json) {
+    uint64_t value[PERF_COUNTERS];
+    int first = 1;
+
+    if (json) {
+        fprintf(out, "{\"threads\":%d,\"stages\":[", csc_threads_count());
+    } else {
+        fprintf(out, "Counters summed over %d thread%s\n", csc_threads_count(),
+                csc_threads_count() == 1 ? "" : "s");
+        fprintf(out, "%-11s %5s %10s %14s %14s %14s\n",
+                "Stage", "calls", "ms", "cycles", "instructions", "cache misses");
+    }
+    for (int i = 0; i < CSC_STAGE_COUNT; i++) {
+        const csc_stage_stats_t *s = &perf.stats[i];
+        if (s->calls == 0) {
+            continue;
+        }
+        value[0] = s->cycles;
+        value[1] = s->instructions;
+        value[2] = s->cache_misses;
+
+        // counters that could not be opened are null / "-" rather than 0
+        if (json) {
+            fprintf(out, "%s{\"name\":\"%s\",\"calls\":%d,\"ms\":%.3f",
+                    first ? "" : ",", stage_names[i], s->calls, s->ms);
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (perf.fd[c] >= 0) {
+                    fprintf(out, ",\"%s\":%llu", counter_names[c], (unsigned long long)value[c]);
+                } else {
+                    fprintf(out, ",\"%s\":null", counter_names[c]);
+                }
+            }
+            fprintf(out, "}");
+        } else {
+            fprintf(out, "%-11s %5d %10.3f", stage_names[i], s->calls, s->ms);
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (perf.fd[c] >= 0) {
+                    fprintf(out, " %14llu", (unsigned long long)value[c]);
+                } else {
+                    fprintf(out, " %14s", "-");
+                }
+            }
+            fprintf(out, "\n");
+        }
+        first = 0;
+    }
+    if (json) {
+        fprintf(out, "]}\n");
+    }
+}
@@ -0,0 +1,144 @@
+// optimized_roundtrip.c
+// Fused RGB -> YCC -> RGB round trip. Instead of materialising whole Y, Cb
+// and Cr planes between the two passes, each thread walks its band in
+// strips sized to stay in cache: a strip is converted to a small YCC
+// scratch image and straight back, and compared with the input while both
+// are still hot.
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "optimized_global.h"
+
+// Working set per strip aimed at a typical L2 size
+#define ROUND_TRIP_CACHE_BYTES (256 * 1024)
+
+typedef struct {
+    const csc_packed_image_t *in;
+    csc_packed_image_t *out;
+    int strip_rows;
+    csc_frame_pool_t *scratch; // one YCC strip per thread
+    int failed;
+    csc_error_stats_t error;
+    pthread_mutex_t lock;
+} round_trip_job_t;
+
+// Accumulate the difference of rows [row, row + rows) of in and out;
+// channels are matched by colour, not by byte position
+static void measure_error(const csc_packed_image_t *in, const csc_packed_image_t *out,
+                          int row, int rows, csc_error_stats_t *error) {
+    int in_r = (in->order == CSC_ORDER_BGR) ? 2 : 0;
+    int out_r = (out->order == CSC_ORDER_BGR) ? 2 : 0;
+    const int in_idx[3] = { in_r, 1, 2 - in_r };
+    const int out_idx[3] = { out_r, 1, 2 - out_r };
+
+    for (int i = row; i < row + rows; i++) {
+        const uint8_t *a = PLANE_ROW(in, i);
+        const uint8_t *b = PLANE_ROW(out, i);
+        for (int col = 0; col < in->width; col++, a += 3, b += 3) {
+            for (int k = 0; k < 3; k++) {
+                int d = abs((int)a[in_idx[k]] - (int)b[out_idx[k]]);
+                error->sum_sq += (uint64_t)(d * d);
+                if (d > error->max_abs) {
+                    error->max_abs = d;
+                }
+            }
+        }
+    }
+    error->samples += 3 * (uint64_t)rows * (uint64_t)in->width;
+}
+
+static void round_trip_rows(void *arg, int row_begin, int row_end) {
+    round_trip_job_t *job = arg;
+    const csc_packed_image_t *in = job->in;
+    int height = in->height;
+    int halo_rows = 2;
+    csc_error_stats_t error = { 0, 0, 0 };
+    csc_frame_t *scratch = csc_frame_pool_get(job->scratch);
+
+    if (!scratch) {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+        return;
+    }
+
+    for (int row = row_begin; row < row_end; row += job->strip_rows) {
+        int rows = row_end - row < job->strip_rows ? row_end - row : job->strip_rows;
+        int avail = height - row < rows + halo_rows ? height - row : rows + halo_rows;
+
+        // views of the strip inside the full images
+        csc_packed_image_t src = *in, dst = *job->out;
+        csc_ycc_image_t ycc = scratch->ycc;
+        src.data = PLANE_ROW(in, row);
+        src.height = avail;
+        dst.data = PLANE_ROW(job->out, row);
+        dst.height = rows;
+        ycc.Y.height = avail;
+        ycc.Cb.height = ycc.Cr.height = avail >> 1;
+
+        optimized_packed_to_YCC(&src, &ycc);
+        ycc.Y.height = rows;
+        optimized_YCC_to_packed(&ycc, &dst);
+        measure_error(in, job->out, row, rows, &error);
+    }
+    csc_frame_pool_put(job->scratch, scratch);
+
+    pthread_mutex_lock(&job->lock);
+    job->error.sum_sq += error.sum_sq;
+    job->error.samples += error.samples;
+    if (error.max_abs > job->error.max_abs) {
+        job->error.max_abs = error.max_abs;
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+int csc_round_trip_pool_init(csc_frame_pool_t *scratch, int width, int strip_rows) {
+    if (width <= 0) {
+        return -1;
+    }
+    if (strip_rows <= 0) {
+        // packed in + packed out + 4:2:0 YCC = 7.5 bytes per pixel
+        strip_rows = (int)(ROUND_TRIP_CACHE_BYTES / ((size_t)width * 15 / 2));
+    }
+    strip_rows &= ~1;
+    if (strip_rows < 2) {
+        strip_rows = 2;
+    }
+    // one extra row pair of YCC below each strip supplies the chroma row
+    // the last row pair upsamples from
+    return csc_frame_pool_init(scratch, csc_threads_count(), width, strip_rows + 2,
+                               CSC_CHROMA_420, CSC_FRAME_YCC);
+}
+
+int optimized_round_trip(const csc_packed_image_t *in, csc_packed_image_t *out,
+                         csc_frame_pool_t *scratch, csc_error_stats_t *error) {
+    round_trip_job_t job;
+
+    if (in->width != out->width || in->height != out->height ||
+        (in->width & 1) || (in->height & 1)) {
+        return -1;
+    }
+    if (scratch->count < csc_threads_count() || scratch->frames[0].ycc.Y.width != in->width) {
+        return -1;
+    }
+
+    job.in = in;
+    job.out = out;
+    job.strip_rows = scratch->frames[0].ycc.Y.height - 2;
+    job.scratch = scratch;
+    job.failed = 0;
+    job.error.sum_sq = 0;
+    job.error.max_abs = 0;
+    job.error.samples = 0;
+    pthread_mutex_init(&job.lock, NULL);
+
+    // each band walks its own strips; the drivers called per strip see
+    // they are inside a band and run serially
+    csc_parallel_rows(in->height, round_trip_rows, &job);
+    pthread_mutex_destroy(&job.lock);
+
+    if (error) {
+        *error = job.error;
+    }
+    return job.failed ? -1 : 0;
+}
@@ -0,0 +1,112 @@
+// optimized_stream.c
+// Out-of-core RGB -> YCC -> RGB round trip. The image is walked in strips
+// of row pairs that are read, converted and written one at a time, so
+// memory stays at a few strips whatever the image height.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "optimized_global.h"
+
+// Read rows [first, first + count) of the input into rows starting at
+// buffer_row of the packed strip
+static int read_rows(FILE *in, csc_packed_image_t *strip, int buffer_row, int count) {
+    size_t row_bytes = 3 * (size_t)strip->width;
+
+    for (int i = 0; i < count; i++) {
+        if (fread(PLANE_ROW(strip, buffer_row + i), 1, row_bytes, in) != row_bytes) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int csc_stream_convert(FILE *in, FILE *out, int width, int height,
+                       csc_pixel_order_t order, int strip_rows,
+                       csc_stream_stats_t *stats) {
+    csc_packed_image_t in_strip, out_strip;
+    csc_ycc_image_t ycc;
+    int status = -1;
+
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+        return -1;
+    }
+    // whole row pairs only, and no more than the image
+    strip_rows &= ~1;
+    if (strip_rows < 2) {
+        strip_rows = 2;
+    }
+    if (strip_rows > height) {
+        strip_rows = height;
+    }
+
+    // YCC->RGB of the last row pair of a strip needs the chroma row below
+    // it, so each strip converts one extra row pair to YCC. Recomputing
+    // that halo is cheaper than carrying chroma across strips and gives
+    // the same values as a whole-image conversion.
+    int halo_rows = 2;
+    in_strip.data = NULL;
+    out_strip.data = NULL;
+    ycc.Y.data = ycc.Cb.data = ycc.Cr.data = NULL;
+    if (csc_packed_image_alloc(&in_strip, width, strip_rows + halo_rows, order) != 0 ||
+        csc_ycc_image_alloc(&ycc, width, strip_rows + halo_rows) != 0 ||
+        csc_packed_image_alloc(&out_strip, width, strip_rows, CSC_ORDER_RGB) != 0) {
+        goto done;
+    }
+
+    if (stats) {
+        stats->strip_rows = strip_rows;
+        stats->strips = 0;
+        stats->buffer_bytes =
+            (size_t)in_strip.stride * (size_t)in_strip.height +
+            (size_t)out_strip.stride * (size_t)out_strip.height +
+            (size_t)ycc.Y.stride * (size_t)ycc.Y.height +
+            2 * (size_t)ycc.Cb.stride * (size_t)ycc.Cb.height;
+    }
+
+    fprintf(out, "P6\n%d %d\n255\n", width, height);
+
+    int loaded = 0; // rows at the top of in_strip that are already read
+    for (int row = 0; row < height; row += strip_rows) {
+        int rows = height - row < strip_rows ? height - row : strip_rows;
+        int avail = height - row < rows + halo_rows ? height - row : rows + halo_rows;
+
+        if (read_rows(in, &in_strip, loaded, avail - loaded) != 0) {
+            goto done;
+        }
+
+        // views of this strip: YCC covers the halo, RGB output does not
+        csc_packed_image_t src = in_strip;
+        csc_ycc_image_t strip_ycc = ycc;
+        csc_packed_image_t dst = out_strip;
+        src.height = avail;
+        strip_ycc.Y.height = avail;
+        strip_ycc.Cb.height = strip_ycc.Cr.height = avail >> 1;
+        dst.height = rows;
+
+        optimized_packed_to_YCC(&src, &strip_ycc);
+        strip_ycc.Y.height = rows;
+        optimized_YCC_to_packed(&strip_ycc, &dst);
+
+        for (int i = 0; i < rows; i++) {
+            if (fwrite(PLANE_ROW(&dst, i), 3, (size_t)width, out) != (size_t)width) {
+                goto done;
+            }
+        }
+
+        // the halo rows become the top of the next strip
+        loaded = avail - rows;
+        for (int i = 0; i < loaded; i++) {
+            memcpy(PLANE_ROW(&in_strip, i), PLANE_ROW(&in_strip, rows + i), 3 * (size_t)width);
+        }
+        if (stats) {
+            stats->strips++;
+        }
+    }
+    status = fflush(out) == 0 ? 0 : -1;
+
+done:
+    csc_packed_image_free(&out_strip);
+    csc_ycc_image_free(&ycc);
+    csc_packed_image_free(&in_strip);
+    return status;
+}
@@ -0,0 +1,347 @@
+// optimized_subsample.c
+// Packed RGB24/BGR24 <-> YCC for every chroma format and filter. Each
+// format/filter pair has its own row-pair kernel, instantiated from one
+// template with the choice as a compile-time constant, so the format and
+// filter branches fold away and nothing is decided per pixel. The drivers
+// pick the kernel once per image. 4:2:0 with averaging and interpolation
+// is the format the backends vectorize, so it goes to their kernels, and
+// so does 4:2:0 averaged in RGB (their fast-chroma kernels).
+#include <stdint.h>
+#include <string.h>
+#include "optimized_global.h"
+
+// The template is only useful if every instantiation is specialized
+#define SUBSAMPLE_INLINE static inline __attribute__((always_inline))
+
+typedef void (*packed_to_ycc_pair_fn)(
+    const uint8_t *P0, const uint8_t *P1, int r_idx,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb0, uint8_t *Cb1,
+    uint8_t *Cr0, uint8_t *Cr1, int width);
+
+typedef void (*ycc_to_packed_pair_fn)(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    int r_idx, int width);
+
+static inline int saturate(int value) {
+    if (value > 255) return 255;
+    if (value < 0) return 0;
+    return value;
+}
+
+static inline void rgb_to_ycc_pixel(const uint8_t *px, int r_idx, uint8_t *Y, int *cb, int *cr) {
+    int red = px[r_idx], green = px[1], blue = px[2 - r_idx];
+
+    *Y  = (uint8_t)saturate(((16 << K) + C11 * red + C12 * green + C13 * blue) >> K);
+    *cb = saturate(((128 << K) - C21 * red - C22 * green + C23 * blue) >> K);
+    *cr = saturate(((128 << K) + C31 * red - C32 * green - C33 * blue) >> K);
+}
+
+// R, G and B of two horizontally adjacent pixels, summed
+static inline void pair_sum(const uint8_t *px, int r_idx, int sum[3]) {
+    sum[0] = px[r_idx] + px[r_idx + 3];
+    sum[1] = px[1] + px[4];
+    sum[2] = px[2 - r_idx] + px[5 - r_idx];
+}
+
+// Chroma of the average of 1 << shift pixels from their summed R, G and B;
+// never out of range, so not clamped
+static inline void sum_to_chroma(const int sum[3], int shift, uint8_t *Cb, uint8_t *Cr) {
+    *Cb = (uint8_t)(((128 << (K + shift)) - C21 * sum[0] - C22 * sum[1] + C23 * sum[2]) >> (K + shift));
+    *Cr = (uint8_t)(((128 << (K + shift)) + C31 * sum[0] - C32 * sum[1] - C33 * sum[2]) >> (K + shift));
+}
+
+static inline void ycc_to_rgb_pixel(int y, int cb, int cr, uint8_t *px, int r_idx) {
+    y  -= 16;
+    cb -= 128;
+    cr -= 128;
+    px[r_idx]     = (uint8_t)saturate((D1 * y + D2 * cr + (1 << (K - 1))) >> K);
+    px[1]         = (uint8_t)saturate((D1 * y - D3 * cr - D4 * cb + (1 << (K - 1))) >> K);
+    px[2 - r_idx] = (uint8_t)saturate((D1 * y + D5 * cb + (1 << (K - 1))) >> K);
+}
+
+// One row pair to YCC. Cb0/Cr0 and Cb1/Cr1 are the chroma rows of the two
+// pixel rows; 4:2:0 writes only Cb0/Cr0.
+SUBSAMPLE_INLINE void packed_to_ycc_pair(
+    const uint8_t *P0, const uint8_t *P1, int r_idx,
+    uint8_t *Y0, uint8_t *Y1, uint8_t *Cb0, uint8_t *Cb1,
+    uint8_t *Cr0, uint8_t *Cr1, int width,
+    const csc_chroma_format_t format, const csc_downsample_t down
+) {
+    for (int c = 0; c < width; c += 2) {
+        int cb[4], cr[4]; // top left, top right, bottom left, bottom right
+        int sum[2][3];    // R, G and B of each row's pixel pair
+        int h = c >> 1;
+
+        pair_sum(P0 + 3 * c, r_idx, sum[0]);
+        pair_sum(P1 + 3 * c, r_idx, sum[1]);
+        rgb_to_ycc_pixel(P0 + 3 * c,     r_idx, &Y0[c],     &cb[0], &cr[0]);
+        rgb_to_ycc_pixel(P0 + 3 * c + 3, r_idx, &Y0[c + 1], &cb[1], &cr[1]);
+        rgb_to_ycc_pixel(P1 + 3 * c,     r_idx, &Y1[c],     &cb[2], &cr[2]);
+        rgb_to_ycc_pixel(P1 + 3 * c + 3, r_idx, &Y1[c + 1], &cb[3], &cr[3]);
+
+        if (format == CSC_CHROMA_444) {
+            Cb0[c] = (uint8_t)cb[0]; Cb0[c + 1] = (uint8_t)cb[1];
+            Cb1[c] = (uint8_t)cb[2]; Cb1[c + 1] = (uint8_t)cb[3];
+            Cr0[c] = (uint8_t)cr[0]; Cr0[c + 1] = (uint8_t)cr[1];
+            Cr1[c] = (uint8_t)cr[2]; Cr1[c + 1] = (uint8_t)cr[3];
+        } else if (format == CSC_CHROMA_422) {
+            if (down == CSC_DOWNSAMPLE_DROP) {
+                Cb0[h] = (uint8_t)cb[0]; Cb1[h] = (uint8_t)cb[2];
+                Cr0[h] = (uint8_t)cr[0]; Cr1[h] = (uint8_t)cr[2];
+            } else if (down == CSC_DOWNSAMPLE_RGB) {
+                sum_to_chroma(sum[0], 1, &Cb0[h], &Cr0[h]);
+                sum_to_chroma(sum[1], 1, &Cb1[h], &Cr1[h]);
+            } else {
+                Cb0[h] = (uint8_t)((cb[0] + cb[1]) >> 1); Cb1[h] = (uint8_t)((cb[2] + cb[3]) >> 1);
+                Cr0[h] = (uint8_t)((cr[0] + cr[1]) >> 1); Cr1[h] = (uint8_t)((cr[2] + cr[3]) >> 1);
+            }
+        } else {
+            if (down == CSC_DOWNSAMPLE_DROP) {
+                Cb0[h] = (uint8_t)cb[0];
+                Cr0[h] = (uint8_t)cr[0];
+            } else if (down == CSC_DOWNSAMPLE_RGB) {
+                int block[3] = { sum[0][0] + sum[1][0], sum[0][1] + sum[1][1], sum[0][2] + sum[1][2] };
+                sum_to_chroma(block, 2, &Cb0[h], &Cr0[h]);
+            } else {
+                Cb0[h] = (uint8_t)((cb[0] + cb[1] + cb[2] + cb[3]) >> 2);
+                Cr0[h] = (uint8_t)((cr[0] + cr[1] + cr[2] + cr[3]) >> 2);
+            }
+        }
+    }
+}
+
+// One row pair back to packed pixels. For 4:2:0 Cb0/Cr0 is the chroma row
+// of the pair and Cb1/Cr1 the one below (itself at the bottom edge); for
+// 4:2:2 and 4:4:4 they are the chroma rows of the two pixel rows.
+// Interpolation truncates and clamps at the right edge like the backends.
+SUBSAMPLE_INLINE void ycc_to_packed_pair(
+    const uint8_t *Y0, const uint8_t *Y1, const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1, uint8_t *P0, uint8_t *P1,
+    int r_idx, int width,
+    const csc_chroma_format_t format, const csc_upsample_t up
+) {
+    int c_width = width >> 1;
+
+    for (int c = 0; c < width; c += 2) {
+        int cb[4], cr[4]; // top left, top right, bottom left, bottom right
+        int h = c >> 1;
+        int n = (h + 1 < c_width) ? h + 1 : h;
+
+        if (format == CSC_CHROMA_444) {
+            cb[0] = Cb0[c]; cb[1] = Cb0[c + 1]; cb[2] = Cb1[c]; cb[3] = Cb1[c + 1];
+            cr[0] = Cr0[c]; cr[1] = Cr0[c + 1]; cr[2] = Cr1[c]; cr[3] = Cr1[c + 1];
+        } else if (format == CSC_CHROMA_422) {
+            cb[0] = Cb0[h]; cb[2] = Cb1[h];
+            cr[0] = Cr0[h]; cr[2] = Cr1[h];
+            if (up == CSC_UPSAMPLE_REPLICATE) {
+                cb[1] = cb[0]; cb[3] = cb[2];
+                cr[1] = cr[0]; cr[3] = cr[2];
+            } else {
+                cb[1] = (Cb0[h] + Cb0[n]) >> 1; cb[3] = (Cb1[h] + Cb1[n]) >> 1;
+                cr[1] = (Cr0[h] + Cr0[n]) >> 1; cr[3] = (Cr1[h] + Cr1[n]) >> 1;
+            }
+        } else {
+            cb[0] = Cb0[h];
+            cr[0] = Cr0[h];
+            if (up == CSC_UPSAMPLE_REPLICATE) {
+                cb[1] = cb[2] = cb[3] = cb[0];
+                cr[1] = cr[2] = cr[3] = cr[0];
+            } else {
+                cb[1] = (Cb0[h] + Cb0[n]) >> 1;
+                cb[2] = (Cb0[h] + Cb1[h]) >> 1;
+                cb[3] = (Cb0[h] + Cb0[n] + Cb1[h] + Cb1[n]) >> 2;
+                cr[1] = (Cr0[h] + Cr0[n]) >> 1;
+                cr[2] = (Cr0[h] + Cr1[h]) >> 1;
+                cr[3] = (Cr0[h] + Cr0[n] + Cr1[h] + Cr1[n]) >> 2;
+            }
+        }
+
+        ycc_to_rgb_pixel(Y0[c],     cb[0], cr[0], P0 + 3 * c,     r_idx);
+        ycc_to_rgb_pixel(Y0[c + 1], cb[1], cr[1], P0 + 3 * c + 3, r_idx);
+        ycc_to_rgb_pixel(Y1[c],     cb[2], cr[2], P1 + 3 * c,     r_idx);
+        ycc_to_rgb_pixel(Y1[c + 1], cb[3], cr[3], P1 + 3 * c + 3, r_idx);
+    }
+}
+
+// One kernel per format and filter
+#define DEFINE_PACKED_TO_YCC(name, format, down)                                   \
+    static void name(const uint8_t *P0, const uint8_t *P1, int r_idx,              \
+                     uint8_t *Y0, uint8_t *Y1, uint8_t *Cb0, uint8_t *Cb1,         \
+                     uint8_t *Cr0, uint8_t *Cr1, int width) {                      \
+        packed_to_ycc_pair(P0, P1, r_idx, Y0, Y1, Cb0, Cb1, Cr0, Cr1, width,       \
+                           format, down);                                          \
+    }
+
+#define DEFINE_YCC_TO_PACKED(name, format, up)                                     \
+    static void name(const uint8_t *Y0, const uint8_t *Y1,                         \
+                     const uint8_t *Cb0, const uint8_t *Cb1,                       \
+                     const uint8_t *Cr0, const uint8_t *Cr1,                       \
+                     uint8_t *P0, uint8_t *P1, int r_idx, int width) {             \
+        ycc_to_packed_pair(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, r_idx, width,       \
+                           format, up);                                            \
+    }
+
+DEFINE_PACKED_TO_YCC(packed_to_ycc_420_average, CSC_CHROMA_420, CSC_DOWNSAMPLE_AVERAGE)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_420_drop,    CSC_CHROMA_420, CSC_DOWNSAMPLE_DROP)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_420_rgb,     CSC_CHROMA_420, CSC_DOWNSAMPLE_RGB)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_422_average, CSC_CHROMA_422, CSC_DOWNSAMPLE_AVERAGE)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_422_drop,    CSC_CHROMA_422, CSC_DOWNSAMPLE_DROP)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_422_rgb,     CSC_CHROMA_422, CSC_DOWNSAMPLE_RGB)
+DEFINE_PACKED_TO_YCC(packed_to_ycc_444,         CSC_CHROMA_444, CSC_DOWNSAMPLE_AVERAGE)
+
+DEFINE_YCC_TO_PACKED(ycc_to_packed_420_interpolate, CSC_CHROMA_420, CSC_UPSAMPLE_INTERPOLATE)
+DEFINE_YCC_TO_PACKED(ycc_to_packed_420_replicate,   CSC_CHROMA_420, CSC_UPSAMPLE_REPLICATE)
+DEFINE_YCC_TO_PACKED(ycc_to_packed_422_interpolate, CSC_CHROMA_422, CSC_UPSAMPLE_INTERPOLATE)
+DEFINE_YCC_TO_PACKED(ycc_to_packed_422_replicate,   CSC_CHROMA_422, CSC_UPSAMPLE_REPLICATE)
+DEFINE_YCC_TO_PACKED(ycc_to_packed_444,             CSC_CHROMA_444, CSC_UPSAMPLE_INTERPOLATE)
+
+// [format][filter]; 4:4:4 has nothing to filter
+static const packed_to_ycc_pair_fn packed_to_ycc_kernels[CSC_CHROMA_FORMAT_COUNT][3] = {
+    [CSC_CHROMA_420] = { packed_to_ycc_420_average, packed_to_ycc_420_drop, packed_to_ycc_420_rgb },
+    [CSC_CHROMA_422] = { packed_to_ycc_422_average, packed_to_ycc_422_drop, packed_to_ycc_422_rgb },
+    [CSC_CHROMA_444] = { packed_to_ycc_444,         packed_to_ycc_444,      packed_to_ycc_444 },
+};
+
+static const ycc_to_packed_pair_fn ycc_to_packed_kernels[CSC_CHROMA_FORMAT_COUNT][2] = {
+    [CSC_CHROMA_420] = { ycc_to_packed_420_interpolate, ycc_to_packed_420_replicate },
+    [CSC_CHROMA_422] = { ycc_to_packed_422_interpolate, ycc_to_packed_422_replicate },
+    [CSC_CHROMA_444] = { ycc_to_packed_444,             ycc_to_packed_444 },
+};
+
+typedef struct {
+    const void *src;
+    void *dst;
+    csc_chroma_format_t format;
+    packed_to_ycc_pair_fn to_ycc;
+    ycc_to_packed_pair_fn to_packed;
+} subsample_job_t;
+
+// The last column x of a row pair as a block with the pixel repeated.
+// 4:4:4 keeps the first chroma sample of the block at x, the subsampled
+// formats the block's one sample at x / 2.
+static void packed_to_ycc_last_column(const subsample_job_t *job, const uint8_t *P0, const uint8_t *P1,
+                                      int r_idx, uint8_t *Y0, uint8_t *Y1, uint8_t *Cb0, uint8_t *Cb1,
+                                      uint8_t *Cr0, uint8_t *Cr1, int x) {
+    const uint8_t *src[2] = { P0 + 3 * x, P1 + 3 * x };
+    uint8_t p[2][6], y[2][2], cb[2][2], cr[2][2];
+    int c = (job->format == CSC_CHROMA_444) ? x : x >> 1;
+
+    for (int i = 0; i < 2; i++) {
+        memcpy(p[i], src[i], 3);
+        memcpy(p[i] + 3, src[i], 3);
+    }
+    job->to_ycc(p[0], p[1], r_idx, y[0], y[1], cb[0], cb[1], cr[0], cr[1], 2);
+    Y0[x] = y[0][0];
+    Y1[x] = y[1][0];
+    Cb0[c] = cb[0][0];
+    Cr0[c] = cr[0][0];
+    if (job->format != CSC_CHROMA_420) {
+        Cb1[c] = cb[1][0];
+        Cr1[c] = cr[1][0];
+    }
+}
+
+// Pixels [x, width) of a row pair, padded with copies of the last one to
+// two blocks. As in the backend drivers, an odd width starts x one block
+// early so the last whole block interpolates towards the real last chroma
+// sample rather than clamping.
+static void ycc_to_packed_last_columns(const subsample_job_t *job, const uint8_t *Y0, const uint8_t *Y1,
+                                       const uint8_t *Cb0, const uint8_t *Cb1,
+                                       const uint8_t *Cr0, const uint8_t *Cr1,
+                                       uint8_t *P0, uint8_t *P1, int r_idx, int x, int width) {
+    const uint8_t *Y[2] = { Y0, Y1 }, *Cb[2] = { Cb0, Cb1 }, *Cr[2] = { Cr0, Cr1 };
+    uint8_t *P[2] = { P0, P1 };
+    int n = width - x, h = x >> 1;
+    uint8_t y[2][4], cb[2][4], cr[2][4], p[2][12];
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 4; j++) {
+            int col = j < n ? x + j : width - 1;
+            y[i][j] = Y[i][col];
+            // 4:4:4 has a sample per pixel, the others one per block
+            cb[i][j] = (job->format == CSC_CHROMA_444) ? Cb[i][col] : Cb[i][h + (j > 0 && n > 1)];
+            cr[i][j] = (job->format == CSC_CHROMA_444) ? Cr[i][col] : Cr[i][h + (j > 0 && n > 1)];
+        }
+    }
+    job->to_packed(y[0], y[1], cb[0], cb[1], cr[0], cr[1], p[0], p[1], r_idx, 4);
+    for (int i = 0; i < 2; i++) {
+        memcpy(P[i] + 3 * x, p[i], 3 * (size_t)n);
+    }
+}
+
+static void packed_to_ycc_mode_rows(void *arg, int row_begin, int row_end) {
+    const subsample_job_t *job = arg;
+    const csc_packed_image_t *packed = job->src;
+    csc_ycc_image_t *ycc = job->dst;
+    int r_idx = (packed->order == CSC_ORDER_BGR) ? 2 : 0;
+    int v_shift = (job->format == CSC_CHROMA_420) ? 1 : 0;
+    int width = ycc->Y.width, even = width & ~1;
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        int c0 = r >> v_shift, c1 = r1 >> v_shift;
+        const uint8_t *P0 = PLANE_ROW(packed, r), *P1 = PLANE_ROW(packed, r1);
+        uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c0), *Cb1 = PLANE_ROW(&ycc->Cb, c1);
+        uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c0), *Cr1 = PLANE_ROW(&ycc->Cr, c1);
+
+        job->to_ycc(P0, P1, r_idx, Y0, Y1, Cb0, Cb1, Cr0, Cr1, even);
+        if (width & 1) {
+            packed_to_ycc_last_column(job, P0, P1, r_idx, Y0, Y1, Cb0, Cb1, Cr0, Cr1, even);
+        }
+    }
+}
+
+static void ycc_to_packed_mode_rows(void *arg, int row_begin, int row_end) {
+    const subsample_job_t *job = arg;
+    const csc_ycc_image_t *ycc = job->src;
+    csc_packed_image_t *packed = job->dst;
+    int r_idx = (packed->order == CSC_ORDER_BGR) ? 2 : 0;
+    int width = ycc->Y.width, even = width & ~1;
+    int edge_x = (width & 1) ? (even > 0 ? even - 2 : 0) : -1;
+
+    for (int r = row_begin; r < row_end; r += 2) {
+        int r1 = (r + 1 < ycc->Y.height) ? r + 1 : r;
+        int c0 = r, c1 = r1;
+        if (job->format == CSC_CHROMA_420) {
+            c0 = r >> 1;
+            c1 = (r1 > r && c0 + 1 < ycc->Cb.height) ? c0 + 1 : c0;
+        }
+        const uint8_t *Y0 = PLANE_ROW(&ycc->Y, r), *Y1 = PLANE_ROW(&ycc->Y, r1);
+        const uint8_t *Cb0 = PLANE_ROW(&ycc->Cb, c0), *Cb1 = PLANE_ROW(&ycc->Cb, c1);
+        const uint8_t *Cr0 = PLANE_ROW(&ycc->Cr, c0), *Cr1 = PLANE_ROW(&ycc->Cr, c1);
+        uint8_t *P0 = PLANE_ROW(packed, r), *P1 = PLANE_ROW(packed, r1);
+
+        job->to_packed(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, r_idx, even);
+        if (edge_x >= 0) {
+            ycc_to_packed_last_columns(job, Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, r_idx, edge_x, width);
+        }
+    }
+}
+
+void optimized_packed_to_YCC_mode(const csc_packed_image_t *packed, csc_ycc_image_t *ycc,
+                                  const csc_chroma_mode_t *mode) {
+    if (mode->format == CSC_CHROMA_420 && mode->down == CSC_DOWNSAMPLE_AVERAGE) {
+        optimized_packed_to_YCC(packed, ycc);
+        return;
+    }
+    if (mode->format == CSC_CHROMA_420 && mode->down == CSC_DOWNSAMPLE_RGB) {
+        optimized_packed_to_YCC_fast_chroma(packed, ycc);
+        return;
+    }
+    subsample_job_t job = { packed, ycc, mode->format,
+                            packed_to_ycc_kernels[mode->format][mode->down], NULL };
+    csc_parallel_rows(ycc->Y.height, packed_to_ycc_mode_rows, &job);
+}
+
+void optimized_YCC_to_packed_mode(const csc_ycc_image_t *ycc, csc_packed_image_t *packed,
+                                  const csc_chroma_mode_t *mode) {
+    if (mode->format == CSC_CHROMA_420 && mode->up == CSC_UPSAMPLE_INTERPOLATE) {
+        optimized_YCC_to_packed(ycc, packed);
+        return;
+    }
+    subsample_job_t job = { ycc, packed, mode->format,
+                            NULL, ycc_to_packed_kernels[mode->format][mode->up] };
+    csc_parallel_rows(ycc->Y.height, ycc_to_packed_mode_rows, &job);
+}
@@ -0,0 +1,149 @@
+// optimized_threads.c
+// Persistent worker pool for band-parallel conversion. The image is split
+// into one band of row pairs per thread; the calling thread converts the
+// first band itself, so a pool of one thread is plain serial execution.
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <unistd.h>
+#include "optimized_global.h"
+
+static struct {
+    pthread_t threads[CSC_MAX_THREADS];
+    int count;              // threads taking part, including the caller
+    pthread_mutex_t lock;
+    pthread_cond_t start;   // a new job was posted, or quit was set
+    pthread_cond_t done;    // pending dropped to zero
+    unsigned generation;    // bumped for every job
+    int pending;            // worker bands still running
+    int quit;
+
+    csc_band_fn fn;
+    void *arg;
+    int height;
+    int band_rows;
+} pool = {
+    .count = 1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+// Set while a thread runs a band, so conversions called from inside a
+// band run serially instead of posting a nested job to the busy pool
+static _Thread_local int in_band;
+
+// Band index of a thread -> row range, clipped to the image
+static void run_band(int index) {
+    int begin = index * pool.band_rows;
+    int end = begin + pool.band_rows;
+
+    if (end > pool.height) {
+        end = pool.height;
+    }
+    if (begin < end) {
+        in_band = 1;
+        pool.fn(pool.arg, begin, end);
+        in_band = 0;
+    }
+}
+
+static void *worker_main(void *arg) {
+    int index = (int)(intptr_t)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen && !pool.quit) {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        if (pool.quit) {
+            break;
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        run_band(index);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+int csc_threads_init(int count) {
+    csc_threads_shutdown();
+
+    if (count <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        count = online > 0 ? (int)online : 1;
+    }
+    if (count > CSC_MAX_THREADS) {
+        count = CSC_MAX_THREADS;
+    }
+
+    pool.quit = 0;
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&pool.threads[i], NULL, worker_main, (void *)(intptr_t)i) != 0) {
+            // keep the workers that did start
+            count = i;
+            break;
+        }
+    }
+    pool.count = count;
+    return count;
+}
+
+void csc_threads_shutdown(void) {
+    if (pool.count <= 1) {
+        pool.count = 1;
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 1; i < pool.count; i++) {
+        pthread_join(pool.threads[i], NULL);
+    }
+    pool.count = 1;
+    pool.generation = 0;
+}
+
+int csc_threads_count(void) {
+    return pool.count;
+}
+
+void csc_parallel_rows(int height, csc_band_fn fn, void *arg) {
+    // an odd last row counts as a pair, so it lands in the last band
+    int pairs = (height + 1) >> 1;
+    int bands = pool.count < pairs ? pool.count : pairs;
+
+    if (bands <= 1 || in_band) {
+        fn(arg, 0, height);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.fn = fn;
+    pool.arg = arg;
+    pool.height = height;
+    // bands start on even rows so no 2x2 block or chroma row is split
+    pool.band_rows = ((pairs + pool.count - 1) / pool.count) * 2;
+    pool.pending = pool.count - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_band(0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
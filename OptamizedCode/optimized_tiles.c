@@ -0,0 +1,116 @@
+// optimized_tiles.c
+// Dirty-tile incremental RGB->YCC for mostly static video. A frame is
+// compared tile by tile with the frame the YCC planes were last converted
+// from, and only the tiles that differ are converted again. Tiles are
+// whole 2x2 blocks, so every chroma sample comes from exactly one tile and
+// no neighbouring tile is redone.
+#include <pthread.h>
+#include <string.h>
+#include "optimized_global.h"
+
+typedef struct {
+    const csc_packed_image_t *packed;
+    const csc_packed_image_t *previous;
+    csc_ycc_image_t *ycc;
+    int converted;
+    pthread_mutex_t lock;
+} tile_job_t;
+
+// memcmp is vectorized in the C library and stops at the first
+// difference, so only an unchanged tile is read in full
+static int tile_changed(const csc_packed_image_t *a, const csc_packed_image_t *b,
+                        int x, int y, int width, int height) {
+    for (int row = y; row < y + height; row++) {
+        if (memcmp(PLANE_ROW(a, row) + 3 * x, PLANE_ROW(b, row) + 3 * x, 3 * (size_t)width) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Columns [x_begin, x_end) of one tile row, as views of the images. The
+// ROI driver would also convert the block halo of the neighbouring tiles,
+// which may belong to another band.
+static void convert_run(tile_job_t *job, int x_begin, int x_end, int y, int height) {
+    int width = x_end - x_begin;
+    csc_packed_image_t src = *job->packed;
+    csc_ycc_image_t dst = *job->ycc;
+
+    src.data = PLANE_ROW(job->packed, y) + 3 * x_begin;
+    src.width = width;
+    src.height = height;
+    dst.Y.data = PLANE_ROW(&job->ycc->Y, y) + x_begin;
+    dst.Y.width = width;
+    dst.Y.height = height;
+    dst.Cb.data = PLANE_ROW(&job->ycc->Cb, y >> 1) + (x_begin >> 1);
+    dst.Cr.data = PLANE_ROW(&job->ycc->Cr, y >> 1) + (x_begin >> 1);
+    dst.Cb.width = dst.Cr.width = (width + 1) >> 1;
+    dst.Cb.height = dst.Cr.height = (height + 1) >> 1;
+    optimized_packed_to_YCC(&src, &dst);
+}
+
+// Every tile row that starts in [row_begin, row_end). Adjacent changed
+// tiles are converted as one run; the driver runs serially here.
+static void tile_rows(void *arg, int row_begin, int row_end) {
+    tile_job_t *job = arg;
+    int width = job->ycc->Y.width, height = job->ycc->Y.height;
+    int converted = 0;
+    int first = (row_begin + CSC_TILE_HEIGHT - 1) / CSC_TILE_HEIGHT * CSC_TILE_HEIGHT;
+
+    for (int y = first; y < row_end; y += CSC_TILE_HEIGHT) {
+        int tile_height = height - y < CSC_TILE_HEIGHT ? height - y : CSC_TILE_HEIGHT;
+        int run = -1; // first column of the pending run of changed tiles
+
+        for (int x = 0; x < width; x += CSC_TILE_WIDTH) {
+            int tile_width = width - x < CSC_TILE_WIDTH ? width - x : CSC_TILE_WIDTH;
+
+            if (tile_changed(job->packed, job->previous, x, y, tile_width, tile_height)) {
+                converted++;
+                if (run < 0) {
+                    run = x;
+                }
+            } else if (run >= 0) {
+                convert_run(job, run, x, y, tile_height);
+                run = -1;
+            }
+        }
+        if (run >= 0) {
+            convert_run(job, run, width, y, tile_height);
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->converted += converted;
+    pthread_mutex_unlock(&job->lock);
+}
+
+int csc_tile_count(int width, int height) {
+    return ((width + CSC_TILE_WIDTH - 1) / CSC_TILE_WIDTH) *
+           ((height + CSC_TILE_HEIGHT - 1) / CSC_TILE_HEIGHT);
+}
+
+int optimized_packed_to_YCC_incremental(const csc_packed_image_t *packed, const csc_packed_image_t *previous,
+                                        csc_ycc_image_t *ycc) {
+    int width = ycc->Y.width, height = ycc->Y.height;
+    tile_job_t job;
+
+    if (packed->width != width || packed->height != height) {
+        return -1;
+    }
+    if (!previous) {
+        optimized_packed_to_YCC(packed, ycc);
+        return csc_tile_count(width, height);
+    }
+    if (previous->width != width || previous->height != height || previous->order != packed->order) {
+        return -1;
+    }
+
+    job.packed = packed;
+    job.previous = previous;
+    job.ycc = ycc;
+    job.converted = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    csc_parallel_rows(height, tile_rows, &job);
+    pthread_mutex_destroy(&job.lock);
+    return job.converted;
+}
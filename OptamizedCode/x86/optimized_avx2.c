@@ -0,0 +1,296 @@
+// optimized_avx2.c
+// AVX2 row-pair kernels, 32 pixels per iteration. Same arithmetic as the
+// SSE4.1 kernels; pack/unpack work per 128-bit lane, so results are put
+// back in pixel order with cross-lane permutes before storing.
+#include <immintrin.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+// Y, Cb and Cr for 16 pixels in 16-bit lanes (see optimized_sse41.c)
+static inline __m256i rgb_to_y_16(__m256i r, __m256i g, __m256i b) {
+    __m256i yv = _mm256_add_epi16(_mm256_set1_epi16(16 << K), _mm256_mullo_epi16(r, _mm256_set1_epi16(C11)));
+    yv = _mm256_add_epi16(yv, _mm256_mullo_epi16(g, _mm256_set1_epi16(C12)));
+    yv = _mm256_add_epi16(yv, _mm256_mullo_epi16(b, _mm256_set1_epi16(C13)));
+    return _mm256_srli_epi16(yv, K);
+}
+
+static inline void rgb_to_ycc_16(__m256i r, __m256i g, __m256i b,
+                                 __m256i *y, __m256i *cb, __m256i *cr) {
+    const __m256i c_bias = _mm256_set1_epi16((short)(128 << K));
+
+    *y = rgb_to_y_16(r, g, b);
+
+    __m256i cbv = _mm256_add_epi16(c_bias, _mm256_mullo_epi16(b, _mm256_set1_epi16(C23)));
+    cbv = _mm256_sub_epi16(cbv, _mm256_mullo_epi16(r, _mm256_set1_epi16(C21)));
+    cbv = _mm256_sub_epi16(cbv, _mm256_mullo_epi16(g, _mm256_set1_epi16(C22)));
+    *cb = _mm256_srli_epi16(cbv, K);
+
+    __m256i crv = _mm256_add_epi16(c_bias, _mm256_mullo_epi16(r, _mm256_set1_epi16(C31)));
+    crv = _mm256_sub_epi16(crv, _mm256_mullo_epi16(g, _mm256_set1_epi16(C32)));
+    crv = _mm256_sub_epi16(crv, _mm256_mullo_epi16(b, _mm256_set1_epi16(C33)));
+    *cr = _mm256_srli_epi16(crv, K);
+}
+
+// Pack two vectors of 16 words (pixels 0-15 and 16-31) into 32 ordered bytes
+static inline __m256i pack_ordered_u8(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+static inline __m256i load_u8_as_u16(const uint8_t *p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+// One chroma channel of 8 blocks from the vertical sums of 16 columns,
+// with pmaddwd adding horizontal neighbours (see optimized_sse41.c)
+static inline __m256i chroma_from_sums_8(__m256i r, __m256i g, __m256i b, int cr_coef, int cg_coef,
+                                         int cb_coef) {
+    __m256i v = _mm256_add_epi32(_mm256_set1_epi32(128 << (K + 2)),
+                                 _mm256_madd_epi16(r, _mm256_set1_epi16((short)cr_coef)));
+    v = _mm256_add_epi32(v, _mm256_madd_epi16(g, _mm256_set1_epi16((short)cg_coef)));
+    v = _mm256_add_epi32(v, _mm256_madd_epi16(b, _mm256_set1_epi16((short)cb_coef)));
+    return _mm256_srai_epi32(v, K + 2);
+}
+
+// fast is a constant at every call: per-pixel chroma averaged, or chroma
+// once per block from the summed R, G and B
+static inline int rgb_to_ycc_row(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
+) {
+    const uint8_t *R[2] = { R0, R1 };
+    const uint8_t *G[2] = { G0, G1 };
+    const uint8_t *B[2] = { B0, B1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const __m256i ones = _mm256_set1_epi16(1);
+    int col = 0;
+
+    for (; col + 32 <= width; col += 32) {
+        __m256i cb_sum[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        __m256i cr_sum[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        __m256i rgb_sum[3][2] = { { _mm256_setzero_si256(), _mm256_setzero_si256() },
+                                  { _mm256_setzero_si256(), _mm256_setzero_si256() },
+                                  { _mm256_setzero_si256(), _mm256_setzero_si256() } };
+
+        for (int i = 0; i < 2; i++) {
+            __m256i y[2];
+            for (int h = 0; h < 2; h++) {
+                int x = col + 16 * h;
+                __m256i r = load_u8_as_u16(R[i] + x);
+                __m256i g = load_u8_as_u16(G[i] + x);
+                __m256i b = load_u8_as_u16(B[i] + x);
+                if (fast) {
+                    y[h] = rgb_to_y_16(r, g, b);
+                    rgb_sum[0][h] = _mm256_add_epi16(rgb_sum[0][h], r);
+                    rgb_sum[1][h] = _mm256_add_epi16(rgb_sum[1][h], g);
+                    rgb_sum[2][h] = _mm256_add_epi16(rgb_sum[2][h], b);
+                } else {
+                    __m256i cb, cr;
+                    rgb_to_ycc_16(r, g, b, &y[h], &cb, &cr);
+                    cb_sum[h] = _mm256_add_epi16(cb_sum[h], cb);
+                    cr_sum[h] = _mm256_add_epi16(cr_sum[h], cr);
+                }
+            }
+            _mm256_storeu_si256((__m256i *)(Y[i] + col), pack_ordered_u8(y[0], y[1]));
+        }
+
+        // 16 ordered chroma words: from the block sums, or pmaddwd against 1
+        // adds horizontal neighbours of the per-pixel chroma and the 32-bit
+        // sums are packed back and averaged
+        __m256i cb, cr;
+        if (fast) {
+            __m256i cb32[2], cr32[2];
+            for (int h = 0; h < 2; h++) {
+                cb32[h] = chroma_from_sums_8(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], -C21, -C22, C23);
+                cr32[h] = chroma_from_sums_8(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], C31, -C32, -C33);
+            }
+            cb = _mm256_permute4x64_epi64(_mm256_packs_epi32(cb32[0], cb32[1]), 0xD8);
+            cr = _mm256_permute4x64_epi64(_mm256_packs_epi32(cr32[0], cr32[1]), 0xD8);
+        } else {
+            cb = _mm256_permute4x64_epi64(
+                _mm256_packs_epi32(_mm256_madd_epi16(cb_sum[0], ones), _mm256_madd_epi16(cb_sum[1], ones)), 0xD8);
+            cr = _mm256_permute4x64_epi64(
+                _mm256_packs_epi32(_mm256_madd_epi16(cr_sum[0], ones), _mm256_madd_epi16(cr_sum[1], ones)), 0xD8);
+            cb = _mm256_srli_epi16(cb, 2);
+            cr = _mm256_srli_epi16(cr, 2);
+        }
+        cb = pack_ordered_u8(cb, _mm256_setzero_si256());
+        cr = pack_ordered_u8(cr, _mm256_setzero_si256());
+        _mm_storeu_si128((__m128i *)(Cb + (col >> 1)), _mm256_castsi256_si128(cb));
+        _mm_storeu_si128((__m128i *)(Cr + (col >> 1)), _mm256_castsi256_si128(cr));
+    }
+    return col;
+}
+
+int optimized_RGB_to_YCC_row_avx2(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_RGB_to_YCC_row_fast_chroma_avx2(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 1);
+}
+
+// Luma only: Y of one row, no chroma
+int optimized_RGB_to_Y_row_avx2(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width) {
+    int col = 0;
+
+    for (; col + 32 <= width; col += 32) {
+        __m256i y[2];
+        for (int h = 0; h < 2; h++) {
+            int x = col + 16 * h;
+            y[h] = rgb_to_y_16(load_u8_as_u16(R + x), load_u8_as_u16(G + x), load_u8_as_u16(B + x));
+        }
+        _mm256_storeu_si256((__m256i *)(Y + col), pack_ordered_u8(y[0], y[1]));
+    }
+    return col;
+}
+
+// R, G and B for 16 pixels using pmaddwd pairs (see optimized_sse41.c).
+// unpack and pack both work per lane, so the words come back in order.
+static inline void ycc_to_rgb_16(__m256i y, __m256i cb, __m256i cr,
+                                 __m256i *r, __m256i *g, __m256i *b) {
+    const __m256i r_coef  = _mm256_set1_epi32((D2 << 16) | D1);
+    const __m256i g_coef  = _mm256_set1_epi32((int)(((uint32_t)-D3 << 16) | D1));
+    const __m256i g_coef2 = _mm256_set1_epi32((int)((1u << 16) | (uint16_t)-D4));
+    const __m256i b_coef  = _mm256_set1_epi32((D5 << 16) | D1);
+    const __m256i round   = _mm256_set1_epi32(1 << (K - 1));
+    const __m256i round16 = _mm256_set1_epi16(1 << (K - 1));
+
+    y  = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+    cb = _mm256_sub_epi16(cb, _mm256_set1_epi16(128));
+    cr = _mm256_sub_epi16(cr, _mm256_set1_epi16(128));
+
+    __m256i y_cr_lo = _mm256_unpacklo_epi16(y, cr), y_cr_hi = _mm256_unpackhi_epi16(y, cr);
+    __m256i y_cb_lo = _mm256_unpacklo_epi16(y, cb), y_cb_hi = _mm256_unpackhi_epi16(y, cb);
+    __m256i cb_1_lo = _mm256_unpacklo_epi16(cb, round16), cb_1_hi = _mm256_unpackhi_epi16(cb, round16);
+
+    __m256i r_lo = _mm256_add_epi32(_mm256_madd_epi16(y_cr_lo, r_coef), round);
+    __m256i r_hi = _mm256_add_epi32(_mm256_madd_epi16(y_cr_hi, r_coef), round);
+    __m256i g_lo = _mm256_add_epi32(_mm256_madd_epi16(y_cr_lo, g_coef), _mm256_madd_epi16(cb_1_lo, g_coef2));
+    __m256i g_hi = _mm256_add_epi32(_mm256_madd_epi16(y_cr_hi, g_coef), _mm256_madd_epi16(cb_1_hi, g_coef2));
+    __m256i b_lo = _mm256_add_epi32(_mm256_madd_epi16(y_cb_lo, b_coef), round);
+    __m256i b_hi = _mm256_add_epi32(_mm256_madd_epi16(y_cb_hi, b_coef), round);
+
+    *r = _mm256_packs_epi32(_mm256_srai_epi32(r_lo, K), _mm256_srai_epi32(r_hi, K));
+    *g = _mm256_packs_epi32(_mm256_srai_epi32(g_lo, K), _mm256_srai_epi32(g_hi, K));
+    *b = _mm256_packs_epi32(_mm256_srai_epi32(b_lo, K), _mm256_srai_epi32(b_hi, K));
+}
+
+// Narrow variant: 16 pixels per pmulhrsw, all in 16-bit lanes (see
+// optimized_sse41.c)
+static inline void ycc_to_rgb_16_narrow(__m256i y, __m256i cb, __m256i cr,
+                                        __m256i *r, __m256i *g, __m256i *b) {
+    y  = _mm256_slli_epi16(y, 7);
+    cb = _mm256_slli_epi16(cb, 7);
+    cr = _mm256_slli_epi16(cr, 7);
+
+    __m256i luma = _mm256_mulhrs_epi16(y, _mm256_set1_epi16(D1 << KN));
+    __m256i rv = _mm256_add_epi16(luma, _mm256_mulhrs_epi16(cr, _mm256_set1_epi16(D2 << KN)));
+    __m256i gv = _mm256_sub_epi16(luma, _mm256_mulhrs_epi16(cr, _mm256_set1_epi16(D3 << KN)));
+    gv = _mm256_sub_epi16(gv, _mm256_mulhrs_epi16(cb, _mm256_set1_epi16(D4 << KN)));
+    __m256i bv = _mm256_add_epi16(luma, _mm256_mulhrs_epi16(cb, _mm256_set1_epi16(D5 << KN)));
+
+    *r = _mm256_srai_epi16(_mm256_add_epi16(rv, _mm256_set1_epi16(NARROW_R_BIAS)), KN);
+    *g = _mm256_srai_epi16(_mm256_add_epi16(gv, _mm256_set1_epi16(NARROW_G_BIAS)), KN);
+    *b = _mm256_srai_epi16(_mm256_add_epi16(bv, _mm256_set1_epi16(NARROW_B_BIAS)), KN);
+}
+
+// narrow is a constant at every call, so each kernel inlines one arithmetic
+static inline int ycc_to_rgb_row(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width, int narrow
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int col = 0;
+
+    // each step reads 16 chroma samples plus their right neighbour
+    for (; col + 32 < width; col += 32) {
+        const uint8_t *C0[2] = { Cb0 + (col >> 1), Cr0 + (col >> 1) };
+        const uint8_t *C1[2] = { Cb1 + (col >> 1), Cr1 + (col >> 1) };
+        __m256i up[2][2][2]; // [chroma][output row][half]
+
+        for (int k = 0; k < 2; k++) {
+            __m256i a = load_u8_as_u16(C0[k]);
+            __m256i b = load_u8_as_u16(C0[k] + 1);
+            __m256i c = load_u8_as_u16(C1[k]);
+            __m256i d = load_u8_as_u16(C1[k] + 1);
+
+            __m256i right  = _mm256_srli_epi16(_mm256_add_epi16(a, b), 1);
+            __m256i below  = _mm256_srli_epi16(_mm256_add_epi16(a, c), 1);
+            __m256i middle = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b), _mm256_add_epi16(c, d)), 2);
+
+            // interleave per lane, then regroup lanes into pixels 0-15 / 16-31
+            __m256i t_lo = _mm256_unpacklo_epi16(a, right), t_hi = _mm256_unpackhi_epi16(a, right);
+            __m256i m_lo = _mm256_unpacklo_epi16(below, middle), m_hi = _mm256_unpackhi_epi16(below, middle);
+            up[k][0][0] = _mm256_permute2x128_si256(t_lo, t_hi, 0x20);
+            up[k][0][1] = _mm256_permute2x128_si256(t_lo, t_hi, 0x31);
+            up[k][1][0] = _mm256_permute2x128_si256(m_lo, m_hi, 0x20);
+            up[k][1][1] = _mm256_permute2x128_si256(m_lo, m_hi, 0x31);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            __m256i r[2], g[2], b[2];
+            for (int h = 0; h < 2; h++) {
+                __m256i y = load_u8_as_u16(Y[i] + col + 16 * h);
+                if (narrow) {
+                    ycc_to_rgb_16_narrow(y, up[0][i][h], up[1][i][h], &r[h], &g[h], &b[h]);
+                } else {
+                    ycc_to_rgb_16(y, up[0][i][h], up[1][i][h], &r[h], &g[h], &b[h]);
+                }
+            }
+            _mm256_storeu_si256((__m256i *)(R[i] + col), pack_ordered_u8(r[0], r[1]));
+            _mm256_storeu_si256((__m256i *)(G[i] + col), pack_ordered_u8(g[0], g[1]));
+            _mm256_storeu_si256((__m256i *)(B[i] + col), pack_ordered_u8(b[0], b[1]));
+        }
+    }
+    return col;
+}
+
+int optimized_YCC_to_RGB_row_avx2(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 0);
+}
+
+int optimized_YCC_to_RGB_row_narrow_avx2(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 1);
+}
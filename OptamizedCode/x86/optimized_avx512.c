@@ -0,0 +1,242 @@
+// optimized_avx512.c
+// AVX-512 (F + BW) row-pair kernels, 64 pixels per iteration. Same
+// arithmetic as the SSE4.1 kernels; the vpmov* narrowing instructions and
+// vpermt2w keep everything in pixel order without lane fix-ups.
+#include <immintrin.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+// Y, Cb and Cr for 32 pixels in 16-bit lanes (see optimized_sse41.c)
+static inline __m512i rgb_to_y_32(__m512i r, __m512i g, __m512i b) {
+    __m512i yv = _mm512_add_epi16(_mm512_set1_epi16(16 << K), _mm512_mullo_epi16(r, _mm512_set1_epi16(C11)));
+    yv = _mm512_add_epi16(yv, _mm512_mullo_epi16(g, _mm512_set1_epi16(C12)));
+    yv = _mm512_add_epi16(yv, _mm512_mullo_epi16(b, _mm512_set1_epi16(C13)));
+    return _mm512_srli_epi16(yv, K);
+}
+
+static inline void rgb_to_ycc_32(__m512i r, __m512i g, __m512i b,
+                                 __m512i *y, __m512i *cb, __m512i *cr) {
+    const __m512i c_bias = _mm512_set1_epi16((short)(128 << K));
+
+    *y = rgb_to_y_32(r, g, b);
+
+    __m512i cbv = _mm512_add_epi16(c_bias, _mm512_mullo_epi16(b, _mm512_set1_epi16(C23)));
+    cbv = _mm512_sub_epi16(cbv, _mm512_mullo_epi16(r, _mm512_set1_epi16(C21)));
+    cbv = _mm512_sub_epi16(cbv, _mm512_mullo_epi16(g, _mm512_set1_epi16(C22)));
+    *cb = _mm512_srli_epi16(cbv, K);
+
+    __m512i crv = _mm512_add_epi16(c_bias, _mm512_mullo_epi16(r, _mm512_set1_epi16(C31)));
+    crv = _mm512_sub_epi16(crv, _mm512_mullo_epi16(g, _mm512_set1_epi16(C32)));
+    crv = _mm512_sub_epi16(crv, _mm512_mullo_epi16(b, _mm512_set1_epi16(C33)));
+    *cr = _mm512_srli_epi16(crv, K);
+}
+
+static inline __m512i load_u8_as_u16(const uint8_t *p) {
+    return _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)p));
+}
+
+// One chroma channel of 16 blocks from the vertical sums of 32 columns,
+// with pmaddwd adding horizontal neighbours (see optimized_sse41.c)
+static inline __m512i chroma_from_sums_16(__m512i r, __m512i g, __m512i b, int cr_coef, int cg_coef,
+                                          int cb_coef) {
+    __m512i v = _mm512_add_epi32(_mm512_set1_epi32(128 << (K + 2)),
+                                 _mm512_madd_epi16(r, _mm512_set1_epi16((short)cr_coef)));
+    v = _mm512_add_epi32(v, _mm512_madd_epi16(g, _mm512_set1_epi16((short)cg_coef)));
+    v = _mm512_add_epi32(v, _mm512_madd_epi16(b, _mm512_set1_epi16((short)cb_coef)));
+    return _mm512_srai_epi32(v, K + 2);
+}
+
+// fast is a constant at every call: per-pixel chroma averaged, or chroma
+// once per block from the summed R, G and B
+static inline int rgb_to_ycc_row(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
+) {
+    const uint8_t *R[2] = { R0, R1 };
+    const uint8_t *G[2] = { G0, G1 };
+    const uint8_t *B[2] = { B0, B1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const __m512i ones = _mm512_set1_epi16(1);
+    int col = 0;
+
+    for (; col + 64 <= width; col += 64) {
+        __m512i cb_sum[2] = { _mm512_setzero_si512(), _mm512_setzero_si512() };
+        __m512i cr_sum[2] = { _mm512_setzero_si512(), _mm512_setzero_si512() };
+        __m512i rgb_sum[3][2] = { { _mm512_setzero_si512(), _mm512_setzero_si512() },
+                                  { _mm512_setzero_si512(), _mm512_setzero_si512() },
+                                  { _mm512_setzero_si512(), _mm512_setzero_si512() } };
+
+        for (int i = 0; i < 2; i++) {
+            for (int h = 0; h < 2; h++) {
+                int x = col + 32 * h;
+                __m512i r = load_u8_as_u16(R[i] + x);
+                __m512i g = load_u8_as_u16(G[i] + x);
+                __m512i b = load_u8_as_u16(B[i] + x);
+                __m512i y;
+                if (fast) {
+                    y = rgb_to_y_32(r, g, b);
+                    rgb_sum[0][h] = _mm512_add_epi16(rgb_sum[0][h], r);
+                    rgb_sum[1][h] = _mm512_add_epi16(rgb_sum[1][h], g);
+                    rgb_sum[2][h] = _mm512_add_epi16(rgb_sum[2][h], b);
+                } else {
+                    __m512i cb, cr;
+                    rgb_to_ycc_32(r, g, b, &y, &cb, &cr);
+                    cb_sum[h] = _mm512_add_epi16(cb_sum[h], cb);
+                    cr_sum[h] = _mm512_add_epi16(cr_sum[h], cr);
+                }
+                // Y never exceeds 235, so the truncating narrow is exact
+                _mm256_storeu_si256((__m256i *)(Y[i] + x), _mm512_cvtepi16_epi8(y));
+            }
+        }
+
+        // chroma from the block sums, or horizontal neighbours of the
+        // per-pixel chroma added in 32 bits and averaged; narrow to bytes
+        for (int h = 0; h < 2; h++) {
+            __m512i cb, cr;
+            if (fast) {
+                cb = chroma_from_sums_16(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], -C21, -C22, C23);
+                cr = chroma_from_sums_16(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], C31, -C32, -C33);
+            } else {
+                cb = _mm512_srli_epi32(_mm512_madd_epi16(cb_sum[h], ones), 2);
+                cr = _mm512_srli_epi32(_mm512_madd_epi16(cr_sum[h], ones), 2);
+            }
+            _mm_storeu_si128((__m128i *)(Cb + (col >> 1) + 16 * h), _mm512_cvtepi32_epi8(cb));
+            _mm_storeu_si128((__m128i *)(Cr + (col >> 1) + 16 * h), _mm512_cvtepi32_epi8(cr));
+        }
+    }
+    return col;
+}
+
+int optimized_RGB_to_YCC_row_avx512(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_RGB_to_YCC_row_fast_chroma_avx512(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 1);
+}
+
+// Luma only: Y of one row, no chroma
+int optimized_RGB_to_Y_row_avx512(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width) {
+    int col = 0;
+
+    for (; col + 64 <= width; col += 64) {
+        for (int h = 0; h < 2; h++) {
+            int x = col + 32 * h;
+            __m512i y = rgb_to_y_32(load_u8_as_u16(R + x), load_u8_as_u16(G + x), load_u8_as_u16(B + x));
+            _mm256_storeu_si256((__m256i *)(Y + x), _mm512_cvtepi16_epi8(y));
+        }
+    }
+    return col;
+}
+
+// R, G and B for 32 pixels using pmaddwd pairs (see optimized_sse41.c),
+// returned as signed words in pixel order
+static inline void ycc_to_rgb_32(__m512i y, __m512i cb, __m512i cr,
+                                 __m512i *r, __m512i *g, __m512i *b) {
+    const __m512i r_coef  = _mm512_set1_epi32((D2 << 16) | D1);
+    const __m512i g_coef  = _mm512_set1_epi32((int)(((uint32_t)-D3 << 16) | D1));
+    const __m512i g_coef2 = _mm512_set1_epi32((int)((1u << 16) | (uint16_t)-D4));
+    const __m512i b_coef  = _mm512_set1_epi32((D5 << 16) | D1);
+    const __m512i round   = _mm512_set1_epi32(1 << (K - 1));
+    const __m512i round16 = _mm512_set1_epi16(1 << (K - 1));
+
+    y  = _mm512_sub_epi16(y, _mm512_set1_epi16(16));
+    cb = _mm512_sub_epi16(cb, _mm512_set1_epi16(128));
+    cr = _mm512_sub_epi16(cr, _mm512_set1_epi16(128));
+
+    __m512i y_cr_lo = _mm512_unpacklo_epi16(y, cr), y_cr_hi = _mm512_unpackhi_epi16(y, cr);
+    __m512i y_cb_lo = _mm512_unpacklo_epi16(y, cb), y_cb_hi = _mm512_unpackhi_epi16(y, cb);
+    __m512i cb_1_lo = _mm512_unpacklo_epi16(cb, round16), cb_1_hi = _mm512_unpackhi_epi16(cb, round16);
+
+    __m512i r_lo = _mm512_add_epi32(_mm512_madd_epi16(y_cr_lo, r_coef), round);
+    __m512i r_hi = _mm512_add_epi32(_mm512_madd_epi16(y_cr_hi, r_coef), round);
+    __m512i g_lo = _mm512_add_epi32(_mm512_madd_epi16(y_cr_lo, g_coef), _mm512_madd_epi16(cb_1_lo, g_coef2));
+    __m512i g_hi = _mm512_add_epi32(_mm512_madd_epi16(y_cr_hi, g_coef), _mm512_madd_epi16(cb_1_hi, g_coef2));
+    __m512i b_lo = _mm512_add_epi32(_mm512_madd_epi16(y_cb_lo, b_coef), round);
+    __m512i b_hi = _mm512_add_epi32(_mm512_madd_epi16(y_cb_hi, b_coef), round);
+
+    *r = _mm512_packs_epi32(_mm512_srai_epi32(r_lo, K), _mm512_srai_epi32(r_hi, K));
+    *g = _mm512_packs_epi32(_mm512_srai_epi32(g_lo, K), _mm512_srai_epi32(g_hi, K));
+    *b = _mm512_packs_epi32(_mm512_srai_epi32(b_lo, K), _mm512_srai_epi32(b_hi, K));
+}
+
+// Saturate signed words to 0..255 and narrow to 32 ordered bytes
+static inline __m256i narrow_u8(__m512i v) {
+    return _mm512_cvtusepi16_epi8(_mm512_max_epi16(v, _mm512_setzero_si512()));
+}
+
+int optimized_YCC_to_RGB_row_avx512(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    // word indices interleaving two sources: a0 b0 a1 b1 ...
+    const __m512i zip_lo = _mm512_set_epi16(
+        47, 15, 46, 14, 45, 13, 44, 12, 43, 11, 42, 10, 41, 9, 40, 8,
+        39, 7, 38, 6, 37, 5, 36, 4, 35, 3, 34, 2, 33, 1, 32, 0);
+    const __m512i zip_hi = _mm512_set_epi16(
+        63, 31, 62, 30, 61, 29, 60, 28, 59, 27, 58, 26, 57, 25, 56, 24,
+        55, 23, 54, 22, 53, 21, 52, 20, 51, 19, 50, 18, 49, 17, 48, 16);
+    int col = 0;
+
+    // each step reads 32 chroma samples plus their right neighbour
+    for (; col + 64 < width; col += 64) {
+        const uint8_t *C0[2] = { Cb0 + (col >> 1), Cr0 + (col >> 1) };
+        const uint8_t *C1[2] = { Cb1 + (col >> 1), Cr1 + (col >> 1) };
+        __m512i up[2][2][2]; // [chroma][output row][half]
+
+        for (int k = 0; k < 2; k++) {
+            __m512i a = load_u8_as_u16(C0[k]);
+            __m512i b = load_u8_as_u16(C0[k] + 1);
+            __m512i c = load_u8_as_u16(C1[k]);
+            __m512i d = load_u8_as_u16(C1[k] + 1);
+
+            __m512i right  = _mm512_srli_epi16(_mm512_add_epi16(a, b), 1);
+            __m512i below  = _mm512_srli_epi16(_mm512_add_epi16(a, c), 1);
+            __m512i middle = _mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(a, b), _mm512_add_epi16(c, d)), 2);
+
+            up[k][0][0] = _mm512_permutex2var_epi16(a, zip_lo, right);
+            up[k][0][1] = _mm512_permutex2var_epi16(a, zip_hi, right);
+            up[k][1][0] = _mm512_permutex2var_epi16(below, zip_lo, middle);
+            up[k][1][1] = _mm512_permutex2var_epi16(below, zip_hi, middle);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            for (int h = 0; h < 2; h++) {
+                int x = col + 32 * h;
+                __m512i r, g, b;
+                ycc_to_rgb_32(load_u8_as_u16(Y[i] + x), up[0][i][h], up[1][i][h], &r, &g, &b);
+                _mm256_storeu_si256((__m256i *)(R[i] + x), narrow_u8(r));
+                _mm256_storeu_si256((__m256i *)(G[i] + x), narrow_u8(g));
+                _mm256_storeu_si256((__m256i *)(B[i] + x), narrow_u8(b));
+            }
+        }
+    }
+    return col;
+}
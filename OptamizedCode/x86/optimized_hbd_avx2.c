@@ -0,0 +1,195 @@
+// optimized_hbd_avx2.c
+// AVX2 row-pair kernels for 16-bit planes, 16 pixels per iteration, with
+// the arithmetic of optimized_hbd_sse41.c. Pack, hadd and unpack work per
+// 128-bit lane; the unpack/pack pairs cancel the lane split, and only the
+// narrowed chroma needs a cross-lane permute.
+#include <immintrin.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+// Samples are biased to signed (v - 32768) so pairs of them fit pmaddwd
+// with 16-bit coefficients; the bias terms fold into the offsets. In the
+// 32-bit lanes that come out, pixels are 0-3 | 8-11 (lo) and 4-7 | 12-15
+// (hi), which packusdw and phaddd put back in order without a permute.
+typedef struct {
+    __m256i rg_lo, rg_hi; // interleaved R and G
+    __m256i b_lo, b_hi;   // B interleaved with zero
+} biased_rgb_t;
+
+static inline void load_biased(const uint16_t *R, const uint16_t *G, const uint16_t *B, biased_rgb_t *v) {
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    __m256i r = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)R), bias);
+    __m256i g = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)G), bias);
+    __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)B), bias);
+
+    v->rg_lo = _mm256_unpacklo_epi16(r, g);
+    v->rg_hi = _mm256_unpackhi_epi16(r, g);
+    v->b_lo = _mm256_unpacklo_epi16(b, _mm256_setzero_si256());
+    v->b_hi = _mm256_unpackhi_epi16(b, _mm256_setzero_si256());
+}
+
+// One output channel: (offset + c1 r + c2 g + c3 b) >> K16 for both halves
+static inline void channel_16(const biased_rgb_t *v, __m256i rg_coef, __m256i b_coef, __m256i offset,
+                              __m256i out[2]) {
+    out[0] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(v->rg_lo, rg_coef),
+                                                                 _mm256_madd_epi16(v->b_lo, b_coef)), offset), K16);
+    out[1] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(v->rg_hi, rg_coef),
+                                                                 _mm256_madd_epi16(v->b_hi, b_coef)), offset), K16);
+}
+
+static inline __m256i coef_pair(int lo, int hi) {
+    return _mm256_set1_epi32((int)((uint32_t)(uint16_t)lo | (uint32_t)(uint16_t)hi << 16));
+}
+
+int optimized_RGB_to_YCC_row16_avx2(
+    const uint16_t *R0, const uint16_t *R1,
+    const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1,
+    uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr,
+    int width, int bits
+) {
+    const uint16_t *R[2] = { R0, R1 };
+    const uint16_t *G[2] = { G0, G1 };
+    const uint16_t *B[2] = { B0, B1 };
+    uint16_t *Y[2] = { Y0, Y1 };
+    const __m256i y_rg = coef_pair(C16_11, C16_12), y_b = coef_pair(C16_13, 0);
+    const __m256i cb_rg = coef_pair(-C16_21, -C16_22), cb_b = coef_pair(C16_23, 0);
+    const __m256i cr_rg = coef_pair(C16_31, -C16_32), cr_b = coef_pair(-C16_33, 0);
+    // the chroma coefficients sum to zero, so only Y pays for the bias
+    const __m256i y_off = _mm256_set1_epi32(((16 << (bits - 8)) << K16) + 32768 * (C16_11 + C16_12 + C16_13));
+    const __m256i c_off = _mm256_set1_epi32((128 << (bits - 8)) << K16);
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        __m256i cb_sum[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        __m256i cr_sum[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+        for (int i = 0; i < 2; i++) {
+            biased_rgb_t v;
+            __m256i y[2], cb[2], cr[2];
+            load_biased(R[i] + col, G[i] + col, B[i] + col, &v);
+            channel_16(&v, y_rg, y_b, y_off, y);
+            channel_16(&v, cb_rg, cb_b, c_off, cb);
+            channel_16(&v, cr_rg, cr_b, c_off, cr);
+            _mm256_storeu_si256((__m256i *)(Y[i] + col), _mm256_packus_epi32(y[0], y[1]));
+            for (int h = 0; h < 2; h++) {
+                cb_sum[h] = _mm256_add_epi32(cb_sum[h], cb[h]);
+                cr_sum[h] = _mm256_add_epi32(cr_sum[h], cr[h]);
+            }
+        }
+
+        // phaddd pairs horizontal neighbours into chroma columns 0-3 | 4-7
+        __m256i cb = _mm256_srli_epi32(_mm256_hadd_epi32(cb_sum[0], cb_sum[1]), 2);
+        __m256i cr = _mm256_srli_epi32(_mm256_hadd_epi32(cr_sum[0], cr_sum[1]), 2);
+        cb = _mm256_permute4x64_epi64(_mm256_packus_epi32(cb, cb), 0x08);
+        cr = _mm256_permute4x64_epi64(_mm256_packus_epi32(cr, cr), 0x08);
+        _mm_storeu_si128((__m128i *)(Cb + (col >> 1)), _mm256_castsi256_si128(cb));
+        _mm_storeu_si128((__m128i *)(Cr + (col >> 1)), _mm256_castsi256_si128(cr));
+    }
+    return col;
+}
+
+// YCC->RGB uses the same bias: Y pairs with Cr or Cb for pmaddwd, and the
+// offsets, the bias terms and the rounding constant fold into one constant
+// per channel. 32-bit sums may wrap before the constant is added; the
+// final value fits, so that is harmless.
+typedef struct {
+    __m256i r, g, b;
+} rgb_consts_t;
+
+// Chroma of 16 columns of both rows of a pair from chroma columns 0-8 of
+// C0 and C1, as 16 ordered samples per row. Sums are taken in 32 bits;
+// unpack gives pixels 0-3 | 8-11 and 4-7 | 12-15, which packusdw undoes.
+static inline void upsample_16(const uint16_t *C0, const uint16_t *C1, __m256i up[2]) {
+    __m256i c0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)C0));
+    __m256i n0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(C0 + 1)));
+    __m256i c1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)C1));
+    __m256i n1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(C1 + 1)));
+    __m256i top_odd = _mm256_srli_epi32(_mm256_add_epi32(c0, n0), 1);
+    __m256i bottom_even = _mm256_srli_epi32(_mm256_add_epi32(c0, c1), 1);
+    __m256i bottom_odd = _mm256_srli_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(c0, n0), _mm256_add_epi32(c1, n1)), 2);
+
+    up[0] = _mm256_packus_epi32(_mm256_unpacklo_epi32(c0, top_odd), _mm256_unpackhi_epi32(c0, top_odd));
+    up[1] = _mm256_packus_epi32(_mm256_unpacklo_epi32(bottom_even, bottom_odd),
+                                _mm256_unpackhi_epi32(bottom_even, bottom_odd));
+}
+
+// (pair . coef + k) >> K16 for both halves, narrowed to 16 ordered samples
+static inline __m256i madd_channel(__m256i lo, __m256i hi, __m256i coef, __m256i k) {
+    lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(lo, coef), k), K16);
+    hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(hi, coef), k), K16);
+    return _mm256_packus_epi32(lo, hi);
+}
+
+// R, G and B of 16 pixels, saturated to 0..max
+static inline void ycc_to_rgb_16(__m256i y, __m256i cb, __m256i cr, const rgb_consts_t *k, __m256i max,
+                                 __m256i *r, __m256i *g, __m256i *b) {
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    y = _mm256_xor_si256(y, bias);
+    cb = _mm256_xor_si256(cb, bias);
+    cr = _mm256_xor_si256(cr, bias);
+
+    __m256i ycr_lo = _mm256_unpacklo_epi16(y, cr), ycr_hi = _mm256_unpackhi_epi16(y, cr);
+    __m256i ycb_lo = _mm256_unpacklo_epi16(y, cb), ycb_hi = _mm256_unpackhi_epi16(y, cb);
+    __m256i cb_lo = _mm256_unpacklo_epi16(cb, _mm256_setzero_si256());
+    __m256i cb_hi = _mm256_unpackhi_epi16(cb, _mm256_setzero_si256());
+
+    *r = madd_channel(ycr_lo, ycr_hi, coef_pair(D16_1, D16_2), k->r);
+    *b = madd_channel(ycb_lo, ycb_hi, coef_pair(D16_1, D16_5), k->b);
+    __m256i g_lo = _mm256_add_epi32(_mm256_madd_epi16(cb_lo, coef_pair(-D16_4, 0)), k->g);
+    __m256i g_hi = _mm256_add_epi32(_mm256_madd_epi16(cb_hi, coef_pair(-D16_4, 0)), k->g);
+    g_lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycr_lo, coef_pair(D16_1, -D16_3)), g_lo), K16);
+    g_hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycr_hi, coef_pair(D16_1, -D16_3)), g_hi), K16);
+    *g = _mm256_packus_epi32(g_lo, g_hi);
+
+    // packusdw clamps to 0..65535; the upper limit depends on the bit depth
+    *r = _mm256_min_epu16(*r, max);
+    *g = _mm256_min_epu16(*g, max);
+    *b = _mm256_min_epu16(*b, max);
+}
+
+int optimized_YCC_to_RGB_row16_avx2(
+    const uint16_t *Y0, const uint16_t *Y1,
+    const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1,
+    uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1,
+    uint16_t *B0, uint16_t *B1,
+    int width, int bits
+) {
+    const uint16_t *Y[2] = { Y0, Y1 };
+    uint16_t *R[2] = { R0, R1 };
+    uint16_t *G[2] = { G0, G1 };
+    uint16_t *B[2] = { B0, B1 };
+    // 32768 - offset: what the bias leaves out of each term
+    const int y_rest = 32768 - (16 << (bits - 8));
+    const int c_rest = 32768 - (128 << (bits - 8));
+    const int round = 1 << (K16 - 1);
+    const rgb_consts_t k = {
+        _mm256_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) + (uint32_t)(D16_2 * c_rest))),
+        _mm256_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) - (uint32_t)((D16_3 + D16_4) * c_rest))),
+        _mm256_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) + (uint32_t)(D16_5 * c_rest)))
+    };
+    const __m256i max = _mm256_set1_epi16((short)((1 << bits) - 1));
+    int col = 0;
+
+    // chroma columns up to col/2 + 8 are read; the last group goes to the
+    // scalar kernel
+    for (; col + 16 < width; col += 16) {
+        __m256i cb[2], cr[2];
+        upsample_16(Cb0 + (col >> 1), Cb1 + (col >> 1), cb);
+        upsample_16(Cr0 + (col >> 1), Cr1 + (col >> 1), cr);
+
+        for (int i = 0; i < 2; i++) {
+            __m256i r, g, b;
+            ycc_to_rgb_16(_mm256_loadu_si256((const __m256i *)(Y[i] + col)), cb[i], cr[i], &k, max,
+                          &r, &g, &b);
+            _mm256_storeu_si256((__m256i *)(R[i] + col), r);
+            _mm256_storeu_si256((__m256i *)(G[i] + col), g);
+            _mm256_storeu_si256((__m256i *)(B[i] + col), b);
+        }
+    }
+    return col;
+}
@@ -0,0 +1,197 @@
+// optimized_hbd_sse41.c
+// SSE4.1 row-pair kernels for 16-bit planes, 8 pixels per iteration. The
+// products of 16-bit samples need 32 bits, so each group of 8 samples is
+// worked on as two vectors of 32-bit lanes and narrowed again with packusdw.
+#include <smmintrin.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+// The samples are biased to signed (v - 32768) so pairs of them fit
+// pmaddwd with 16-bit coefficients, which is much cheaper than pmulld; the
+// bias terms fold into the offsets. unpacklo/hi leave pixels 0-3 and 4-7.
+typedef struct {
+    __m128i rg_lo, rg_hi; // interleaved R and G
+    __m128i b_lo, b_hi;   // B interleaved with zero
+} biased_rgb_t;
+
+static inline void load_biased(const uint16_t *R, const uint16_t *G, const uint16_t *B, biased_rgb_t *v) {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i r = _mm_xor_si128(_mm_loadu_si128((const __m128i *)R), bias);
+    __m128i g = _mm_xor_si128(_mm_loadu_si128((const __m128i *)G), bias);
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)B), bias);
+
+    v->rg_lo = _mm_unpacklo_epi16(r, g);
+    v->rg_hi = _mm_unpackhi_epi16(r, g);
+    v->b_lo = _mm_unpacklo_epi16(b, _mm_setzero_si128());
+    v->b_hi = _mm_unpackhi_epi16(b, _mm_setzero_si128());
+}
+
+// One output channel: (offset + c1 r + c2 g + c3 b) >> K16 for both halves
+static inline void channel_8(const biased_rgb_t *v, __m128i rg_coef, __m128i b_coef, __m128i offset,
+                             __m128i out[2]) {
+    out[0] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(v->rg_lo, rg_coef),
+                                                        _mm_madd_epi16(v->b_lo, b_coef)), offset), K16);
+    out[1] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(v->rg_hi, rg_coef),
+                                                        _mm_madd_epi16(v->b_hi, b_coef)), offset), K16);
+}
+
+static inline __m128i coef_pair(int lo, int hi) {
+    return _mm_set1_epi32((int)((uint32_t)(uint16_t)lo | (uint32_t)(uint16_t)hi << 16));
+}
+
+static inline __m128i lo_u32(__m128i v) {
+    return _mm_cvtepu16_epi32(v);
+}
+
+static inline __m128i hi_u32(__m128i v) {
+    return _mm_cvtepu16_epi32(_mm_srli_si128(v, 8));
+}
+
+int optimized_RGB_to_YCC_row16_sse41(
+    const uint16_t *R0, const uint16_t *R1,
+    const uint16_t *G0, const uint16_t *G1,
+    const uint16_t *B0, const uint16_t *B1,
+    uint16_t *Y0, uint16_t *Y1,
+    uint16_t *Cb, uint16_t *Cr,
+    int width, int bits
+) {
+    const uint16_t *R[2] = { R0, R1 };
+    const uint16_t *G[2] = { G0, G1 };
+    const uint16_t *B[2] = { B0, B1 };
+    uint16_t *Y[2] = { Y0, Y1 };
+    const __m128i y_rg = coef_pair(C16_11, C16_12), y_b = coef_pair(C16_13, 0);
+    const __m128i cb_rg = coef_pair(-C16_21, -C16_22), cb_b = coef_pair(C16_23, 0);
+    const __m128i cr_rg = coef_pair(C16_31, -C16_32), cr_b = coef_pair(-C16_33, 0);
+    // the chroma coefficients sum to zero, so only Y pays for the bias
+    const __m128i y_off = _mm_set1_epi32(((16 << (bits - 8)) << K16) + 32768 * (C16_11 + C16_12 + C16_13));
+    const __m128i c_off = _mm_set1_epi32((128 << (bits - 8)) << K16);
+    int col = 0;
+
+    for (; col + 8 <= width; col += 8) {
+        // chroma sums of the pair, pixels 0-3 and 4-7
+        __m128i cb_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        __m128i cr_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+
+        for (int i = 0; i < 2; i++) {
+            biased_rgb_t v;
+            __m128i y[2], cb[2], cr[2];
+            load_biased(R[i] + col, G[i] + col, B[i] + col, &v);
+            channel_8(&v, y_rg, y_b, y_off, y);
+            channel_8(&v, cb_rg, cb_b, c_off, cb);
+            channel_8(&v, cr_rg, cr_b, c_off, cr);
+            _mm_storeu_si128((__m128i *)(Y[i] + col), _mm_packus_epi32(y[0], y[1]));
+            for (int h = 0; h < 2; h++) {
+                cb_sum[h] = _mm_add_epi32(cb_sum[h], cb[h]);
+                cr_sum[h] = _mm_add_epi32(cr_sum[h], cr[h]);
+            }
+        }
+
+        // phaddd adds horizontal neighbours into the 4 chroma columns in order
+        __m128i cb = _mm_srli_epi32(_mm_hadd_epi32(cb_sum[0], cb_sum[1]), 2);
+        __m128i cr = _mm_srli_epi32(_mm_hadd_epi32(cr_sum[0], cr_sum[1]), 2);
+        _mm_storel_epi64((__m128i *)(Cb + (col >> 1)), _mm_packus_epi32(cb, cb));
+        _mm_storel_epi64((__m128i *)(Cr + (col >> 1)), _mm_packus_epi32(cr, cr));
+    }
+    return col;
+}
+
+// YCC->RGB uses the same bias: Y pairs with Cr or Cb for pmaddwd, and the
+// offsets, the bias terms and the rounding constant fold into one constant
+// per channel. 32-bit sums may wrap before the constant is added; the
+// final value fits, so that is harmless.
+typedef struct {
+    __m128i r, g, b;
+} rgb_consts_t;
+
+// Chroma of 8 columns of both rows of a pair from chroma columns 0-4 of C0
+// and C1, as 8 ordered samples per row. Sums are taken in 32 bits.
+static inline void upsample_8(const uint16_t *C0, const uint16_t *C1, __m128i up[2]) {
+    __m128i c0 = lo_u32(_mm_loadl_epi64((const __m128i *)C0));
+    __m128i n0 = lo_u32(_mm_loadl_epi64((const __m128i *)(C0 + 1)));
+    __m128i c1 = lo_u32(_mm_loadl_epi64((const __m128i *)C1));
+    __m128i n1 = lo_u32(_mm_loadl_epi64((const __m128i *)(C1 + 1)));
+    __m128i top_odd = _mm_srli_epi32(_mm_add_epi32(c0, n0), 1);
+    __m128i bottom_even = _mm_srli_epi32(_mm_add_epi32(c0, c1), 1);
+    __m128i bottom_odd = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(c0, n0), _mm_add_epi32(c1, n1)), 2);
+
+    up[0] = _mm_packus_epi32(_mm_unpacklo_epi32(c0, top_odd), _mm_unpackhi_epi32(c0, top_odd));
+    up[1] = _mm_packus_epi32(_mm_unpacklo_epi32(bottom_even, bottom_odd),
+                             _mm_unpackhi_epi32(bottom_even, bottom_odd));
+}
+
+// (pair . coef + k) >> K16 for both halves, narrowed to 8 samples
+static inline __m128i madd_channel(__m128i lo, __m128i hi, __m128i coef, __m128i k) {
+    lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lo, coef), k), K16);
+    hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(hi, coef), k), K16);
+    return _mm_packus_epi32(lo, hi);
+}
+
+// R, G and B of 8 pixels, saturated to 0..max
+static inline void ycc_to_rgb_8(__m128i y, __m128i cb, __m128i cr, const rgb_consts_t *k, __m128i max,
+                                __m128i *r, __m128i *g, __m128i *b) {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    y = _mm_xor_si128(y, bias);
+    cb = _mm_xor_si128(cb, bias);
+    cr = _mm_xor_si128(cr, bias);
+
+    __m128i ycr_lo = _mm_unpacklo_epi16(y, cr), ycr_hi = _mm_unpackhi_epi16(y, cr);
+    __m128i ycb_lo = _mm_unpacklo_epi16(y, cb), ycb_hi = _mm_unpackhi_epi16(y, cb);
+    __m128i cb_lo = _mm_unpacklo_epi16(cb, _mm_setzero_si128());
+    __m128i cb_hi = _mm_unpackhi_epi16(cb, _mm_setzero_si128());
+
+    *r = madd_channel(ycr_lo, ycr_hi, coef_pair(D16_1, D16_2), k->r);
+    *b = madd_channel(ycb_lo, ycb_hi, coef_pair(D16_1, D16_5), k->b);
+    __m128i g_lo = _mm_add_epi32(_mm_madd_epi16(cb_lo, coef_pair(-D16_4, 0)), k->g);
+    __m128i g_hi = _mm_add_epi32(_mm_madd_epi16(cb_hi, coef_pair(-D16_4, 0)), k->g);
+    g_lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycr_lo, coef_pair(D16_1, -D16_3)), g_lo), K16);
+    g_hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycr_hi, coef_pair(D16_1, -D16_3)), g_hi), K16);
+    *g = _mm_packus_epi32(g_lo, g_hi);
+
+    // packusdw clamps to 0..65535; the upper limit depends on the bit depth
+    *r = _mm_min_epu16(*r, max);
+    *g = _mm_min_epu16(*g, max);
+    *b = _mm_min_epu16(*b, max);
+}
+
+int optimized_YCC_to_RGB_row16_sse41(
+    const uint16_t *Y0, const uint16_t *Y1,
+    const uint16_t *Cb0, const uint16_t *Cb1,
+    const uint16_t *Cr0, const uint16_t *Cr1,
+    uint16_t *R0, uint16_t *R1,
+    uint16_t *G0, uint16_t *G1,
+    uint16_t *B0, uint16_t *B1,
+    int width, int bits
+) {
+    const uint16_t *Y[2] = { Y0, Y1 };
+    uint16_t *R[2] = { R0, R1 };
+    uint16_t *G[2] = { G0, G1 };
+    uint16_t *B[2] = { B0, B1 };
+    // 32768 - offset: what the bias leaves out of each term
+    const int y_rest = 32768 - (16 << (bits - 8));
+    const int c_rest = 32768 - (128 << (bits - 8));
+    const int round = 1 << (K16 - 1);
+    const rgb_consts_t k = {
+        _mm_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) + (uint32_t)(D16_2 * c_rest))),
+        _mm_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) - (uint32_t)((D16_3 + D16_4) * c_rest))),
+        _mm_set1_epi32((int)((uint32_t)(D16_1 * y_rest + round) + (uint32_t)(D16_5 * c_rest)))
+    };
+    const __m128i max = _mm_set1_epi16((short)((1 << bits) - 1));
+    int col = 0;
+
+    // chroma columns up to col/2 + 4 are read, so the last group is left
+    // to the scalar kernel, which clamps the right neighbour
+    for (; col + 8 < width; col += 8) {
+        __m128i cb[2], cr[2];
+        upsample_8(Cb0 + (col >> 1), Cb1 + (col >> 1), cb);
+        upsample_8(Cr0 + (col >> 1), Cr1 + (col >> 1), cr);
+
+        for (int i = 0; i < 2; i++) {
+            __m128i r, g, b;
+            ycc_to_rgb_8(_mm_loadu_si128((const __m128i *)(Y[i] + col)), cb[i], cr[i], &k, max, &r, &g, &b);
+            _mm_storeu_si128((__m128i *)(R[i] + col), r);
+            _mm_storeu_si128((__m128i *)(G[i] + col), g);
+            _mm_storeu_si128((__m128i *)(B[i] + col), b);
+        }
+    }
+    return col;
+}
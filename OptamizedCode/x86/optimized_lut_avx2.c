@@ -0,0 +1,223 @@
+// optimized_lut_avx2.c
+// AVX2 gather variant of the table-driven kernels (non_neon/optimized_lut.c):
+// eight pixels per step, each product fetched with vpgatherdd from the
+// same tables. Sums stay in 32-bit lanes; saturation is done by the
+// unsigned packs instead of the range table. Tails go to the scalar LUT
+// kernels, so these return the full width.
+#include <immintrin.h>
+#include <stdint.h>
+#include <string.h>
+#include "optimized_global.h"
+
+static inline __m256i lookup(const int32_t *table, __m256i index) {
+    return _mm256_i32gather_epi32((const int *)table, index, 4);
+}
+
+static inline __m256i load_u8_8(const uint8_t *p) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+// Channel ch of 8 packed pixels. Each gather reads 4 bytes, so the caller
+// keeps at least one pixel after the group.
+static inline __m256i load_packed_8(const uint8_t *p, int ch) {
+    const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    __m256i v = _mm256_i32gather_epi32((const int *)(p + ch), offsets, 1);
+    return _mm256_and_si256(v, _mm256_set1_epi32(0xFF));
+}
+
+// 8 lanes -> 8 saturated bytes in the low half
+static inline __m128i pack_u8_8(__m256i v) {
+    __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_packus_epi16(w, w);
+}
+
+static inline void rgb_to_ycc_8(const csc_lut_t *t, __m256i r, __m256i g, __m256i b,
+                                __m256i *y, __m256i *cb, __m256i *cr) {
+    *y  = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(lookup(t->y_r, r), lookup(t->y_g, g)),
+                                             lookup(t->y_b, b)), K);
+    *cb = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(lookup(t->cb_r, r), lookup(t->cb_g, g)),
+                                             lookup(t->cb_b, b)), K);
+    *cr = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(lookup(t->cr_r, r), lookup(t->cr_g, g)),
+                                             lookup(t->cr_b, b)), K);
+}
+
+// Average the horizontal pairs of a two-row chroma sum: 8 lanes -> 4 bytes
+static inline void store_chroma_4(uint8_t *dst, __m256i sum) {
+    __m256i pairs = _mm256_hadd_epi32(sum, sum); // s01 s23 s01 s23 | s45 s67 s45 s67
+    pairs = _mm256_permutevar8x32_epi32(pairs, _mm256_setr_epi32(0, 1, 4, 5, 0, 1, 4, 5));
+    __m128i v = _mm_srli_epi32(_mm256_castsi256_si128(pairs), 2);
+    v = _mm_packus_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    int32_t bytes = _mm_cvtsi128_si32(v);
+    memcpy(dst, &bytes, 4);
+}
+
+static inline __m128i load_u8_4(const uint8_t *p) {
+    int32_t bytes;
+    memcpy(&bytes, p, 4);
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+}
+
+// Chroma of 8 columns of both rows of a pair, upsampled from chroma
+// columns 0-4 of C0 (this chroma row) and C1 (the one below)
+static inline void upsample_8(const uint8_t *C0, const uint8_t *C1, __m256i up[2]) {
+    __m128i c0 = load_u8_4(C0), n0 = load_u8_4(C0 + 1);
+    __m128i c1 = load_u8_4(C1), n1 = load_u8_4(C1 + 1);
+    __m128i top_odd = _mm_srli_epi32(_mm_add_epi32(c0, n0), 1);
+    __m128i bottom_even = _mm_srli_epi32(_mm_add_epi32(c0, c1), 1);
+    __m128i bottom_odd = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(c0, n0), _mm_add_epi32(c1, n1)), 2);
+
+    up[0] = _mm256_set_m128i(_mm_unpackhi_epi32(c0, top_odd), _mm_unpacklo_epi32(c0, top_odd));
+    up[1] = _mm256_set_m128i(_mm_unpackhi_epi32(bottom_even, bottom_odd),
+                             _mm_unpacklo_epi32(bottom_even, bottom_odd));
+}
+
+static inline void ycc_to_rgb_8(const csc_lut_t *t, __m256i y, __m256i cb, __m256i cr, __m128i rgb[3]) {
+    __m256i luma = lookup(t->y, y);
+
+    rgb[0] = pack_u8_8(_mm256_srai_epi32(_mm256_add_epi32(luma, lookup(t->r_cr, cr)), K));
+    rgb[1] = pack_u8_8(_mm256_srai_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(luma, lookup(t->g_cr, cr)), lookup(t->g_cb, cb)), K));
+    rgb[2] = pack_u8_8(_mm256_srai_epi32(_mm256_add_epi32(luma, lookup(t->b_cb, cb)), K));
+}
+
+static inline void store_packed_8(uint8_t *P, const __m128i rgb[3], int r_idx) {
+    uint8_t c[3][16];
+
+    for (int k = 0; k < 3; k++) {
+        _mm_storeu_si128((__m128i *)c[k], rgb[k]);
+    }
+    for (int i = 0; i < 8; i++) {
+        P[3 * i + r_idx] = c[0][i];
+        P[3 * i + 1] = c[1][i];
+        P[3 * i + 2 - r_idx] = c[2][i];
+    }
+}
+
+int optimized_RGB_to_YCC_row_lut_avx2(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    int col = 0;
+
+    for (; col + 8 <= width; col += 8) {
+        __m256i y0, y1, cb0, cb1, cr0, cr1;
+        rgb_to_ycc_8(t, load_u8_8(R0 + col), load_u8_8(G0 + col), load_u8_8(B0 + col), &y0, &cb0, &cr0);
+        rgb_to_ycc_8(t, load_u8_8(R1 + col), load_u8_8(G1 + col), load_u8_8(B1 + col), &y1, &cb1, &cr1);
+        _mm_storel_epi64((__m128i *)(Y0 + col), pack_u8_8(y0));
+        _mm_storel_epi64((__m128i *)(Y1 + col), pack_u8_8(y1));
+        store_chroma_4(Cb + (col >> 1), _mm256_add_epi32(cb0, cb1));
+        store_chroma_4(Cr + (col >> 1), _mm256_add_epi32(cr0, cr1));
+    }
+    if (col < width) {
+        int h = col >> 1;
+        optimized_RGB_to_YCC_row_lut(R0 + col, R1 + col, G0 + col, G1 + col, B0 + col, B1 + col,
+                                     Y0 + col, Y1 + col, Cb + h, Cr + h, width - col);
+    }
+    return width;
+}
+
+int optimized_YCC_to_RGB_row_lut_avx2(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int col = 0;
+
+    // chroma columns up to col/2 + 4 are read, which the last group leaves
+    // to the scalar tail
+    for (; col + 8 < width; col += 8) {
+        __m256i cb[2], cr[2];
+        upsample_8(Cb0 + (col >> 1), Cb1 + (col >> 1), cb);
+        upsample_8(Cr0 + (col >> 1), Cr1 + (col >> 1), cr);
+        for (int i = 0; i < 2; i++) {
+            __m128i rgb[3];
+            ycc_to_rgb_8(t, load_u8_8(Y[i] + col), cb[i], cr[i], rgb);
+            _mm_storel_epi64((__m128i *)(R[i] + col), rgb[0]);
+            _mm_storel_epi64((__m128i *)(G[i] + col), rgb[1]);
+            _mm_storel_epi64((__m128i *)(B[i] + col), rgb[2]);
+        }
+    }
+    if (col < width) {
+        int h = col >> 1;
+        optimized_YCC_to_RGB_row_lut(Y0 + col, Y1 + col, Cb0 + h, Cb1 + h, Cr0 + h, Cr1 + h,
+                                     R0 + col, R1 + col, G0 + col, G1 + col, B0 + col, B1 + col,
+                                     width - col);
+    }
+    return width;
+}
+
+int optimized_packed_to_YCC_row_lut_avx2(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    int col = 0;
+
+    for (; col + 8 < width; col += 8) {
+        const uint8_t *p0 = P0 + 3 * col, *p1 = P1 + 3 * col;
+        __m256i y0, y1, cb0, cb1, cr0, cr1;
+        rgb_to_ycc_8(t, load_packed_8(p0, r_idx), load_packed_8(p0, 1), load_packed_8(p0, 2 - r_idx),
+                     &y0, &cb0, &cr0);
+        rgb_to_ycc_8(t, load_packed_8(p1, r_idx), load_packed_8(p1, 1), load_packed_8(p1, 2 - r_idx),
+                     &y1, &cb1, &cr1);
+        _mm_storel_epi64((__m128i *)(Y0 + col), pack_u8_8(y0));
+        _mm_storel_epi64((__m128i *)(Y1 + col), pack_u8_8(y1));
+        store_chroma_4(Cb + (col >> 1), _mm256_add_epi32(cb0, cb1));
+        store_chroma_4(Cr + (col >> 1), _mm256_add_epi32(cr0, cr1));
+    }
+    if (col < width) {
+        int h = col >> 1;
+        optimized_packed_to_YCC_row_lut(P0 + 3 * col, P1 + 3 * col, order,
+                                        Y0 + col, Y1 + col, Cb + h, Cr + h, width - col);
+    }
+    return width;
+}
+
+int optimized_YCC_to_packed_row_lut_avx2(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    const csc_lut_t *t = csc_lut();
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    int col = 0;
+
+    for (; col + 8 < width; col += 8) {
+        __m256i cb[2], cr[2];
+        upsample_8(Cb0 + (col >> 1), Cb1 + (col >> 1), cb);
+        upsample_8(Cr0 + (col >> 1), Cr1 + (col >> 1), cr);
+        for (int i = 0; i < 2; i++) {
+            __m128i rgb[3];
+            ycc_to_rgb_8(t, load_u8_8(Y[i] + col), cb[i], cr[i], rgb);
+            store_packed_8(P[i] + 3 * col, rgb, r_idx);
+        }
+    }
+    if (col < width) {
+        int h = col >> 1;
+        optimized_YCC_to_packed_row_lut(Y0 + col, Y1 + col, Cb0 + h, Cb1 + h, Cr0 + h, Cr1 + h,
+                                        P0 + 3 * col, P1 + 3 * col, order, width - col);
+    }
+    return width;
+}
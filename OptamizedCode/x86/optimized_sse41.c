@@ -0,0 +1,529 @@
+// optimized_sse41.c
+// SSE4.1 row-pair kernels, 16 pixels per iteration. Built with -msse4.1 and
+// only called after optimized_dispatch.c has seen SSE4.1 in CPUID.
+#include <smmintrin.h>
+#include <stdint.h>
+#include "optimized_global.h"
+
+// Y of 8 pixels in 16-bit lanes
+static inline __m128i rgb_to_y_8(__m128i r, __m128i g, __m128i b) {
+    __m128i yv = _mm_add_epi16(_mm_set1_epi16(16 << K), _mm_mullo_epi16(r, _mm_set1_epi16(C11)));
+    yv = _mm_add_epi16(yv, _mm_mullo_epi16(g, _mm_set1_epi16(C12)));
+    yv = _mm_add_epi16(yv, _mm_mullo_epi16(b, _mm_set1_epi16(C13)));
+    return _mm_srli_epi16(yv, K);
+}
+
+// Y, Cb and Cr for 8 pixels in 16-bit lanes. Adding the positive terms
+// first keeps every intermediate within 0..65535, so the wrapping 16-bit
+// multiplies give exact results and no clamping is needed.
+static inline void rgb_to_ycc_8(__m128i r, __m128i g, __m128i b,
+                                __m128i *y, __m128i *cb, __m128i *cr) {
+    const __m128i c_bias = _mm_set1_epi16((short)(128 << K));
+
+    *y = rgb_to_y_8(r, g, b);
+
+    __m128i cbv = _mm_add_epi16(c_bias, _mm_mullo_epi16(b, _mm_set1_epi16(C23)));
+    cbv = _mm_sub_epi16(cbv, _mm_mullo_epi16(r, _mm_set1_epi16(C21)));
+    cbv = _mm_sub_epi16(cbv, _mm_mullo_epi16(g, _mm_set1_epi16(C22)));
+    *cb = _mm_srli_epi16(cbv, K);
+
+    __m128i crv = _mm_add_epi16(c_bias, _mm_mullo_epi16(r, _mm_set1_epi16(C31)));
+    crv = _mm_sub_epi16(crv, _mm_mullo_epi16(g, _mm_set1_epi16(C32)));
+    crv = _mm_sub_epi16(crv, _mm_mullo_epi16(b, _mm_set1_epi16(C33)));
+    *cr = _mm_srli_epi16(crv, K);
+}
+
+// Convert 16 pixels of one row: store Y and add the per-pixel chroma into
+// cb_sum/cr_sum (low and high 8 pixels), still at full resolution
+static inline void rgb_to_ycc_16(__m128i r, __m128i g, __m128i b, uint8_t *Y,
+                                 __m128i cb_sum[2], __m128i cr_sum[2]) {
+    __m128i y[2];
+
+    for (int h = 0; h < 2; h++) {
+        __m128i cb, cr;
+        rgb_to_ycc_8(_mm_cvtepu8_epi16(h ? _mm_srli_si128(r, 8) : r),
+                     _mm_cvtepu8_epi16(h ? _mm_srli_si128(g, 8) : g),
+                     _mm_cvtepu8_epi16(h ? _mm_srli_si128(b, 8) : b),
+                     &y[h], &cb, &cr);
+        cb_sum[h] = _mm_add_epi16(cb_sum[h], cb);
+        cr_sum[h] = _mm_add_epi16(cr_sum[h], cr);
+    }
+    _mm_storeu_si128((__m128i *)Y, _mm_packus_epi16(y[0], y[1]));
+}
+
+// Add horizontal neighbours of the vertically summed chroma and store the
+// 2x2 averages (8 samples)
+static inline void store_chroma_8(const __m128i cb_sum[2], const __m128i cr_sum[2],
+                                  uint8_t *Cb, uint8_t *Cr) {
+    __m128i cb = _mm_srli_epi16(_mm_hadd_epi16(cb_sum[0], cb_sum[1]), 2);
+    __m128i cr = _mm_srli_epi16(_mm_hadd_epi16(cr_sum[0], cr_sum[1]), 2);
+    _mm_storel_epi64((__m128i *)Cb, _mm_packus_epi16(cb, cb));
+    _mm_storel_epi64((__m128i *)Cr, _mm_packus_epi16(cr, cr));
+}
+
+// Fast chroma: only Y is converted per pixel. R, G and B of 16 pixels are
+// added into rgb_sum ([channel][low/high 8 pixels]) for the 2x2 blocks.
+static inline void rgb_to_y_16(__m128i r, __m128i g, __m128i b, uint8_t *Y, __m128i rgb_sum[3][2]) {
+    __m128i y[2];
+
+    for (int h = 0; h < 2; h++) {
+        __m128i ch[3] = {
+            _mm_cvtepu8_epi16(h ? _mm_srli_si128(r, 8) : r),
+            _mm_cvtepu8_epi16(h ? _mm_srli_si128(g, 8) : g),
+            _mm_cvtepu8_epi16(h ? _mm_srli_si128(b, 8) : b)
+        };
+        y[h] = rgb_to_y_8(ch[0], ch[1], ch[2]);
+        for (int c = 0; c < 3; c++) {
+            rgb_sum[c][h] = _mm_add_epi16(rgb_sum[c][h], ch[c]);
+        }
+    }
+    _mm_storeu_si128((__m128i *)Y, _mm_packus_epi16(y[0], y[1]));
+}
+
+// One chroma channel of 4 blocks from the vertical sums of 8 columns:
+// pmaddwd adds horizontal neighbours while multiplying, so each product
+// is taken once per block in 32 bits
+static inline __m128i chroma_from_sums_4(__m128i r, __m128i g, __m128i b, int cr_coef, int cg_coef,
+                                         int cb_coef) {
+    __m128i v = _mm_add_epi32(_mm_set1_epi32(128 << (K + 2)), _mm_madd_epi16(r, _mm_set1_epi16((short)cr_coef)));
+    v = _mm_add_epi32(v, _mm_madd_epi16(g, _mm_set1_epi16((short)cg_coef)));
+    v = _mm_add_epi32(v, _mm_madd_epi16(b, _mm_set1_epi16((short)cb_coef)));
+    return _mm_srai_epi32(v, K + 2);
+}
+
+// Cb and Cr of 8 blocks from the summed channels (see
+// non_neon/optimized_fast_chroma.c)
+static inline void store_chroma_sums_8(const __m128i rgb_sum[3][2], uint8_t *Cb, uint8_t *Cr) {
+    __m128i cb[2], cr[2];
+
+    for (int h = 0; h < 2; h++) {
+        cb[h] = chroma_from_sums_4(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], -C21, -C22, C23);
+        cr[h] = chroma_from_sums_4(rgb_sum[0][h], rgb_sum[1][h], rgb_sum[2][h], C31, -C32, -C33);
+    }
+    __m128i cb16 = _mm_packs_epi32(cb[0], cb[1]);
+    __m128i cr16 = _mm_packs_epi32(cr[0], cr[1]);
+    _mm_storel_epi64((__m128i *)Cb, _mm_packus_epi16(cb16, cb16));
+    _mm_storel_epi64((__m128i *)Cr, _mm_packus_epi16(cr16, cr16));
+}
+
+// Planar row pair; fast is a constant at every call, so each kernel
+// inlines one way of computing chroma
+static inline int rgb_to_ycc_row(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
+) {
+    const uint8_t *R[2] = { R0, R1 };
+    const uint8_t *G[2] = { G0, G1 };
+    const uint8_t *B[2] = { B0, B1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        // per-pixel chroma, or R, G and B, of both rows, summed vertically
+        __m128i cb_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        __m128i cr_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        __m128i rgb_sum[3][2] = { { _mm_setzero_si128(), _mm_setzero_si128() },
+                                  { _mm_setzero_si128(), _mm_setzero_si128() },
+                                  { _mm_setzero_si128(), _mm_setzero_si128() } };
+
+        for (int i = 0; i < 2; i++) {
+            __m128i r = _mm_loadu_si128((const __m128i *)(R[i] + col));
+            __m128i g = _mm_loadu_si128((const __m128i *)(G[i] + col));
+            __m128i b = _mm_loadu_si128((const __m128i *)(B[i] + col));
+            if (fast) {
+                rgb_to_y_16(r, g, b, Y[i] + col, rgb_sum);
+            } else {
+                rgb_to_ycc_16(r, g, b, Y[i] + col, cb_sum, cr_sum);
+            }
+        }
+        if (fast) {
+            store_chroma_sums_8(rgb_sum, Cb + (col >> 1), Cr + (col >> 1));
+        } else {
+            store_chroma_8(cb_sum, cr_sum, Cb + (col >> 1), Cr + (col >> 1));
+        }
+    }
+    return col;
+}
+
+int optimized_RGB_to_YCC_row_sse41(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_RGB_to_YCC_row_fast_chroma_sse41(
+    const uint8_t *R0, const uint8_t *R1,
+    const uint8_t *G0, const uint8_t *G1,
+    const uint8_t *B0, const uint8_t *B1,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return rgb_to_ycc_row(R0, R1, G0, G1, B0, B1, Y0, Y1, Cb, Cr, width, 1);
+}
+
+// Split 16 packed 24-bit pixels (48 bytes) into their three channels.
+// Each channel gathers its bytes from all three loads with pshufb; lanes
+// a mask does not fill are zeroed (-1) so the three parts can be ORed.
+static inline void deinterleave_16(const uint8_t *P, __m128i ch[3]) {
+    static const int8_t masks[3][3][16] = {
+        { { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+        { { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+        { { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+          { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } },
+    };
+    __m128i v[3];
+
+    for (int j = 0; j < 3; j++) {
+        v[j] = _mm_loadu_si128((const __m128i *)(P + 16 * j));
+    }
+    for (int k = 0; k < 3; k++) {
+        ch[k] = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(v[0], _mm_loadu_si128((const __m128i *)masks[k][0])),
+                         _mm_shuffle_epi8(v[1], _mm_loadu_si128((const __m128i *)masks[k][1]))),
+            _mm_shuffle_epi8(v[2], _mm_loadu_si128((const __m128i *)masks[k][2])));
+    }
+}
+
+// Inverse of deinterleave_16: store three channels as 16 packed pixels
+static inline void interleave_16(const __m128i ch[3], uint8_t *P) {
+    static const int8_t masks[3][3][16] = {
+        { { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+          { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+          { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+        { { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+          { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+          { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+        { { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+          { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+          { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } },
+    };
+
+    for (int j = 0; j < 3; j++) {
+        __m128i v = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(ch[0], _mm_loadu_si128((const __m128i *)masks[j][0])),
+                         _mm_shuffle_epi8(ch[1], _mm_loadu_si128((const __m128i *)masks[j][1]))),
+            _mm_shuffle_epi8(ch[2], _mm_loadu_si128((const __m128i *)masks[j][2])));
+        _mm_storeu_si128((__m128i *)(P + 16 * j), v);
+    }
+}
+
+// Packed RGB24/BGR24 row pair. The pixels are split into channels in
+// registers, so the input is never copied into planes.
+static inline int packed_to_ycc_row(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width, int fast
+) {
+    const uint8_t *P[2] = { P0, P1 };
+    uint8_t *Y[2] = { Y0, Y1 };
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        __m128i cb_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        __m128i cr_sum[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+        __m128i rgb_sum[3][2] = { { _mm_setzero_si128(), _mm_setzero_si128() },
+                                  { _mm_setzero_si128(), _mm_setzero_si128() },
+                                  { _mm_setzero_si128(), _mm_setzero_si128() } };
+
+        for (int i = 0; i < 2; i++) {
+            __m128i ch[3];
+            deinterleave_16(P[i] + 3 * col, ch);
+            if (fast) {
+                rgb_to_y_16(ch[r_idx], ch[1], ch[b_idx], Y[i] + col, rgb_sum);
+            } else {
+                rgb_to_ycc_16(ch[r_idx], ch[1], ch[b_idx], Y[i] + col, cb_sum, cr_sum);
+            }
+        }
+        if (fast) {
+            store_chroma_sums_8(rgb_sum, Cb + (col >> 1), Cr + (col >> 1));
+        } else {
+            store_chroma_8(cb_sum, cr_sum, Cb + (col >> 1), Cr + (col >> 1));
+        }
+    }
+    return col;
+}
+
+int optimized_packed_to_YCC_row_sse41(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return packed_to_ycc_row(P0, P1, order, Y0, Y1, Cb, Cr, width, 0);
+}
+
+int optimized_packed_to_YCC_row_fast_chroma_sse41(
+    const uint8_t *P0, const uint8_t *P1, csc_pixel_order_t order,
+    uint8_t *Y0, uint8_t *Y1,
+    uint8_t *Cb, uint8_t *Cr,
+    int width
+) {
+    return packed_to_ycc_row(P0, P1, order, Y0, Y1, Cb, Cr, width, 1);
+}
+
+// Luma only: Y of 16 pixels, with no chroma or channel sums. pmaddubsw
+// takes R and B with their byte-sized coefficients in one multiply-add;
+// C12 is 129, too big for a signed byte, so G adds in as (g << 7) + g.
+// Every sum stays below 65536.
+static inline void store_y_16(__m128i r, __m128i g, __m128i b, uint8_t *Y) {
+    const __m128i rb_coef = _mm_set1_epi16((short)(C13 << 8 | C11));
+    const __m128i bias = _mm_set1_epi16(16 << K);
+    __m128i y[2];
+
+    for (int h = 0; h < 2; h++) {
+        __m128i rb = h ? _mm_unpackhi_epi8(r, b) : _mm_unpacklo_epi8(r, b);
+        __m128i g16 = h ? _mm_unpackhi_epi8(g, _mm_setzero_si128()) : _mm_unpacklo_epi8(g, _mm_setzero_si128());
+        __m128i v = _mm_add_epi16(_mm_maddubs_epi16(rb, rb_coef), bias);
+        v = _mm_add_epi16(v, _mm_add_epi16(_mm_slli_epi16(g16, 7), g16));
+        y[h] = _mm_srli_epi16(v, K);
+    }
+    _mm_storeu_si128((__m128i *)Y, _mm_packus_epi16(y[0], y[1]));
+}
+
+int optimized_RGB_to_Y_row_sse41(const uint8_t *R, const uint8_t *G, const uint8_t *B, uint8_t *Y, int width) {
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        store_y_16(_mm_loadu_si128((const __m128i *)(R + col)), _mm_loadu_si128((const __m128i *)(G + col)),
+                   _mm_loadu_si128((const __m128i *)(B + col)), Y + col);
+    }
+    return col;
+}
+
+int optimized_packed_to_Y_row_sse41(const uint8_t *P, csc_pixel_order_t order, uint8_t *Y, int width) {
+    const int r_idx = (order == CSC_ORDER_BGR) ? 2 : 0;
+    const int b_idx = 2 - r_idx;
+    int col = 0;
+
+    for (; col + 16 <= width; col += 16) {
+        __m128i ch[3];
+        deinterleave_16(P + 3 * col, ch);
+        store_y_16(ch[r_idx], ch[1], ch[b_idx], Y + col);
+    }
+    return col;
+}
+
+// R, G and B for 8 pixels. Each channel is a pair of 16-bit terms fed to
+// pmaddwd, which produces the 32-bit sum the D coefficients need; the
+// rounding constant rides along as a second term paired with 1.
+static inline void ycc_to_rgb_8(__m128i y, __m128i cb, __m128i cr,
+                                __m128i *r, __m128i *g, __m128i *b) {
+    const __m128i r_coef  = _mm_set_epi16(D2, D1, D2, D1, D2, D1, D2, D1);
+    const __m128i g_coef  = _mm_set_epi16(-D3, D1, -D3, D1, -D3, D1, -D3, D1);
+    const __m128i g_coef2 = _mm_set_epi16(1, -D4, 1, -D4, 1, -D4, 1, -D4);
+    const __m128i b_coef  = _mm_set_epi16(D5, D1, D5, D1, D5, D1, D5, D1);
+    const __m128i round   = _mm_set1_epi32(1 << (K - 1));
+    const __m128i round16 = _mm_set1_epi16(1 << (K - 1));
+
+    y  = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    cb = _mm_sub_epi16(cb, _mm_set1_epi16(128));
+    cr = _mm_sub_epi16(cr, _mm_set1_epi16(128));
+
+    __m128i y_cr_lo = _mm_unpacklo_epi16(y, cr), y_cr_hi = _mm_unpackhi_epi16(y, cr);
+    __m128i y_cb_lo = _mm_unpacklo_epi16(y, cb), y_cb_hi = _mm_unpackhi_epi16(y, cb);
+    __m128i cb_1_lo = _mm_unpacklo_epi16(cb, round16), cb_1_hi = _mm_unpackhi_epi16(cb, round16);
+
+    __m128i r_lo = _mm_add_epi32(_mm_madd_epi16(y_cr_lo, r_coef), round);
+    __m128i r_hi = _mm_add_epi32(_mm_madd_epi16(y_cr_hi, r_coef), round);
+    __m128i g_lo = _mm_add_epi32(_mm_madd_epi16(y_cr_lo, g_coef), _mm_madd_epi16(cb_1_lo, g_coef2));
+    __m128i g_hi = _mm_add_epi32(_mm_madd_epi16(y_cr_hi, g_coef), _mm_madd_epi16(cb_1_hi, g_coef2));
+    __m128i b_lo = _mm_add_epi32(_mm_madd_epi16(y_cb_lo, b_coef), round);
+    __m128i b_hi = _mm_add_epi32(_mm_madd_epi16(y_cb_hi, b_coef), round);
+
+    *r = _mm_packs_epi32(_mm_srai_epi32(r_lo, K), _mm_srai_epi32(r_hi, K));
+    *g = _mm_packs_epi32(_mm_srai_epi32(g_lo, K), _mm_srai_epi32(g_hi, K));
+    *b = _mm_packs_epi32(_mm_srai_epi32(b_lo, K), _mm_srai_epi32(b_hi, K));
+}
+
+// Narrow variant of ycc_to_rgb_8: pmulhrsw keeps every term in 16-bit
+// lanes, so the 8 pixels take one multiply per term instead of two
+// (see the narrow section of optimized_global.h)
+static inline void ycc_to_rgb_8_narrow(__m128i y, __m128i cb, __m128i cr,
+                                       __m128i *r, __m128i *g, __m128i *b) {
+    y  = _mm_slli_epi16(y, 7);
+    cb = _mm_slli_epi16(cb, 7);
+    cr = _mm_slli_epi16(cr, 7);
+
+    __m128i luma = _mm_mulhrs_epi16(y, _mm_set1_epi16(D1 << KN));
+    __m128i rv = _mm_add_epi16(luma, _mm_mulhrs_epi16(cr, _mm_set1_epi16(D2 << KN)));
+    __m128i gv = _mm_sub_epi16(luma, _mm_mulhrs_epi16(cr, _mm_set1_epi16(D3 << KN)));
+    gv = _mm_sub_epi16(gv, _mm_mulhrs_epi16(cb, _mm_set1_epi16(D4 << KN)));
+    __m128i bv = _mm_add_epi16(luma, _mm_mulhrs_epi16(cb, _mm_set1_epi16(D5 << KN)));
+
+    *r = _mm_srai_epi16(_mm_add_epi16(rv, _mm_set1_epi16(NARROW_R_BIAS)), KN);
+    *g = _mm_srai_epi16(_mm_add_epi16(gv, _mm_set1_epi16(NARROW_G_BIAS)), KN);
+    *b = _mm_srai_epi16(_mm_add_epi16(bv, _mm_set1_epi16(NARROW_B_BIAS)), KN);
+}
+
+// Upsample 8 Cb and 8 Cr samples (plus right neighbours) of the current
+// and next chroma row into 16-bit lanes: up[chroma][output row][half]
+static inline void upsample_chroma_16(const uint8_t *Cb0, const uint8_t *Cb1,
+                                      const uint8_t *Cr0, const uint8_t *Cr1,
+                                      __m128i up[2][2][2]) {
+    const uint8_t *C0[2] = { Cb0, Cr0 };
+    const uint8_t *C1[2] = { Cb1, Cr1 };
+
+    for (int k = 0; k < 2; k++) {
+        __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)C0[k]));
+        __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(C0[k] + 1)));
+        __m128i c = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)C1[k]));
+        __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(C1[k] + 1)));
+
+        __m128i right  = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+        __m128i below  = _mm_srli_epi16(_mm_add_epi16(a, c), 1);
+        __m128i middle = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, d)), 2);
+
+        up[k][0][0] = _mm_unpacklo_epi16(a, right);
+        up[k][0][1] = _mm_unpackhi_epi16(a, right);
+        up[k][1][0] = _mm_unpacklo_epi16(below, middle);
+        up[k][1][1] = _mm_unpackhi_epi16(below, middle);
+    }
+}
+
+// Convert 16 pixels of one row given their upsampled chroma; ch[] receives
+// R, G and B saturated to 8 bits. narrow is a constant at every call, so
+// each caller inlines one arithmetic.
+static inline void ycc_to_rgb_16(const uint8_t *Y, __m128i cb[2], __m128i cr[2], __m128i ch[3],
+                                 int narrow) {
+    __m128i y = _mm_loadu_si128((const __m128i *)Y);
+    __m128i r[2], g[2], b[2];
+
+    for (int h = 0; h < 2; h++) {
+        __m128i y16 = _mm_cvtepu8_epi16(h ? _mm_srli_si128(y, 8) : y);
+        if (narrow) {
+            ycc_to_rgb_8_narrow(y16, cb[h], cr[h], &r[h], &g[h], &b[h]);
+        } else {
+            ycc_to_rgb_8(y16, cb[h], cr[h], &r[h], &g[h], &b[h]);
+        }
+    }
+    ch[0] = _mm_packus_epi16(r[0], r[1]);
+    ch[1] = _mm_packus_epi16(g[0], g[1]);
+    ch[2] = _mm_packus_epi16(b[0], b[1]);
+}
+
+static inline int ycc_to_rgb_row(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width, int narrow
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *R[2] = { R0, R1 };
+    uint8_t *G[2] = { G0, G1 };
+    uint8_t *B[2] = { B0, B1 };
+    int col = 0;
+
+    // each step reads 8 chroma samples plus their right neighbour
+    for (; col + 16 < width; col += 16) {
+        int c = col >> 1;
+        __m128i up[2][2][2]; // [chroma][output row][half]
+
+        upsample_chroma_16(Cb0 + c, Cb1 + c, Cr0 + c, Cr1 + c, up);
+
+        for (int i = 0; i < 2; i++) {
+            __m128i ch[3];
+            ycc_to_rgb_16(Y[i] + col, up[0][i], up[1][i], ch, narrow);
+            _mm_storeu_si128((__m128i *)(R[i] + col), ch[0]);
+            _mm_storeu_si128((__m128i *)(G[i] + col), ch[1]);
+            _mm_storeu_si128((__m128i *)(B[i] + col), ch[2]);
+        }
+    }
+    return col;
+}
+
+int optimized_YCC_to_RGB_row_sse41(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 0);
+}
+
+int optimized_YCC_to_RGB_row_narrow_sse41(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *R0, uint8_t *R1,
+    uint8_t *G0, uint8_t *G1,
+    uint8_t *B0, uint8_t *B1,
+    int width
+) {
+    return ycc_to_rgb_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, R0, R1, G0, G1, B0, B1, width, 1);
+}
+
+// Same as ycc_to_rgb_row but stores packed RGB24/BGR24
+static inline int ycc_to_packed_row(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width, int narrow
+) {
+    const uint8_t *Y[2] = { Y0, Y1 };
+    uint8_t *P[2] = { P0, P1 };
+    int col = 0;
+
+    for (; col + 16 < width; col += 16) {
+        int c = col >> 1;
+        __m128i up[2][2][2];
+
+        upsample_chroma_16(Cb0 + c, Cb1 + c, Cr0 + c, Cr1 + c, up);
+
+        for (int i = 0; i < 2; i++) {
+            __m128i ch[3];
+            ycc_to_rgb_16(Y[i] + col, up[0][i], up[1][i], ch, narrow);
+            if (order == CSC_ORDER_BGR) {
+                __m128i t = ch[0];
+                ch[0] = ch[2];
+                ch[2] = t;
+            }
+            interleave_16(ch, P[i] + 3 * col);
+        }
+    }
+    return col;
+}
+
+int optimized_YCC_to_packed_row_sse41(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    return ycc_to_packed_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, width, 0);
+}
+
+int optimized_YCC_to_packed_row_narrow_sse41(
+    const uint8_t *Y0, const uint8_t *Y1,
+    const uint8_t *Cb0, const uint8_t *Cb1,
+    const uint8_t *Cr0, const uint8_t *Cr1,
+    uint8_t *P0, uint8_t *P1, csc_pixel_order_t order,
+    int width
+) {
+    return ycc_to_packed_row(Y0, Y1, Cb0, Cb1, Cr0, Cr1, P0, P1, order, width, 1);
+}
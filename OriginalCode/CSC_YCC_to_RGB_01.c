@@ -7,6 +7,10 @@
 #include "CSC_global.h"
 
 // private data
+// Two-row ring buffer of upsampled chrominance: the full-resolution Cb and
+// Cr of image rows row+0 and row+1 of the row pair being converted
+static uint8_t Cb_line[2][IMAGE_COL_SIZE];
+static uint8_t Cr_line[2][IMAGE_COL_SIZE];
 
 // private prototypes
 // =======
@@ -23,7 +27,7 @@ static void chrominance_upsample(
     uint8_t C_pixel_3, uint8_t C_pixel_4,
     uint8_t *top, uint8_t *left, uint8_t *middle);
 // =======
-static void chrominance_array_upsample( void);
+static void chrominance_line_upsample( int row);
 
 // private definitions
 // =======
@@ -46,59 +50,56 @@ static void CSC_YCC_to_RGB_brute_force_float( int row, int col) {
   float G_pixel_00, G_pixel_01, G_pixel_10, G_pixel_11;
   float B_pixel_00, B_pixel_01, B_pixel_10, B_pixel_11;
 
-  // Upsample Cb and Cr into Cb_temp and Cr_temp
-  chrominance_array_upsample();
-
   R_pixel_00 =   1.164*(Y[row+0][col+0] - 16.0)
-               + 1.596*(Cr_temp[row+0][col+0] - 128.0);
+               + 1.596*(Cr_line[0][col+0] - 128.0);
   R[row+0][col+0] = saturation_float( R_pixel_00);
 //
   R_pixel_01 =   1.164*(Y[row+0][col+1] - 16.0)
-               + 1.596*(Cr_temp[row+0][col+1] - 128.0);
+               + 1.596*(Cr_line[0][col+1] - 128.0);
   R[row+0][col+1] = saturation_float( R_pixel_01);
 //
   R_pixel_10 =   1.164*(Y[row+1][col+0] - 16.0)
-               + 1.596*(Cr_temp[row+1][col+0] - 128.0);
+               + 1.596*(Cr_line[1][col+0] - 128.0);
   R[row+1][col+0] = saturation_float( R_pixel_10);
 //
   R_pixel_11 =   1.164*(Y[row+1][col+1] - 16.0)
-               + 1.596*(Cr_temp[row+1][col+1] - 128.0);
+               + 1.596*(Cr_line[1][col+1] - 128.0);
   R[row+1][col+1] = saturation_float( R_pixel_11);
 
   G_pixel_00 =   1.164*(Y[row+0][col+0] - 16.0)
-               - 0.813*(Cr_temp[row+0][col+0] - 128.0)
-               - 0.391*(Cb_temp[row+0][col+0] - 128.0);
+               - 0.813*(Cr_line[0][col+0] - 128.0)
+               - 0.391*(Cb_line[0][col+0] - 128.0);
   G[row+0][col+0] = saturation_float( G_pixel_00);
 //
   G_pixel_01 =   1.164*(Y[row+0][col+1] - 16.0)
-               - 0.813*(Cr_temp[row+0][col+1] - 128.0)
-               - 0.391*(Cb_temp[row+0][col+1] - 128.0);
+               - 0.813*(Cr_line[0][col+1] - 128.0)
+               - 0.391*(Cb_line[0][col+1] - 128.0);
   G[row+0][col+1] = saturation_float( G_pixel_01);
 //
   G_pixel_10 =   1.164*(Y[row+1][col+0] - 16.0)
-               - 0.813*(Cr_temp[row+1][col+0] - 128.0)
-               - 0.391*(Cb_temp[row+1][col+0] - 128.0);
+               - 0.813*(Cr_line[1][col+0] - 128.0)
+               - 0.391*(Cb_line[1][col+0] - 128.0);
   G[row+1][col+0] = saturation_float( G_pixel_10);
 //
   G_pixel_11 =   1.164*(Y[row+1][col+1] - 16.0)
-               - 0.813*(Cr_temp[row+1][col+1] - 128.0)
-               - 0.391*(Cb_temp[row+1][col+1] - 128.0);
+               - 0.813*(Cr_line[1][col+1] - 128.0)
+               - 0.391*(Cb_line[1][col+1] - 128.0);
   G[row+1][col+1] = saturation_float( G_pixel_11);
 
   B_pixel_00 =   1.164*(Y[row+0][col+0] - 16.0)
-               + 2.018*(Cb_temp[row+0][col+0] - 128.0);
+               + 2.018*(Cb_line[0][col+0] - 128.0);
   B[row+0][col+0] = saturation_float( B_pixel_00);
 //
   B_pixel_01 =   1.164*(Y[row+0][col+1] - 16.0)
-               + 2.018*(Cb_temp[row+0][col+1] - 128.0);
+               + 2.018*(Cb_line[0][col+1] - 128.0);
   B[row+0][col+1] = saturation_float( B_pixel_01);
 //
   B_pixel_10 =   1.164*(Y[row+1][col+0] - 16.0)
-               + 2.018*(Cb_temp[row+1][col+0] - 128.0);
+               + 2.018*(Cb_line[1][col+0] - 128.0);
   B[row+1][col+0] = saturation_float( B_pixel_10);
 //
   B_pixel_11 =   1.164*(Y[row+1][col+1] - 16.0)
-               + 2.018*(Cb_temp[row+1][col+1] - 128.0);
+               + 2.018*(Cb_line[1][col+1] - 128.0);
   B[row+1][col+1] = saturation_float( B_pixel_11);
 } // END of CSC_YCC_to_RGB_brute_force_float()
 
@@ -126,23 +127,20 @@ static void CSC_YCC_to_RGB_brute_force_int( int row, int col) {
   int Cb_pixel_00, Cb_pixel_01, Cb_pixel_10, Cb_pixel_11;
   int Cr_pixel_00, Cr_pixel_01, Cr_pixel_10, Cr_pixel_11;
 
-  // Upsample Cb and Cr into Cb_temp and Cr_temp
-  chrominance_array_upsample();
-
   Y_pixel_00 = (int)Y[row+0][col+0];
   Y_pixel_01 = (int)Y[row+0][col+1];
   Y_pixel_10 = (int)Y[row+1][col+0];
   Y_pixel_11 = (int)Y[row+1][col+1];
 
-  Cb_pixel_00 = (int)Cb_temp[row+0][col+0];
-  Cb_pixel_01 = (int)Cb_temp[row+0][col+1];
-  Cb_pixel_10 = (int)Cb_temp[row+1][col+0];
-  Cb_pixel_11 = (int)Cb_temp[row+1][col+1];
+  Cb_pixel_00 = (int)Cb_line[0][col+0];
+  Cb_pixel_01 = (int)Cb_line[0][col+1];
+  Cb_pixel_10 = (int)Cb_line[1][col+0];
+  Cb_pixel_11 = (int)Cb_line[1][col+1];
 
-  Cr_pixel_00 = (int)Cr_temp[row+0][col+0];
-  Cr_pixel_01 = (int)Cr_temp[row+0][col+1];
-  Cr_pixel_10 = (int)Cr_temp[row+1][col+0];
-  Cr_pixel_11 = (int)Cr_temp[row+1][col+1];
+  Cr_pixel_00 = (int)Cr_line[0][col+0];
+  Cr_pixel_01 = (int)Cr_line[0][col+1];
+  Cr_pixel_10 = (int)Cr_line[1][col+0];
+  Cr_pixel_11 = (int)Cr_line[1][col+1];
 
   Y_pixel_00 = Y_pixel_00 - 16;
   Y_pixel_01 = Y_pixel_01 - 16;
@@ -269,90 +267,49 @@ static void chrominance_upsample(
 } // END of chrominance_upsample()
 
 // =======
-static void chrominance_array_upsample( void) {
-  int row, col;
+// Upsample chrominance row (row>>1) into the ring buffer lines for image
+// rows row+0 and row+1. The last chrominance row and column are their own
+// neighbours.
+static void chrominance_line_upsample( int row) {
+  int col;
+  int row_c, row_n; // chrominance row and the one below
+  int col_n;        // chrominance column to the right
 
   uint8_t top;
   uint8_t left;
   uint8_t middle;
 
-  for( row=0; row<((IMAGE_ROW_SIZE>>1)-1); row+=1) {
-    for( col=0; col<((IMAGE_COL_SIZE>>1)-1); col+=1) { 
-      chrominance_upsample( Cb[row+0][col+0], Cb[row+0][col+1],
-                            Cb[row+1][col+0], Cb[row+1][col+1],
-                            &top, &left, &middle);
-      Cb_temp[(row<<1)+0][(col<<1)+0] = Cb[row+0][col+0];
-      Cb_temp[(row<<1)+0][(col<<1)+1] = top;
-      Cb_temp[(row<<1)+1][(col<<1)+0] = left;
-      Cb_temp[(row<<1)+1][(col<<1)+1] = middle;
-      //
-      chrominance_upsample( Cr[row+0][col+0], Cr[row+0][col+1],
-                            Cr[row+1][col+0], Cr[row+1][col+1],
-                            &top, &left, &middle);
-      Cr_temp[(row<<1)+0][(col<<1)+0] = Cr[row+0][col+0];
-      Cr_temp[(row<<1)+0][(col<<1)+1] = top;
-      Cr_temp[(row<<1)+1][(col<<1)+0] = left;
-      Cr_temp[(row<<1)+1][(col<<1)+1] = middle;
-    }
-  }
+  row_c = row >> 1;
+  row_n = (row_c < (IMAGE_ROW_SIZE>>1)-1) ? row_c+1 : row_c;
 
-  col = (IMAGE_COL_SIZE>>1) - 1;
-  for( row=0; row<((IMAGE_ROW_SIZE>>1)-1); row+=1) {
-    chrominance_upsample( Cb[row+0][col], Cb[row+0][col],
-                          Cb[row+1][col], Cb[row+1][col],
-                          &top, &left, &middle);
-    Cb_temp[(row<<1)+0][(col<<1)+0] = Cb[row+0][col];
-    Cb_temp[(row<<1)+0][(col<<1)+1] = top;
-    Cb_temp[(row<<1)+1][(col<<1)+0] = left;
-    Cb_temp[(row<<1)+1][(col<<1)+1] = middle;
-    //
-    chrominance_upsample( Cr[row+0][col], Cr[row+0][col],
-                          Cr[row+1][col], Cr[row+1][col],
-                          &top, &left, &middle);
-    Cr_temp[(row<<1)+0][(col<<1)+0] = Cr[row+0][col];
-    Cr_temp[(row<<1)+0][(col<<1)+1] = top;
-    Cr_temp[(row<<1)+1][(col<<1)+0] = left;
-    Cr_temp[(row<<1)+1][(col<<1)+1] = middle;
-  }
+  for( col=0; col<(IMAGE_COL_SIZE>>1); col+=1) {
+    col_n = (col < (IMAGE_COL_SIZE>>1)-1) ? col+1 : col;
 
-  row = (IMAGE_ROW_SIZE>>1) - 1;
-  for( col=0; row<((IMAGE_COL_SIZE>>1)-1); col+=1) {
-    chrominance_upsample( Cb[row][col+0], Cb[row][col+1],
-                          Cb[row][col+0], Cb[row][col+1],
+    chrominance_upsample( Cb[row_c][col], Cb[row_c][col_n],
+                          Cb[row_n][col], Cb[row_n][col_n],
                           &top, &left, &middle);
-    Cb_temp[(row<<1)+0][(col<<1)+0] = Cb[row][col+0];
-    Cb_temp[(row<<1)+0][(col<<1)+1] = top;
-    Cb_temp[(row<<1)+1][(col<<1)+0] = left;
-    Cb_temp[(row<<1)+1][(col<<1)+1] = middle;
+    Cb_line[0][(col<<1)+0] = Cb[row_c][col];
+    Cb_line[0][(col<<1)+1] = top;
+    Cb_line[1][(col<<1)+0] = left;
+    Cb_line[1][(col<<1)+1] = middle;
     //
-    chrominance_upsample( Cr[row][col+0], Cr[row][col+1],
-                          Cr[row][col+0], Cr[row][col+1],
+    chrominance_upsample( Cr[row_c][col], Cr[row_c][col_n],
+                          Cr[row_n][col], Cr[row_n][col_n],
                           &top, &left, &middle);
-    Cr_temp[(row<<1)+0][(col<<1)+0] = Cr[row][col+0];
-    Cr_temp[(row<<1)+0][(col<<1)+1] = top;
-    Cr_temp[(row<<1)+1][(col<<1)+0] = left;
-    Cr_temp[(row<<1)+1][(col<<1)+1] = middle;
+    Cr_line[0][(col<<1)+0] = Cr[row_c][col];
+    Cr_line[0][(col<<1)+1] = top;
+    Cr_line[1][(col<<1)+0] = left;
+    Cr_line[1][(col<<1)+1] = middle;
   }
-
-  row = (IMAGE_ROW_SIZE>>1) - 1;
-  col = (IMAGE_COL_SIZE>>1) - 1;
-  Cb_temp[(row<<1)+0][(col<<1)+0] = Cb[row][col];
-  Cb_temp[(row<<1)+0][(col<<1)+1] = Cb[row][col];
-  Cb_temp[(row<<1)+1][(col<<1)+0] = Cb[row][col];
-  Cb_temp[(row<<1)+1][(col<<1)+1] = Cb[row][col];
-  //
-  Cr_temp[(row<<1)+0][(col<<1)+0] = Cr[row][col];
-  Cr_temp[(row<<1)+0][(col<<1)+1] = Cr[row][col];
-  Cr_temp[(row<<1)+1][(col<<1)+0] = Cr[row][col];
-  Cr_temp[(row<<1)+1][(col<<1)+1] = Cr[row][col];
-
-} // END of chrominance_array_upsample()
+} // END of chrominance_line_upsample()
 
 // =======
 void CSC_YCC_to_RGB( void) {
   int row, col; // indices for row and column
 //
   for( row=0; row<IMAGE_ROW_SIZE; row+=2) {
+    // Upsample the chrominance of this row pair once, before its blocks
+    chrominance_line_upsample( row);
     for( col=0; col<IMAGE_COL_SIZE; col+=2) { 
       //printf( "\n[row,col] = [%02i,%02i]\n\n", row, col);
       switch (YCC_to_RGB_ROUTINE) {
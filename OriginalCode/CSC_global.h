@@ -2,30 +2,45 @@
 
 #define K 8 // bitwidth
 #define UNITY (1 << K)
+
+// The image size and routine selections below can be overridden from the
+// compiler command line (e.g. -DRGB_to_YCC_ROUTINE=2)
+#ifndef IMAGE_ROW_SIZE
 #define IMAGE_ROW_SIZE 64
+#endif
+#ifndef IMAGE_COL_SIZE
 #define IMAGE_COL_SIZE 48
+#endif
 
 // RGB_to_YCC_ROUTINE
 //     1 for CSC_RGB_to_YCC_brute_force_float()
 //     2 for CSC_RGB_to_YCC_brute_force_int()
+#ifndef RGB_to_YCC_ROUTINE
 #define RGB_to_YCC_ROUTINE 1
+#endif
 
 // YCC_to_RGB_ROUTINE
 //     1 for CSC_YCC_to_RGB_brute_force_float()
 //     2 for CSC_YCC_to_RGB_brute_force_int()
+#ifndef YCC_to_RGB_ROUTINE
 #define YCC_to_RGB_ROUTINE 1
+#endif
 
 // CHROMINANCE_DOWNSAMPLING_MODE = 
 //     0 for returning zero (no chrominance)
 //     1 for discarding three pixels and keeping one
 //     2 for averaging four pixels
+#ifndef CHROMINANCE_DOWNSAMPLING_MODE
 #define CHROMINANCE_DOWNSAMPLING_MODE 1
+#endif
 
 // CHROMINANCE_UPSAMPLING_MODE = 
 //     0 for returning zero (no chrominance)
 //     1 for replicating one pixel into three
 //     2 for interpolation with two pixels
+#ifndef CHROMINANCE_UPSAMPLING_MODE
 #define CHROMINANCE_UPSAMPLING_MODE 1
+#endif
 
 // RGB-to-YCC coefficients in 8-bit representation
 #define C11  66
@@ -66,6 +81,4 @@ EXTERN uint8_t B[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]; // Blue array pointer
 EXTERN uint8_t Y[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]; // Luminance array pointer
 EXTERN uint8_t Cb[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1]; // Chrominance (Cb) array pointer
 EXTERN uint8_t Cr[IMAGE_ROW_SIZE >> 1][IMAGE_COL_SIZE >> 1]; // Chrominance (Cr) array pointer
-EXTERN uint8_t Cb_temp[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]; // Chrominance (Cb) temp array pointer
-EXTERN uint8_t Cr_temp[IMAGE_ROW_SIZE][IMAGE_COL_SIZE]; // Chrominance (Cr) temp array pointer
 